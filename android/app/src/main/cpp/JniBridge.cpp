@@ -6,15 +6,97 @@
 
 #include "player/AudioDebug.h"
 #include "player/AudioEngine.h"
+#include "player/AudioOutput.h"
+#include "player/CodecPool.h"
+#include "player/Demuxer.h"
+#include "player/VideoEngine.h"
 #include "player/VirtualClock.h"
 #include <aaudio/AAudio.h>
+#include <android/native_window_jni.h>
+#include <algorithm>
 #include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 /*
  * Global singletons
  */
 static VirtualClock gVirtualClock;
 static AudioEngine *gAudio = nullptr;
+static VideoEngine *gVideo = nullptr;
+// Demuxer of the current file. Audio and video decode from it when the
+// video fd refers to the same file; each engine also holds a reference.
+static std::shared_ptr<Demuxer> gDemuxer;
+// Demuxer of the item prepared for a gapless transition, and the audio
+// engine's item serial it was last synced with (see syncItem).
+static std::shared_ptr<Demuxer> gNextDemuxer;
+static uint32_t gItemSerial = 0;
+
+/*
+ * Async open (nativePlayFdAsync). The open thread owns gAudio until
+ * gOpenState leaves kOpenOpening; transport calls made meanwhile only
+ * record what they want (play/pause, the latest seek, an audio track),
+ * applied once the open is done; so are speed changes made meanwhile.
+ * gDemuxer is published as soon as the file is parsed so video can open
+ * on it while the audio codec and stream are set up.
+ */
+enum OpenState : int {
+  kOpenFailed = -1,
+  kOpenIdle = 0,
+  kOpenOpening = 1,
+  kOpenReady = 2,
+};
+static std::thread gOpenThread;
+static std::atomic<int> gOpenState{kOpenIdle};
+// Fields below; every write of gDemuxer / gNextDemuxer (currentDemuxer
+// reads them from other JNI threads).
+static std::mutex gOpenMutex;
+static std::condition_variable gOpenCv;
+static bool gOpenDemuxed = false;
+static bool gOpenWantsPlay = true;
+static int64_t gOpenSeekUs = -1; // -1 = none
+static uint32_t gOpenSeekId = 0;
+static int32_t gOpenAudioTrack = -1; // -1 = the default one
+
+/*
+ * Seek ids (Demuxer::seekUs). A user seek is nativeSeek followed by
+ * nativeVideoSeek to the same position (PlayerController); both halves get
+ * one id, so the shared demuxer seeks once for them, whichever engine gets
+ * there first. Every other seek, a repeat of the same position included,
+ * has an id of its own and repositions the demuxer.
+ */
+static std::mutex gSeekMutex;
+static uint32_t gSeekId = 0;
+static int64_t gAudioSeekUs = -1; // last nativeSeek not yet paired
+static uint32_t gAudioSeekId = 0;
+
+static uint32_t nextSeekIdLocked() {
+  if (++gSeekId == 0) // 0 = not shared
+    ++gSeekId;
+  return gSeekId;
+}
+
+// nativeSeek: a new id, offered to the next video seek.
+static uint32_t issueSeekId(int64_t us) {
+  std::lock_guard<std::mutex> lock(gSeekMutex);
+  gAudioSeekUs = us;
+  gAudioSeekId = nextSeekIdLocked();
+  return gAudioSeekId;
+}
+
+// nativeVideoSeek: the offered id when it is the same seek, else a new one.
+static uint32_t claimSeekId(int64_t us) {
+  std::lock_guard<std::mutex> lock(gSeekMutex);
+  uint32_t id = us == gAudioSeekUs ? gAudioSeekId : nextSeekIdLocked();
+  gAudioSeekUs = -1;
+  return id;
+}
 
 /*
  * Audio debug state (defined in AudioDebug.cpp)
@@ -23,6 +105,237 @@ extern AudioDebug gAudioDebug;
 extern std::atomic<bool> gAudioHealthy;
 static std::atomic<int64_t> gDurationUs{0};
 
+// Decode mode preference for engines created after it is set (API 28+ only)
+static std::atomic<bool> gPreferAsyncDecode{true};
+static std::atomic<int> gResamplerQuality{
+    static_cast<int>(ResamplerQuality::Medium)};
+static std::atomic<float> gDownmixCenterGain{1.0f};
+static std::atomic<float> gDownmixLfeGain{0.0f};
+static std::atomic<bool> gAccurateSeek{false};
+static std::atomic<int64_t> gRewindCacheUs{20000000};
+static std::atomic<int64_t> gRewindCacheBytes{16 << 20};
+static std::atomic<int64_t> gCrossfadeUs{0};
+static std::atomic<int> gOutputMode{
+    static_cast<int>(AudioOutput::Mode::Default)};
+static std::atomic<bool> gDeepBuffer{false};
+static std::atomic<float> gPlaybackRate{1.0f};
+// Output DSP settings; gDspMutex also keeps their publication to the
+// engine single-writer.
+static std::mutex gDspMutex;
+static DspParams gDspParams;
+
+// Deep buffering: asked for explicitly (screen off) or implied by a
+// power-saving output.
+static bool deepBufferWanted() {
+  return gDeepBuffer.load() ||
+         gOutputMode.load() == static_cast<int>(AudioOutput::Mode::PowerSaving);
+}
+
+static AudioEngine *createAudioEngine() {
+  auto *engine = new AudioEngine(&gVirtualClock);
+  engine->setPreferAsyncDecode(gPreferAsyncDecode.load());
+  engine->setResamplerQuality(
+      static_cast<ResamplerQuality>(gResamplerQuality.load()));
+  DownmixOptions downmix;
+  downmix.centerGain = gDownmixCenterGain.load();
+  downmix.lfeGain = gDownmixLfeGain.load();
+  engine->setDownmixOptions(downmix);
+  engine->setAccurateSeek(gAccurateSeek.load());
+  engine->setRewindCache(gRewindCacheUs.load(),
+                         static_cast<size_t>(gRewindCacheBytes.load()));
+  engine->setCrossfadeUs(gCrossfadeUs.load());
+  engine->setDeepBuffer(deepBufferWanted());
+  engine->setPlaybackRate(gPlaybackRate.load());
+  {
+    std::lock_guard<std::mutex> lock(gDspMutex);
+    engine->setDspParams(gDspParams);
+  }
+  return engine;
+}
+
+// Applies `change` to the DSP settings and hands them to the engine, which
+// picks them up lock-free on its next ring write.
+template <typename Fn> static void updateDsp(Fn &&change) {
+  std::lock_guard<std::mutex> lock(gDspMutex);
+  change(gDspParams);
+  if (gAudio)
+    gAudio->setDspParams(gDspParams);
+}
+
+// The audio engine switched to the prepared item on its own: its demuxer
+// becomes the current one (video opens on it) and its duration the
+// reported one.
+static uint32_t syncItem() {
+  if (!gAudio)
+    return gItemSerial;
+  uint32_t serial = gAudio->itemSerial();
+  if (serial != gItemSerial) {
+    gItemSerial = serial;
+    std::shared_ptr<Demuxer> old; // torn down outside the lock
+    {
+      std::lock_guard<std::mutex> lock(gOpenMutex);
+      old = std::move(gDemuxer);
+      gDemuxer = std::move(gNextDemuxer);
+    }
+    gDurationUs.store(gAudio->getDurationUs());
+  }
+  return serial;
+}
+
+// Replaces gDemuxer / gNextDemuxer under gOpenMutex. The old one is
+// released after the lock (its reader thread is joined).
+static void setDemuxer(std::shared_ptr<Demuxer> demuxer) {
+  {
+    std::lock_guard<std::mutex> lock(gOpenMutex);
+    gDemuxer.swap(demuxer);
+  }
+}
+
+static void setNextDemuxer(std::shared_ptr<Demuxer> demuxer) {
+  {
+    std::lock_guard<std::mutex> lock(gOpenMutex);
+    gNextDemuxer.swap(demuxer);
+  }
+}
+
+// Clears the per-stage open stats and stamps the request time.
+static int64_t beginOpenStats() {
+  gAudioDebug.openDemuxUs.store(-1);
+  gAudioDebug.openCodecUs.store(-1);
+  gAudioDebug.openOutputUs.store(-1);
+  gAudioDebug.openWarmUs.store(-1);
+  gAudioDebug.openReadyUs.store(-1);
+  gAudioDebug.openFirstAudioUs.store(-1);
+  int64_t requestUs = VirtualClock::nowUs();
+  gAudio->setOpenRequestUs(requestUs);
+  return requestUs;
+}
+
+// Opens the shared demuxer for a new file and the audio engine on it.
+static bool openAudioFd(int fd, int64_t offset, int64_t length) {
+  int64_t requestUs = beginOpenStats();
+  auto demuxer = std::make_shared<Demuxer>();
+  if (!demuxer->openFd(fd, offset, length)) {
+    setDemuxer(nullptr);
+    return false;
+  }
+  setDemuxer(demuxer);
+  gAudioDebug.openDemuxUs.store(demuxer->stats().openUs);
+  if (!gAudio->open(demuxer))
+    return false;
+  gAudioDebug.openReadyUs.store(VirtualClock::nowUs() - requestUs);
+  return true;
+}
+
+// Open thread body. `fd` is a dup owned (and closed) here.
+static void runAsyncOpen(int fd, int64_t offset, int64_t length,
+                         int64_t requestUs) {
+  // The AAudio stream is created alongside probing and codec setup;
+  // AudioEngine::open's acquire() waits for it on the session lock. Opened
+  // for stereo: acquire() reopens if the file has more channels and the
+  // device can take them.
+  std::thread warm([] {
+    int64_t startUs = VirtualClock::nowUs();
+    AudioOutput::instance().prewarm(2);
+    gAudioDebug.openWarmUs.store(VirtualClock::nowUs() - startUs);
+  });
+
+  auto demuxer = std::make_shared<Demuxer>();
+  bool ok = demuxer->openFd(fd, offset, length);
+  close(fd);
+  {
+    std::lock_guard<std::mutex> lock(gOpenMutex);
+    if (ok)
+      gDemuxer = demuxer;
+    gOpenDemuxed = true;
+  }
+  gOpenCv.notify_all();
+
+  if (ok) {
+    gAudioDebug.openDemuxUs.store(demuxer->stats().openUs);
+    ok = gAudio->open(demuxer);
+  }
+  warm.join();
+
+  {
+    std::lock_guard<std::mutex> lock(gOpenMutex);
+    if (ok) {
+      gDurationUs.store(gAudio->getDurationUs());
+      gAudio->setPlaybackRate(gPlaybackRate.load());
+      if (gOpenAudioTrack >= 0)
+        gAudio->selectAudioTrack(gOpenAudioTrack);
+      if (gOpenSeekUs >= 0)
+        gAudio->seekUs(gOpenSeekUs, gOpenSeekId);
+      if (gOpenWantsPlay) {
+        gAudio->start();
+        if (!gVirtualClock.isRunning()) {
+          gVirtualClock.start();
+        }
+      }
+      gAudioDebug.openReadyUs.store(VirtualClock::nowUs() - requestUs);
+    } else {
+      LOGE("MX-AUDIO", "async open FAILED");
+    }
+    gOpenState.store(ok ? kOpenReady : kOpenFailed, std::memory_order_release);
+  }
+  gOpenCv.notify_all();
+}
+
+// An async open cannot be interrupted half-way through codec or stream
+// setup; teardown waits for it.
+static void joinOpen() {
+  if (gOpenThread.joinable())
+    gOpenThread.join();
+  gOpenState.store(kOpenIdle, std::memory_order_release);
+}
+
+// While the open thread owns gAudio: records play/pause intent and returns
+// true (the caller leaves gAudio alone).
+static bool deferToOpen(bool play) {
+  std::lock_guard<std::mutex> lock(gOpenMutex);
+  if (gOpenState.load(std::memory_order_acquire) != kOpenOpening)
+    return false;
+  gOpenWantsPlay = play;
+  return true;
+}
+
+static bool deferSeekToOpen(int64_t us, uint32_t seekId) {
+  std::lock_guard<std::mutex> lock(gOpenMutex);
+  if (gOpenState.load(std::memory_order_acquire) != kOpenOpening)
+    return false;
+  gOpenSeekUs = us;
+  gOpenSeekId = seekId;
+  return true;
+}
+
+static bool deferTrackToOpen(int32_t track) {
+  std::lock_guard<std::mutex> lock(gOpenMutex);
+  if (gOpenState.load(std::memory_order_acquire) != kOpenOpening)
+    return false;
+  gOpenAudioTrack = track;
+  return true;
+}
+
+// True while the open thread owns gAudio. Settings stored before asking
+// are picked up by it when the open is done.
+static bool openInProgress() {
+  std::lock_guard<std::mutex> lock(gOpenMutex);
+  return gOpenState.load(std::memory_order_acquire) == kOpenOpening;
+}
+
+// Current demuxer; with `waitForParse`, first waits for a running async
+// open to get past parsing the file.
+static std::shared_ptr<Demuxer> currentDemuxer(bool waitForParse) {
+  std::unique_lock<std::mutex> lock(gOpenMutex);
+  if (waitForParse) {
+    gOpenCv.wait(lock, [] {
+      return gOpenDemuxed ||
+             gOpenState.load(std::memory_order_acquire) != kOpenOpening;
+    });
+  }
+  return gDemuxer;
+}
+
 /* ───────────────────────────── */
 /* Playback control JNI */
 /* ───────────────────────────── */
@@ -30,12 +343,17 @@ static std::atomic<int64_t> gDurationUs{0};
 extern "C" JNIEXPORT void JNICALL
 Java_com_mxlite_app_player_NativePlayer_nativeInit(JNIEnv *, jobject) {
   // 1. Stop and destroy existing audio engine if any
+  joinOpen();
   if (gAudio) {
     gAudio->stop();
     delete gAudio;
     gAudio = nullptr;
   }
 
+  setDemuxer(nullptr);
+  setNextDemuxer(nullptr);
+  gItemSerial = 0;
+
   // 2. Reset VirtualClock (authoritative time source)
   gVirtualClock.reset();
 
@@ -43,6 +361,8 @@ Java_com_mxlite_app_player_NativePlayer_nativeInit(JNIEnv *, jobject) {
   gAudioDebug.decodeActive.store(false, std::memory_order_release);
   gAudioDebug.callbackCalled.store(false, std::memory_order_release);
   gAudioDebug.audioStarted.store(false, std::memory_order_release);
+  // No engine renders or decodes now, so the single writers are idle.
+  gAudioDebug.resetMetrics();
 
   // 4. Reset duration (will be set by open/playFd)
   gDurationUs.store(0, std::memory_order_release);
@@ -57,11 +377,17 @@ Java_com_mxlite_app_player_NativePlayer_nativePlay(JNIEnv *env,
 
   const char *cpath = env->GetStringUTFChars(path, nullptr);
 
+  joinOpen();
   if (!gAudio) {
-    gAudio = new AudioEngine(&gVirtualClock);
+    gAudio = createAudioEngine();
   }
 
-  if (gAudio->open(cpath)) {
+  auto demuxer = std::make_shared<Demuxer>();
+  if (!demuxer->openPath(cpath))
+    demuxer.reset();
+  setDemuxer(demuxer);
+
+  if (demuxer && gAudio->open(demuxer)) {
     gAudio->start();
     // 🔴 FIX #1: Mandatory clock start
     if (!gVirtualClock.isRunning()) {
@@ -77,11 +403,12 @@ Java_com_mxlite_app_player_NativePlayer_nativePlayFd(JNIEnv *, jobject, jint fd,
                                                      jlong offset,
                                                      jlong length) {
 
+  joinOpen();
   if (!gAudio) {
-    gAudio = new AudioEngine(&gVirtualClock);
+    gAudio = createAudioEngine();
   }
 
-  if (gAudio->openFd(fd, offset, length)) {
+  if (openAudioFd(fd, offset, length)) {
     gDurationUs.store(gAudio->getDurationUs());
     gAudio->start();
     // 🔴 FIX #1: Mandatory clock start
@@ -94,6 +421,7 @@ Java_com_mxlite_app_player_NativePlayer_nativePlayFd(JNIEnv *, jobject, jint fd,
 extern "C" JNIEXPORT void JNICALL
 Java_com_mxlite_app_player_NativePlayer_nativeStop(JNIEnv *, jobject) {
 
+  joinOpen();
   if (gAudio) {
     gAudio->stop();
   }
@@ -103,11 +431,15 @@ extern "C" JNIEXPORT void JNICALL
 Java_com_mxlite_app_player_NativePlayer_nativeSeek(JNIEnv *, jobject,
                                                    jlong posUs) {
 
-  if (gAudio) {
-    gAudio->seekUs((int64_t)posUs);
+  // Posted to the decode thread, which applies the latest of a burst of
+  // seeks (scrubbing); returns immediately. Held back while opening.
+  uint32_t seekId = issueSeekId(posUs);
+  if (gAudio && !deferSeekToOpen(posUs, seekId)) {
+    gAudio->seekUs((int64_t)posUs, seekId);
   }
 
-  // ALWAYS update backing clock explicitly to ensure sync
+  // ALWAYS update backing clock explicitly to ensure sync. This also moves
+  // the position the UI reads before the engine gets to the seek.
   // This prevents video freeze if AudioEngine fails to propagate the seek
   gVirtualClock.seekUs((int64_t)posUs);
 
@@ -119,19 +451,23 @@ Java_com_mxlite_app_player_NativePlayer_nativeSeek(JNIEnv *, jobject,
 extern "C" JNIEXPORT void JNICALL
 Java_com_mxlite_app_player_NativePlayer_nativeRelease(JNIEnv *, jobject) {
 
+  joinOpen();
   if (gAudio) {
     // Ensure decoder thread stops before deleting
     gAudio->stop();
     delete gAudio;
     gAudio = nullptr;
   }
+  setDemuxer(nullptr);
+  setNextDemuxer(nullptr);
+  gItemSerial = 0;
   gVirtualClock.reset();
 }
 
 extern "C" JNIEXPORT void JNICALL
 Java_com_mxlite_app_player_NativePlayer_nativePause(JNIEnv *, jobject) {
 
-  if (gAudio) {
+  if (gAudio && !deferToOpen(false)) {
     gAudio->pause();
   } else {
     gVirtualClock.pause();
@@ -141,7 +477,7 @@ Java_com_mxlite_app_player_NativePlayer_nativePause(JNIEnv *, jobject) {
 extern "C" JNIEXPORT void JNICALL
 Java_com_mxlite_app_player_NativePlayer_nativeResume(JNIEnv *, jobject) {
 
-  if (gAudio) {
+  if (gAudio && !deferToOpen(true)) {
     gAudio->start();
   }
   // 🔴 FIX #2: Mandatory clock resume
@@ -153,18 +489,364 @@ Java_com_mxlite_app_player_NativePlayer_nativeGetDurationMs(JNIEnv *, jobject) {
   return gDurationUs.load() / 1000;
 }
 
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetAsyncDecode(JNIEnv *, jobject,
+                                                             jboolean enabled) {
+  // Takes effect on the next open (nativeInit destroys the current engine)
+  gPreferAsyncDecode.store(enabled == JNI_TRUE);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetOutputMode(JNIEnv *, jobject,
+                                                            jint mode) {
+  // AudioOutput::Mode: 0 default, 1 low latency (exclusive, adaptive
+  // buffer), 2 power saving (deep buffer). The stream mode takes effect on
+  // the next open (the shared stream is reopened in the new mode), the
+  // deep buffering of power saving at once.
+  int m = std::clamp(static_cast<int>(mode), 0, 2);
+  gOutputMode.store(m);
+  AudioOutput::instance().setMode(static_cast<AudioOutput::Mode>(m));
+  if (gAudio)
+    gAudio->setDeepBuffer(deepBufferWanted());
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetDeepBuffer(JNIEnv *, jobject,
+                                                            jboolean enabled) {
+  // Decode in multi-second batches and sleep in between (screen off,
+  // audio only). Applies at once, on any output.
+  gDeepBuffer.store(enabled == JNI_TRUE);
+  if (gAudio)
+    gAudio->setDeepBuffer(deepBufferWanted());
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetPlaybackRate(JNIEnv *, jobject,
+                                                              jfloat rate) {
+  // Pitch-preserving speed change; applies at once and to later files. The
+  // clock takes it directly too, for files without audio.
+  rate = std::clamp(static_cast<float>(rate), TimeStretcher::kMinRate,
+                    TimeStretcher::kMaxRate);
+  gPlaybackRate.store(rate);
+  gVirtualClock.setRate(rate);
+  if (gAudio && !openInProgress())
+    gAudio->setPlaybackRate(rate);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetVolumeBoost(JNIEnv *, jobject,
+                                                             jfloat db) {
+  // Gain above 100 % (dB); the limiter keeps it from clipping. Applies at
+  // once and to later files.
+  float clamped = std::clamp(static_cast<float>(db), 0.0f,
+                             DspChain::kMaxBoostDb);
+  updateDsp([clamped](DspParams &p) { p.boostDb = clamped; });
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetEqualizer(
+    JNIEnv *env, jobject, jboolean enabled, jfloatArray gainsDb) {
+  // 10-band graphic EQ (DspChain::kEqBandHz); missing bands stay flat.
+  float gains[DspParams::kEqBands] = {};
+  jsize count = gainsDb ? env->GetArrayLength(gainsDb) : 0;
+  count = std::min<jsize>(count, DspParams::kEqBands);
+  if (count > 0)
+    env->GetFloatArrayRegion(gainsDb, 0, count, gains);
+  updateDsp([&](DspParams &p) {
+    p.eqEnabled = enabled == JNI_TRUE;
+    for (int b = 0; b < DspParams::kEqBands; ++b)
+      p.eqDb[b] = std::clamp(gains[b], -DspChain::kMaxEqDb, DspChain::kMaxEqDb);
+  });
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetNightMode(JNIEnv *, jobject,
+                                                           jboolean enabled) {
+  // Dynamic range compression: quiet passages up, loud ones down.
+  updateDsp([enabled](DspParams &p) { p.nightMode = enabled == JNI_TRUE; });
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSelectAudioTrack(JNIEnv *,
+                                                               jobject,
+                                                               jint track) {
+  // Live switch to another audio track (container index) of the current
+  // file: same stream and clock, new decoder, joins at the playing
+  // position. False if the file has no such audio track.
+  std::shared_ptr<Demuxer> demuxer = currentDemuxer(true);
+  if (!gAudio || !demuxer || track < 0 || track >= demuxer->trackCount() ||
+      demuxer->trackMime(track).compare(0, 6, "audio/") != 0)
+    return JNI_FALSE;
+  if (!deferTrackToOpen(track))
+    gAudio->selectAudioTrack(track);
+  return JNI_TRUE;
+}
+
+extern "C" JNIEXPORT jfloat JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativePlaybackRate(JNIEnv *, jobject) {
+  return gVirtualClock.rate();
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeOutputLatencyUs(JNIEnv *,
+                                                              jobject) {
+  // Callback-to-DAC latency the clock compensates for (us)
+  return gVirtualClock.outputLatencyUs();
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetResamplerQuality(
+    JNIEnv *, jobject, jint quality) {
+  // 0 = low, 1 = medium, 2 = high. Takes effect on the next open.
+  if (quality < 0 || quality > 2)
+    return;
+  gResamplerQuality.store(quality);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetDownmixGains(
+    JNIEnv *, jobject, jfloat centerGain, jfloat lfeGain) {
+  // Linear gains used when folding multichannel audio into fewer speakers.
+  // Takes effect on the next open.
+  gDownmixCenterGain.store(std::max(0.0f, static_cast<float>(centerGain)));
+  gDownmixLfeGain.store(std::max(0.0f, static_cast<float>(lfeGain)));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetRewindCache(JNIEnv *, jobject,
+                                                             jlong maxMs,
+                                                             jint maxMb) {
+  // Decoded audio kept for rewinds (0 ms = off). Takes effect on the next
+  // open.
+  gRewindCacheUs.store(std::max<int64_t>(0, maxMs) * 1000);
+  gRewindCacheBytes.store(static_cast<int64_t>(std::max(1, (int)maxMb)) << 20);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetAccurateSeek(
+    JNIEnv *, jobject, jboolean enabled) {
+  // Seek to the exact position instead of the preceding sync sample.
+  // Applies from the next seek on.
+  bool accurate = enabled == JNI_TRUE;
+  gAccurateSeek.store(accurate);
+  if (gAudio)
+    gAudio->setAccurateSeek(accurate);
+  if (gVideo)
+    gVideo->setAccurateSeek(accurate);
+}
+
+/* ───────────────────────────── */
+/* Async open JNI */
+/* ───────────────────────────── */
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativePlayFdAsync(JNIEnv *, jobject,
+                                                          jint fd,
+                                                          jlong offset,
+                                                          jlong length) {
+  // Returns at once; nativeOpenState() reports when audio is ready.
+  joinOpen();
+  if (!gAudio) {
+    gAudio = createAudioEngine();
+  }
+  gAudioDebug.nativePlayCalled.store(true);
+
+  // Dup here: the caller may close its descriptor before the thread runs.
+  int ownFd = dup(fd);
+  if (ownFd < 0) {
+    gOpenState.store(kOpenFailed, std::memory_order_release);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(gOpenMutex);
+    gOpenDemuxed = false;
+    gOpenWantsPlay = true;
+    gOpenSeekUs = -1;
+    gOpenAudioTrack = -1;
+    gOpenState.store(kOpenOpening, std::memory_order_release);
+  }
+  int64_t requestUs = beginOpenStats();
+  gOpenThread = std::thread(runAsyncOpen, ownFd, offset, length, requestUs);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeOpenState(JNIEnv *, jobject) {
+  // -1 = failed, 0 = idle (or synchronous open), 1 = opening, 2 = ready
+  return gOpenState.load(std::memory_order_acquire);
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativePrewarmDecoders(
+    JNIEnv *env, jobject, jobjectArray mimes) {
+  // Creates idle decoders for these MIME types in the background; the
+  // first open of each type takes one from the pool. Once per process.
+  std::vector<std::string> list;
+  jsize count = mimes ? env->GetArrayLength(mimes) : 0;
+  for (jsize i = 0; i < count; ++i) {
+    auto mime = static_cast<jstring>(env->GetObjectArrayElement(mimes, i));
+    if (!mime)
+      continue;
+    const char *chars = env->GetStringUTFChars(mime, nullptr);
+    if (chars) {
+      list.emplace_back(chars);
+      env->ReleaseStringUTFChars(mime, chars);
+    }
+    env->DeleteLocalRef(mime);
+  }
+  CodecPool::instance().prewarm(std::move(list));
+}
+
+/* ───────────────────────────── */
+/* Gapless JNI */
+/* ───────────────────────────── */
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativePrepareNextFd(JNIEnv *, jobject,
+                                                            jint fd,
+                                                            jlong offset,
+                                                            jlong length) {
+  // Parses the next file here; its decoder is set up and primed on the
+  // engine's prepare thread while the current item keeps playing.
+  if (!gAudio || gOpenState.load(std::memory_order_acquire) == kOpenOpening)
+    return JNI_FALSE;
+  syncItem();
+  auto demuxer = std::make_shared<Demuxer>();
+  if (!demuxer->openFd(fd, offset, length) || !gAudio->prepareNext(demuxer)) {
+    setNextDemuxer(nullptr);
+    return JNI_FALSE;
+  }
+  setNextDemuxer(std::move(demuxer));
+  return JNI_TRUE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeCancelNext(JNIEnv *, jobject) {
+  syncItem();
+  if (gAudio && gOpenState.load(std::memory_order_acquire) != kOpenOpening)
+    gAudio->cancelNext();
+  setNextDemuxer(nullptr);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeItemSerial(JNIEnv *, jobject) {
+  // Changes when the prepared item took over (polled by the controller).
+  return static_cast<jint>(syncItem());
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetGaplessCrossfade(JNIEnv *,
+                                                                  jobject,
+                                                                  jlong ms) {
+  // Overlap at gapless transitions (0 = back to back). Applies from the
+  // next transition.
+  gCrossfadeUs.store(std::max<int64_t>(0, ms) * 1000);
+  if (gAudio)
+    gAudio->setCrossfadeUs(gCrossfadeUs.load());
+}
+
+/* ───────────────────────────── */
+/* Video JNI */
+/* ───────────────────────────── */
+
+static VideoEngine *videoEngine() {
+  if (!gVideo) {
+    gVideo = new VideoEngine(&gVirtualClock);
+    gVideo->setAccurateSeek(gAccurateSeek.load());
+  }
+  return gVideo;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeVideoSetSurface(JNIEnv *env,
+                                                              jobject,
+                                                              jobject surface) {
+  // null detaches: the render loop stops until a new surface arrives.
+  ANativeWindow *window =
+      surface ? ANativeWindow_fromSurface(env, surface) : nullptr;
+  videoEngine()->setWindow(window);
+  if (window)
+    ANativeWindow_release(window); // the engine holds its own reference
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeVideoOpenFd(JNIEnv *, jobject,
+                                                          jint fd, jlong offset,
+                                                          jlong length) {
+  // Same file as the audio: decode from the shared demuxer instead of
+  // parsing and reading it a second time (an async audio open publishes it
+  // once the file is parsed).
+  std::shared_ptr<Demuxer> demuxer = currentDemuxer(true);
+  bool ok = demuxer && demuxer->isSameSource(fd, offset)
+                ? videoEngine()->open(demuxer)
+                : videoEngine()->openFd(fd, offset, length);
+  return ok ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeVideoPlay(JNIEnv *, jobject) {
+  if (gVideo)
+    gVideo->play();
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeVideoPause(JNIEnv *, jobject) {
+  if (gVideo)
+    gVideo->pause();
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeVideoSeek(JNIEnv *, jobject,
+                                                        jlong posUs) {
+  if (gVideo)
+    gVideo->seekUs(posUs, claimSeekId(posUs));
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeVideoStop(JNIEnv *, jobject) {
+  // Keeps the surface (SURFACE LAW); only nativeVideoRelease drops it.
+  if (gVideo)
+    gVideo->stop();
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeVideoRelease(JNIEnv *, jobject) {
+  delete gVideo;
+  gVideo = nullptr;
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeVideoDurationUs(JNIEnv *,
+                                                              jobject) {
+  return gVideo ? gVideo->durationUs() : 0;
+}
+
 /* ───────────────────────────── */
 /* Clock JNI */
 /* ───────────────────────────── */
 
+extern "C" JNIEXPORT void JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeSetClockMode(JNIEnv *, jobject,
+                                                           jint mode) {
+  // 0 = monotonic, 1 = anchored to AAudio presentation timestamps.
+  // Applies immediately.
+  if (mode < 0 || mode > 1)
+    return;
+  gVirtualClock.setMode(static_cast<VirtualClock::Mode>(mode));
+}
+
 extern "C" JNIEXPORT jlong JNICALL
 Java_com_mxlite_app_player_NativePlayer_virtualClockUs(JNIEnv *, jobject) {
+  // Hot path (video sync loop fallback): no logging here.
+  return gVirtualClock.positionUs();
+}
 
-  int64_t pos = gVirtualClock.positionUs();
-  // Temporary logging as requested for 1-line proof
-  __android_log_print(ANDROID_LOG_ERROR, "JNI", "virtualClockUs = %lld",
-                      (long long)pos);
-  return pos;
+extern "C" JNIEXPORT jobject JNICALL
+Java_com_mxlite_app_player_NativePlayer_nativeClockPage(JNIEnv *env, jobject) {
+  // Direct view of the clock's seqlock page (layout in core/ClockPage.h).
+  // gVirtualClock lives as long as the library, so the buffer never dangles.
+  ClockPage &page = gVirtualClock.page();
+  return env->NewDirectByteBuffer(page.data(),
+                                  static_cast<jlong>(ClockPage::size()));
 }
 
 /* ───────────────────────────── */
@@ -252,6 +934,252 @@ Java_com_mxlite_app_player_NativePlayer_dbgDecodeActive(JNIEnv *, jobject) {
                                                                   : JNI_FALSE;
 }
 
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgDecodeWakeups(JNIEnv *, jobject) {
+  return gAudioDebug.decodeWakeups.load(std::memory_order_relaxed);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgDecodeMode(JNIEnv *, jobject) {
+  return gAudioDebug.decodeMode.load(std::memory_order_relaxed);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgFirstAudioUs(JNIEnv *, jobject) {
+  return gAudioDebug.firstAudioUs.load(std::memory_order_relaxed);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgResampleFromHz(JNIEnv *, jobject) {
+  return gAudioDebug.resampleFromHz.load(std::memory_order_relaxed);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgStreamSampleRate(JNIEnv *,
+                                                            jobject) {
+  return gAudioDebug.streamSampleRate.load(std::memory_order_relaxed);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgCodecChannels(JNIEnv *, jobject) {
+  return gAudioDebug.codecChannels.load(std::memory_order_relaxed);
+}
+
+extern "C" JNIEXPORT jint JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgStreamChannels(JNIEnv *, jobject) {
+  return gAudioDebug.streamChannels.load(std::memory_order_relaxed);
+}
+
+extern "C" JNIEXPORT jlong JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgOutputLatencyUs(JNIEnv *, jobject) {
+  return gAudioDebug.outputLatencyUs.load(std::memory_order_relaxed);
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgClockStats(JNIEnv *env, jobject) {
+  // [anchored, lastErrorUs, maxAbsErrorUs, rmsErrorUs, slewPpm, samples,
+  //  resyncs, timestampFailures]
+  VirtualClock::SyncStats st = gVirtualClock.syncStats();
+  jlong values[8] = {st.anchored ? 1 : 0, st.lastErrorUs, st.maxAbsErrorUs,
+                     st.rmsErrorUs,       st.slewPpm,     st.samples,
+                     st.resyncs,          st.timestampFailures};
+  jlongArray out = env->NewLongArray(8);
+  if (out)
+    env->SetLongArrayRegion(out, 0, 8, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgVideoStats(JNIEnv *env, jobject) {
+  // [rendered, dropped, late, width, height, skipped, seekLatencyUs]
+  VideoEngine::Stats st = gVideo ? gVideo->stats() : VideoEngine::Stats{};
+  jlong values[7] = {st.rendered, st.dropped, st.late,         st.width,
+                     st.height,   st.skipped, st.seekLatencyUs};
+  jlongArray out = env->NewLongArray(7);
+  if (out)
+    env->SetLongArrayRegion(out, 0, 7, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgRewindCache(JNIEnv *env, jobject) {
+  // [heldUs, capacityUs, hits]
+  jlong values[3] = {gAudioDebug.historyUs.load(),
+                     gAudioDebug.historyCapacityUs.load(),
+                     gAudioDebug.historyHits.load()};
+  jlongArray out = env->NewLongArray(3);
+  if (out)
+    env->SetLongArrayRegion(out, 0, 3, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgGapless(JNIEnv *env, jobject) {
+  // [nextReady, prepareUs, transitions, crossfadeUs]
+  jlong values[4] = {gAudioDebug.nextReady.load() ? 1 : 0,
+                     gAudioDebug.nextPrepareUs.load(),
+                     gAudioDebug.gaplessTransitions.load(),
+                     gCrossfadeUs.load()};
+  jlongArray out = env->NewLongArray(4);
+  if (out)
+    env->SetLongArrayRegion(out, 0, 4, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgOpenTimings(JNIEnv *env, jobject) {
+  // Last audio open, us per stage (-1 = not reached): [demux, codec,
+  //  output, outputPrewarm, ready, firstAudio]; ready and firstAudio count
+  //  from the play request
+  jlong values[6] = {gAudioDebug.openDemuxUs.load(),
+                     gAudioDebug.openCodecUs.load(),
+                     gAudioDebug.openOutputUs.load(),
+                     gAudioDebug.openWarmUs.load(),
+                     gAudioDebug.openReadyUs.load(),
+                     gAudioDebug.openFirstAudioUs.load()};
+  jlongArray out = env->NewLongArray(6);
+  if (out)
+    env->SetLongArrayRegion(out, 0, 6, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgCodecPool(JNIEnv *env, jobject) {
+  // [hits, misses, idle] of the audio decoder pool
+  jlong values[3] = {gAudioDebug.codecPoolHits.load(),
+                     gAudioDebug.codecPoolMisses.load(),
+                     gAudioDebug.codecPoolIdle.load()};
+  jlongArray out = env->NewLongArray(3);
+  if (out)
+    env->SetLongArrayRegion(out, 0, 3, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgAudioOutput(JNIEnv *env, jobject) {
+  // [acquireUs (-1 = none yet), reused, opens, reuses] of the shared AAudio
+  // output session, then the open stream's [exclusive, performanceMode
+  // (AAUDIO_PERFORMANCE_MODE_*), bufferFrames, burstFrames]
+  jlong values[8] = {gAudioDebug.outputAcquireUs.load(),
+                     gAudioDebug.outputReused.load() ? 1 : 0,
+                     gAudioDebug.outputOpens.load(),
+                     gAudioDebug.outputReuses.load(),
+                     gAudioDebug.outputExclusive.load() ? 1 : 0,
+                     gAudioDebug.outputPerformanceMode.load(),
+                     gAudioDebug.outputBufferFrames.load(),
+                     gAudioDebug.outputBurstFrames.load()};
+  jlongArray out = env->NewLongArray(8);
+  if (out)
+    env->SetLongArrayRegion(out, 0, 8, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgAudioMetrics(JNIEnv *env, jobject) {
+  // Realtime metrics in one batch; layout in AudioDebug::snapshotMetrics.
+  // Each call also starts a new ring fill min/max window.
+  jlong values[AudioDebug::kMetricsSize]; // jlong is int64_t on Android
+  gAudioDebug.snapshotMetrics(values);
+  jlongArray out = env->NewLongArray(AudioDebug::kMetricsSize);
+  if (out)
+    env->SetLongArrayRegion(out, 0, AudioDebug::kMetricsSize, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgDsp(JNIEnv *env, jobject) {
+  // [boost, eqEnabled, nightMode, compressorReduction, limiterReduction],
+  // dB values in hundredths
+  DspParams params;
+  {
+    std::lock_guard<std::mutex> lock(gDspMutex);
+    params = gDspParams;
+  }
+  jlong values[5] = {
+      std::lround(params.boostDb * 100.0f), params.eqEnabled ? 1 : 0,
+      params.nightMode ? 1 : 0,
+      gAudio ? std::lround(gAudio->compressorReductionDb() * 100.0f) : 0,
+      gAudio ? std::lround(gAudio->limiterReductionDb() * 100.0f) : 0};
+  jlongArray out = env->NewLongArray(5);
+  if (out)
+    env->SetLongArrayRegion(out, 0, 5, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgPower(JNIEnv *env, jobject) {
+  // [deepBuffer, outputMode, decodeWakeups, callbackCount]; the overlay
+  // turns the counters into wakeups per minute
+  jlong values[4] = {deepBufferWanted() ? 1 : 0, gOutputMode.load(),
+                     gAudioDebug.decodeWakeups.load(),
+                     gAudioDebug.callbackCount.load()};
+  jlongArray out = env->NewLongArray(4);
+  if (out)
+    env->SetLongArrayRegion(out, 0, 4, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgSeekStats(JNIEnv *env, jobject) {
+  // Last accurate seek: [audioLatencyUs, audioSkippedFrames, videoLatencyUs,
+  //  videoSkippedFrames] (latency -1 = none measured yet), then audio
+  //  [seeksPosted, seeksApplied] (the rest were coalesced), then
+  //  [trackSwitches, trackSwitchUs] of live audio-track switches (last
+  //  request → new track's audio queued, -1 = none yet), then
+  //  [commandsDropped] (queue stayed full)
+  VideoEngine::Stats video = gVideo ? gVideo->stats() : VideoEngine::Stats{};
+  jlong values[9] = {gAudioDebug.seekLatencyUs.load(),
+                     gAudioDebug.seekSkippedFrames.load(),
+                     gVideo ? video.seekLatencyUs : -1,
+                     video.skipped,
+                     gAudioDebug.seeksPosted.load(),
+                     gAudioDebug.seeksApplied.load(),
+                     gAudioDebug.trackSwitches.load(),
+                     gAudioDebug.trackSwitchUs.load(),
+                     gAudioDebug.commandsDropped.load()};
+  jlongArray out = env->NewLongArray(9);
+  if (out)
+    env->SetLongArrayRegion(out, 0, 9, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgVideoPacing(JNIEnv *env, jobject) {
+  // [vsyncPeriodNs, contentFps * 1000, cadence, frames, janks,
+  //  histogram[0..6]] (histogram: vsyncs on screen, [0] = dropped)
+  FramePacer::Stats st = gVideo ? gVideo->pacingStats() : FramePacer::Stats{};
+  constexpr int kCount = 5 + FramePacer::kMaxBucket + 1;
+  jlong values[kCount] = {st.vsyncPeriodNs,
+                          static_cast<jlong>(st.contentFps * 1000.0f),
+                          st.cadence, st.frames, st.janks};
+  for (int i = 0; i <= FramePacer::kMaxBucket; ++i)
+    values[5 + i] = st.histogram[i];
+  jlongArray out = env->NewLongArray(kCount);
+  if (out)
+    env->SetLongArrayRegion(out, 0, kCount, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jlongArray JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgDemuxStats(JNIEnv *env, jobject) {
+  // [queuedBytes, bytesRead, packetsRead, seeks, coalescedSeeks, openUs]
+  std::shared_ptr<Demuxer> demuxer = currentDemuxer(false);
+  Demuxer::Stats st = demuxer ? demuxer->stats() : Demuxer::Stats{};
+  jlong values[6] = {st.queuedBytes, st.bytesRead,      st.packetsRead,
+                     st.seeks,       st.coalescedSeeks, st.openUs};
+  jlongArray out = env->NewLongArray(6);
+  if (out)
+    env->SetLongArrayRegion(out, 0, 6, values);
+  return out;
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_mxlite_app_player_NativePlayer_dbgVideoDecoderName(JNIEnv *env,
+                                                            jobject) {
+  std::string name = gVideo ? gVideo->decoderName() : std::string();
+  return env->NewStringUTF(name.c_str());
+}
+
 extern "C" JNIEXPORT jstring JNICALL
 Java_com_mxlite_app_player_NativePlayer_dbgGetClockLog(JNIEnv *env, jobject) {
   char buf[256];
@@ -264,15 +1192,16 @@ Java_com_mxlite_app_player_NativePlayer_playFdJni(JNIEnv *env,
                                                   jobject /* thiz */, jint fd,
                                                   jlong offset, jlong length) {
 
+  joinOpen();
   if (!gAudio) {
     LOGE("MX-AUDIO", "AudioEngine is NULL, creating new AudioEngine");
-    gAudio = new AudioEngine(&gVirtualClock);
+    gAudio = createAudioEngine();
   }
 
   // Mark native play call for diagnostics
   gAudioDebug.nativePlayCalled.store(true);
 
-  bool ok = gAudio->openFd(fd, offset, length);
+  bool ok = openAudioFd(fd, offset, length);
   if (!ok) {
     LOGE("MX-AUDIO", "openFd FAILED");
     return;
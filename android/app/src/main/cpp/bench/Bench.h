@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+/*
+ * Minimal host microbenchmark harness (no external dependencies).
+ *
+ * Each suite is a plain function registered in BenchMain.cpp. Results are
+ * printed one per line so runs can be diffed between revisions:
+ *
+ *   <suite>/<case>  <value> <unit>
+ */
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             Clock::now().time_since_epoch())
+      .count();
+}
+
+// Prevents the optimizer from discarding a computed value.
+template <typename T> inline void doNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobberMemory() { asm volatile("" : : : "memory"); }
+
+// Runs `fn(iterations)` with growing iteration counts until one run takes at
+// least `minNs`, then returns the elapsed nanoseconds of that run together
+// with the iteration count used.
+struct Timing {
+  int64_t elapsedNs = 0;
+  int64_t iterations = 0;
+};
+
+template <typename Fn>
+Timing measure(Fn &&fn, int64_t minNs = 200 * 1000 * 1000) {
+  int64_t iterations = 1;
+  for (;;) {
+    int64_t start = nowNs();
+    fn(iterations);
+    int64_t elapsed = nowNs() - start;
+    if (elapsed >= minNs || iterations >= (int64_t(1) << 40)) {
+      return {elapsed, iterations};
+    }
+    // Aim a little past the target so the final run is the timed one.
+    int64_t scale = elapsed > 0 ? (minNs * 12 / 10) / elapsed + 1 : 100;
+    if (scale > 100)
+      scale = 100;
+    iterations *= (scale < 2 ? 2 : scale);
+  }
+}
+
+inline void report(const char *suite, const char *name, double value,
+                   const char *unit) {
+  char label[96];
+  snprintf(label, sizeof(label), "%s/%s", suite, name);
+  printf("%-48s %12.3f %s\n", label, value, unit);
+  fflush(stdout);
+}
+
+// Suite filter from the command line (substring match, empty = all).
+inline bool enabled(const char *filter, const char *suite) {
+  return !filter || !*filter || strstr(suite, filter) != nullptr;
+}
+
+} // namespace bench
+
+// Suites (one translation unit each)
+void runRingBench();
+void runClockBench();
+void runPcmBench();
+void runMixBench();
+void runResamplerBench();
+void runPacerBench();
+void runCommandBench();
+void runStretchBench();
+void runDspBench();
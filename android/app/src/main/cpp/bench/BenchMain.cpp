@@ -0,0 +1,35 @@
+#include "Bench.h"
+#include "core/NativeLog.h"
+
+#include <cstdio>
+
+// Usage: mxlite-bench [suite-filter]
+int main(int argc, char **argv) {
+  const char *filter = argc > 1 ? argv[1] : nullptr;
+
+  // VirtualClock logs every state change; keep stderr out of the numbers.
+  mxlite::setHostLogEnabled(false);
+
+  printf("%-48s %12s %s\n", "benchmark", "value", "unit");
+
+  if (bench::enabled(filter, "ring"))
+    runRingBench();
+  if (bench::enabled(filter, "clock"))
+    runClockBench();
+  if (bench::enabled(filter, "pcm"))
+    runPcmBench();
+  if (bench::enabled(filter, "mix"))
+    runMixBench();
+  if (bench::enabled(filter, "resampler"))
+    runResamplerBench();
+  if (bench::enabled(filter, "pacer"))
+    runPacerBench();
+  if (bench::enabled(filter, "command"))
+    runCommandBench();
+  if (bench::enabled(filter, "stretch"))
+    runStretchBench();
+  if (bench::enabled(filter, "dsp"))
+    runDspBench();
+
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include "Bench.h"
+#include "player/VirtualClock.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+ * VirtualClock::positionUs cost with N concurrent readers while a writer
+ * thread keeps mutating the clock (seek-drag / pause / resume), which is the
+ * pattern the video sync loop sees during scrubbing.
+ */
+namespace {
+
+void runReaders(int readers, bool withWriter) {
+  VirtualClock clock;
+  clock.start();
+
+  std::atomic<bool> go{false};
+  std::atomic<bool> stop{false};
+  std::atomic<int64_t> totalNs{0};
+  std::atomic<int64_t> totalQueries{0};
+
+  std::thread writer;
+  if (withWriter) {
+    writer = std::thread([&] {
+      while (!go.load(std::memory_order_acquire)) {
+      }
+      int64_t pos = 0;
+      while (!stop.load(std::memory_order_acquire)) {
+        clock.pause();
+        clock.seekUs(pos += 1000);
+        clock.resume();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    });
+  }
+
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; ++r) {
+    threads.emplace_back([&] {
+      while (!go.load(std::memory_order_acquire)) {
+      }
+      constexpr int kBatch = 4096;
+      int64_t queries = 0;
+      int64_t start = bench::nowNs();
+      while (!stop.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < kBatch; ++i) {
+          bench::doNotOptimize(clock.positionUs());
+        }
+        queries += kBatch;
+      }
+      totalNs.fetch_add(bench::nowNs() - start);
+      totalQueries.fetch_add(queries);
+    });
+  }
+
+  go.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  stop.store(true, std::memory_order_release);
+
+  for (auto &t : threads)
+    t.join();
+  if (writer.joinable())
+    writer.join();
+
+  char name[64];
+  snprintf(name, sizeof(name), "position_%dreader%s", readers,
+           withWriter ? "_writer" : "");
+  bench::report("clock", name, double(totalNs.load()) / totalQueries.load(),
+                "ns/query");
+}
+
+} // namespace
+
+void runClockBench() {
+  for (int readers : {1, 2, 4}) {
+    runReaders(readers, false);
+    runReaders(readers, true);
+  }
+}
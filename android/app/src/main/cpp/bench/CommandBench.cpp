@@ -0,0 +1,152 @@
+#include "Bench.h"
+#include "core/MpscQueue.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Control command post cost (the time a JNI seek/pause call spends before
+ * returning) and drain cost, for a scrub burst from one thread and with N
+ * posting threads contending while the engine thread drains.
+ *
+ * mutex_* is a std::mutex + std::deque queue, mpsc_* is MpscQueue as used
+ * by AudioEngine::post/drainCommands.
+ */
+namespace {
+
+struct Command {
+  int32_t type;
+  int64_t us;
+  int64_t postedUs;
+};
+
+struct MutexAdapter {
+  static constexpr const char *kName = "mutex";
+  std::mutex mutex;
+  std::deque<Command> queue;
+
+  bool push(const Command &command) {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(command);
+    return true;
+  }
+  bool pop(Command &command) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (queue.empty())
+      return false;
+    command = queue.front();
+    queue.pop_front();
+    return true;
+  }
+};
+
+struct MpscAdapter {
+  static constexpr const char *kName = "mpsc";
+  MpscQueue<Command> queue{64};
+
+  bool push(const Command &command) { return queue.push(command); }
+  bool pop(Command &command) { return queue.pop(command); }
+};
+
+// One scrub gesture: the UI thread posts a burst of seeks, the engine
+// thread drains them on its next pass.
+template <typename Queue> void runBurst(int32_t burst) {
+  Queue queue;
+  int64_t pushNs = 0;
+  int64_t popNs = 0;
+  int64_t commands = 0;
+
+  const int64_t budgetNs = 200 * 1000 * 1000;
+  while (pushNs + popNs < budgetNs) {
+    int64_t t0 = bench::nowNs();
+    for (int32_t i = 0; i < burst; ++i)
+      queue.push(Command{2, commands + i, 0});
+    int64_t t1 = bench::nowNs();
+    Command command;
+    int64_t last = 0;
+    while (queue.pop(command))
+      last = command.us;
+    int64_t t2 = bench::nowNs();
+    bench::doNotOptimize(last);
+    pushNs += t1 - t0;
+    popNs += t2 - t1;
+    commands += burst;
+  }
+
+  char name[64];
+  snprintf(name, sizeof(name), "%s_push_burst%d", Queue::kName, burst);
+  bench::report("command", name, double(pushNs) / commands, "ns/push");
+  snprintf(name, sizeof(name), "%s_drain_burst%d", Queue::kName, burst);
+  bench::report("command", name, double(popNs) / commands, "ns/command");
+}
+
+// Posting threads contending while the engine thread drains. Only
+// meaningful with as many cores as threads.
+template <typename Queue> void runProducers(int producers) {
+  Queue queue;
+  std::atomic<bool> go{false};
+  std::atomic<bool> stop{false};
+  std::atomic<int64_t> totalNs{0};
+  std::atomic<int64_t> totalPushes{0};
+
+  std::thread consumer([&] {
+    Command command;
+    int64_t sum = 0;
+    while (!stop.load(std::memory_order_acquire)) {
+      while (queue.pop(command))
+        sum += command.us;
+      bench::doNotOptimize(sum);
+    }
+  });
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p] {
+      while (!go.load(std::memory_order_acquire)) {
+      }
+      int64_t pushes = 0;
+      int64_t elapsed = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        int64_t t0 = bench::nowNs();
+        bool ok = queue.push(Command{2, pushes * 1000 + p, 0});
+        int64_t t1 = bench::nowNs();
+        if (ok) {
+          elapsed += t1 - t0;
+          ++pushes;
+        }
+      }
+      totalNs.fetch_add(elapsed);
+      totalPushes.fetch_add(pushes);
+    });
+  }
+
+  go.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  stop.store(true, std::memory_order_release);
+  for (auto &t : threads)
+    t.join();
+  consumer.join();
+
+  char name[64];
+  snprintf(name, sizeof(name), "%s_push_%dproducer", Queue::kName, producers);
+  bench::report("command", name, double(totalNs.load()) / totalPushes.load(),
+                "ns/push");
+}
+
+} // namespace
+
+void runCommandBench() {
+  for (int32_t burst : {1, 32}) {
+    runBurst<MutexAdapter>(burst);
+    runBurst<MpscAdapter>(burst);
+  }
+  if (std::thread::hardware_concurrency() < 2)
+    return;
+  for (int producers : {1, 2, 4}) {
+    runProducers<MutexAdapter>(producers);
+    runProducers<MpscAdapter>(producers);
+  }
+}
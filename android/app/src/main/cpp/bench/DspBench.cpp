@@ -0,0 +1,75 @@
+#include "Bench.h"
+#include "core/DspChain.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+/*
+ * Output DSP chain cost, stereo 48 kHz, processed in place in 1024-frame
+ * chunks the way AudioEngine::writeRing does.
+ *
+ * "ms/s" is CPU time per second of audio; "% core" the same as a share of
+ * one core (the budget for the whole chain is 1 %).
+ */
+namespace {
+
+constexpr size_t kChunkFrames = 1024;
+constexpr int32_t kChannels = 2;
+constexpr int32_t kRate = 48000;
+
+void runCase(const char *name, const DspParams &params) {
+  DspChain dsp;
+  dsp.configure(kRate, kChannels);
+  dsp.setParams(params);
+  dsp.update();
+
+  // Music-like input near full scale (tone plus noise), so the compressor
+  // and the limiter both have work to do. Processed in place from a fresh
+  // copy each time, as the ring writer does with its scratch buffer.
+  std::vector<float> in(kChunkFrames * kChannels);
+  std::vector<float> work(in.size());
+  srand(1);
+  for (size_t i = 0; i < kChunkFrames; ++i) {
+    float tone = 0.6f * float(std::sin(2.0 * M_PI * 220.0 * double(i) / kRate));
+    float noise = 0.3f * (float(rand()) / float(RAND_MAX) - 0.5f);
+    in[i * kChannels] = tone + noise;
+    in[i * kChannels + 1] = 0.9f * tone - noise;
+  }
+
+  bench::Timing t = bench::measure([&](int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+      std::copy(in.begin(), in.end(), work.begin());
+      dsp.update();
+      dsp.process(work.data(), work.data(), kChunkFrames);
+      bench::clobberMemory();
+    }
+  });
+
+  double seconds = double(t.iterations) * kChunkFrames / kRate;
+  double msPerSecond = double(t.elapsedNs) / 1e6 / seconds;
+
+  char label[64];
+  snprintf(label, sizeof(label), "%s", name);
+  bench::report("dsp", label, msPerSecond, "ms/s");
+  snprintf(label, sizeof(label), "%s_core", name);
+  bench::report("dsp", label, msPerSecond / 10.0, "% core");
+}
+
+} // namespace
+
+void runDspBench() {
+  DspParams boost;
+  boost.boostDb = 6.0f;
+  runCase("boost_limiter", boost);
+
+  DspParams eq = boost;
+  eq.eqEnabled = true;
+  for (int b = 0; b < DspParams::kEqBands; ++b)
+    eq.eqDb[b] = (b % 2 ? -3.0f : 4.0f);
+  runCase("boost_eq10_limiter", eq);
+
+  DspParams full = eq;
+  full.nightMode = true;
+  runCase("full_chain", full);
+}
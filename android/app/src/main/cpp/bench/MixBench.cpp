@@ -0,0 +1,43 @@
+#include "Bench.h"
+#include "core/ChannelMixer.h"
+
+#include <cmath>
+#include <vector>
+
+/*
+ * Channel downmix cost per frame (ITU matrix, default options), fed in
+ * 1024-frame codec buffers like AudioEngine::writeStaged.
+ */
+namespace {
+
+constexpr size_t kFrames = 1024;
+
+void runCase(const char *name, int32_t in, int32_t out) {
+  ChannelMixer mixer;
+  mixer.configure(in, 0, out);
+
+  std::vector<float> src(kFrames * in);
+  std::vector<float> dst(kFrames * out);
+  for (size_t i = 0; i < src.size(); ++i)
+    src[i] = 0.5f * std::sin(float(i) * 0.013f);
+
+  bench::Timing t = bench::measure([&](int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+      mixer.process(src.data(), dst.data(), kFrames);
+      bench::clobberMemory();
+    }
+  });
+  bench::report("mix", name, double(t.elapsedNs) / (t.iterations * kFrames),
+                "ns/frame");
+}
+
+} // namespace
+
+void runMixBench() {
+  runCase("5.1_to_stereo", 6, 2);
+  runCase("7.1_to_stereo", 8, 2);
+  runCase("5.1_to_mono", 6, 1);
+  runCase("7.1_to_5.1", 8, 6);
+  runCase("stereo_to_mono", 2, 1);
+  runCase("mono_to_stereo", 1, 2);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * Reference copy of the PCM ring AudioEngine used before SpscRing: fixed
+ * 192000-sample array, per-sample copy with `head % kCapacity`. Kept only so
+ * the ring benchmark can report old vs. new cost side by side.
+ */
+class ModuloRing {
+public:
+  static constexpr int32_t kCapacity = 192000; // samples (not frames)
+
+  bool write(const int16_t *data, int32_t samples) {
+    int32_t head = writeHead_.load(std::memory_order_relaxed);
+    int32_t tail = readHead_.load(std::memory_order_acquire);
+
+    int32_t available = kCapacity - (head - tail);
+    if (available < samples) {
+      return false;
+    }
+
+    for (int32_t i = 0; i < samples; i++) {
+      buffer_[head % kCapacity] = data[i];
+      head++;
+    }
+
+    writeHead_.store(head, std::memory_order_release);
+    return true;
+  }
+
+  int32_t read(int16_t *out, int32_t samples) {
+    int32_t head = writeHead_.load(std::memory_order_acquire);
+    int32_t tail = readHead_.load(std::memory_order_acquire);
+    int32_t toRead = std::min(samples, head - tail);
+
+    for (int32_t i = 0; i < toRead; i++) {
+      out[i] = buffer_[tail % kCapacity];
+      tail++;
+    }
+    for (int32_t i = toRead; i < samples; i++) {
+      out[i] = 0;
+    }
+
+    readHead_.store(tail, std::memory_order_release);
+    return toRead;
+  }
+
+  void flush() {
+    memset(buffer_, 0, sizeof(buffer_));
+    readHead_.store(0, std::memory_order_release);
+    writeHead_.store(0, std::memory_order_release);
+  }
+
+  int32_t availableSamples() const {
+    return writeHead_.load(std::memory_order_relaxed) -
+           readHead_.load(std::memory_order_relaxed);
+  }
+
+private:
+  int16_t buffer_[kCapacity];
+
+  std::atomic<int32_t> writeHead_{0};
+  std::atomic<int32_t> readHead_{0};
+};
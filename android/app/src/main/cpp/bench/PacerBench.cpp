@@ -0,0 +1,82 @@
+#include "Bench.h"
+#include "core/FramePacer.h"
+
+#include <cstdint>
+#include <random>
+
+/*
+ * FramePacer on synthetic content/refresh combinations: snap() cost per
+ * frame, and janks per 1000 frames against plain nearest-vsync rounding.
+ * Ideal times carry +-1 ms of clock noise (audio slew, scheduling), which is
+ * what makes naive rounding flip cadence on 24p@60.
+ */
+namespace {
+
+constexpr int kFrames = 20000;
+
+void runCase(double fps, double hz) {
+  const int64_t periodNs = static_cast<int64_t>(1e9 / hz);
+  const double frameNs = 1e9 / fps;
+  const int64_t t0 = 1000000000LL;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int64_t> noise(-1000000, 1000000);
+
+  FramePacer pacer;
+  int64_t nextVsync = t0 - 10 * periodNs;
+  int64_t naivePrev = 0;
+  int64_t naiveJanks = 0;
+  int64_t naiveDurations[8] = {};
+  int64_t snapNs = 0;
+
+  for (int k = 0; k < kFrames; ++k) {
+    int64_t ideal = t0 + static_cast<int64_t>(k * frameNs) + noise(rng);
+    // The render loop schedules ~50 ms ahead of the frame.
+    while (nextVsync <= ideal - 50000000) {
+      pacer.onVsync(nextVsync);
+      nextVsync += periodNs;
+    }
+    pacer.onFramePts(static_cast<int64_t>(k * frameNs / 1000.0));
+
+    int64_t start = bench::nowNs();
+    int64_t snapped = pacer.snap(ideal);
+    snapNs += bench::nowNs() - start;
+    bench::doNotOptimize(snapped);
+    pacer.onFrameShown(true);
+
+    // Nearest vsync, no cadence tracking.
+    int64_t n = (ideal - t0 + periodNs / 2) / periodNs;
+    int64_t naive = t0 + n * periodNs;
+    if (k > 0) {
+      // Same criterion as FramePacer: durations must repeat every
+      // `cadence` frames.
+      int32_t q = pacer.stats().cadence;
+      int64_t vsyncs = (naive - naivePrev + periodNs / 2) / periodNs;
+      if (k > q && naiveDurations[(k - q) % 8] != vsyncs)
+        ++naiveJanks;
+      naiveDurations[k % 8] = vsyncs;
+    }
+    naivePrev = naive;
+  }
+
+  FramePacer::Stats st = pacer.stats();
+  char name[64];
+  snprintf(name, sizeof(name), "%gfps_%ghz_snap", fps, hz);
+  bench::report("pacer", name, double(snapNs) / kFrames, "ns/frame");
+  snprintf(name, sizeof(name), "%gfps_%ghz_janks", fps, hz);
+  bench::report("pacer", name, st.janks * 1000.0 / kFrames, "per 1k frames");
+  snprintf(name, sizeof(name), "%gfps_%ghz_naive_janks", fps, hz);
+  bench::report("pacer", name, naiveJanks * 1000.0 / kFrames,
+                "per 1k frames");
+}
+
+} // namespace
+
+void runPacerBench() {
+  runCase(24, 60);
+  runCase(23.976, 60);
+  runCase(25, 60);
+  runCase(30, 60);
+  runCase(24, 90);
+  runCase(24, 120);
+  runCase(60, 120);
+}
@@ -0,0 +1,73 @@
+#include "Bench.h"
+#include "core/PcmConvert.h"
+
+#include <cmath>
+#include <vector>
+
+/*
+ * Sample format conversion throughput (ns per sample, interleaved).
+ *
+ * "scalar_*" is the per-sample floatToPcm16() loop the engine used before the
+ * vectorized kernels; the rest go through convertToFloat/convertFromFloat the
+ * way AudioEngine::writeAudio/renderAudio call them.
+ */
+namespace {
+
+constexpr size_t kSamples = 4096;
+
+template <typename Fn> void run(const char *name, Fn &&fn) {
+  bench::Timing t = bench::measure([&](int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+      fn();
+      bench::clobberMemory();
+    }
+  });
+  bench::report("pcm", name, double(t.elapsedNs) / (t.iterations * kSamples),
+                "ns/sample");
+}
+
+} // namespace
+
+void runPcmBench() {
+  std::vector<float> f(kSamples);
+  std::vector<float> back(kSamples);
+  std::vector<uint8_t> bytes(kSamples * 4);
+  for (size_t i = 0; i < kSamples; ++i)
+    f[i] = 1.2f * std::sin(float(i) * 0.01f); // includes clipped samples
+
+  auto *s16 = reinterpret_cast<int16_t *>(bytes.data());
+  PcmDither dither;
+
+  run("scalar_float_to_i16", [&] {
+    for (size_t i = 0; i < kSamples; ++i)
+      s16[i] = floatToPcm16(f[i]);
+  });
+  run("float_to_i16", [&] {
+    convertFromFloat(PcmEncoding::I16, f.data(), bytes.data(), kSamples,
+                     nullptr);
+  });
+  run("float_to_i16_dither", [&] {
+    convertFromFloat(PcmEncoding::I16, f.data(), bytes.data(), kSamples,
+                     &dither);
+  });
+  run("i16_to_float", [&] {
+    convertToFloat(PcmEncoding::I16, bytes.data(), back.data(), kSamples);
+  });
+
+  run("float_to_i24_dither", [&] {
+    convertFromFloat(PcmEncoding::I24Packed, f.data(), bytes.data(), kSamples,
+                     &dither);
+  });
+  run("i24_to_float", [&] {
+    convertToFloat(PcmEncoding::I24Packed, bytes.data(), back.data(),
+                   kSamples);
+  });
+
+  run("float_to_i32", [&] {
+    convertFromFloat(PcmEncoding::I32, f.data(), bytes.data(), kSamples,
+                     nullptr);
+  });
+  run("i32_to_float", [&] {
+    convertToFloat(PcmEncoding::I32, bytes.data(), back.data(), kSamples);
+  });
+}
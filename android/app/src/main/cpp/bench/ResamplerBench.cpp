@@ -0,0 +1,73 @@
+#include "Bench.h"
+#include "core/Resampler.h"
+
+#include <cmath>
+#include <vector>
+
+/*
+ * Polyphase resampler throughput, stereo, fed in 1024-frame codec buffers the
+ * way AudioEngine::writeAudio does.
+ *
+ * "ns/frame" is per output frame; "x realtime" is how many such streams one
+ * core could convert (output rate / achieved output frames per second).
+ */
+namespace {
+
+constexpr size_t kChunkFrames = 1024;
+constexpr int32_t kChannels = 2;
+
+const char *qualityName(ResamplerQuality q) {
+  switch (q) {
+  case ResamplerQuality::Low:
+    return "low";
+  case ResamplerQuality::Medium:
+    return "medium";
+  case ResamplerQuality::High:
+    return "high";
+  }
+  return "?";
+}
+
+void runCase(int32_t inRate, int32_t outRate, ResamplerQuality quality) {
+  PolyphaseResampler rs;
+  rs.configure(inRate, outRate, kChannels, quality, kChunkFrames);
+
+  std::vector<float> in(kChunkFrames * kChannels);
+  // Worst case over any history fill.
+  std::vector<float> out(rs.maxOutputFrames(kChunkFrames + rs.taps()) *
+                         kChannels);
+  for (size_t i = 0; i < kChunkFrames; ++i) {
+    float v = 0.5f * std::sin(float(i) * 0.05f);
+    in[i * kChannels] = v;
+    in[i * kChannels + 1] = -v;
+  }
+
+  bench::Timing t = bench::measure([&](int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+      bench::doNotOptimize(rs.process(in.data(), kChunkFrames, out.data()));
+      bench::clobberMemory();
+    }
+  });
+
+  double framesPerCall = double(kChunkFrames) * outRate / inRate;
+  double nsPerFrame = double(t.elapsedNs) / (t.iterations * framesPerCall);
+
+  char name[64];
+  snprintf(name, sizeof(name), "%dk_to_%dk_%s", inRate / 1000, outRate / 1000,
+           qualityName(quality));
+  bench::report("resampler", name, nsPerFrame, "ns/frame");
+  snprintf(name, sizeof(name), "%dk_to_%dk_%s_rt", inRate / 1000,
+           outRate / 1000, qualityName(quality));
+  bench::report("resampler", name, 1e9 / (nsPerFrame * outRate),
+                "x realtime");
+}
+
+} // namespace
+
+void runResamplerBench() {
+  for (ResamplerQuality q : {ResamplerQuality::Low, ResamplerQuality::Medium,
+                             ResamplerQuality::High}) {
+    runCase(44100, 48000, q);
+    runCase(96000, 48000, q);
+  }
+}
@@ -0,0 +1,128 @@
+#include "Bench.h"
+#include "ModuloRing.h"
+#include "core/SpscRing.h"
+
+#include <memory>
+#include <vector>
+
+/*
+ * Ring buffer produce/consume cost per audio frame.
+ *
+ * Models the real traffic pattern: the decode thread writes whole codec
+ * buffers (1024 frames, one AAC access unit) and the AAudio callback drains
+ * bursts of 192 frames (4 ms @ 48 kHz). "consume" is the per-frame cost the
+ * realtime callback pays.
+ *
+ * modulo_* is the pre-SpscRing AudioEngine ring (per-sample `%`), spsc_* is
+ * SpscRing<int16_t> driven the way AudioEngine::writeAudio/renderAudio do.
+ */
+namespace {
+
+constexpr int32_t kCodecFrames = 1024;
+constexpr int32_t kCallbackFrames = 192;
+
+struct ModuloAdapter {
+  static constexpr const char *kName = "modulo";
+  ModuloRing ring;
+
+  bool produce(const int16_t *data, int32_t samples) {
+    return ring.write(data, samples);
+  }
+  void consume(int16_t *out, int32_t samples) { ring.read(out, samples); }
+  int32_t available() const { return ring.availableSamples(); }
+  void flush() { ring.flush(); }
+};
+
+struct SpscAdapter {
+  static constexpr const char *kName = "spsc";
+  SpscRing<int16_t> ring{1 << 18};
+
+  bool produce(const int16_t *data, int32_t samples) {
+    SpscRing<int16_t>::Span span = ring.acquireWrite(samples);
+    if (span.size() < static_cast<size_t>(samples))
+      return false;
+    memcpy(span.first, data, span.firstCount * sizeof(int16_t));
+    memcpy(span.second, data + span.firstCount,
+           span.secondCount * sizeof(int16_t));
+    ring.commitWrite(samples);
+    return true;
+  }
+  void consume(int16_t *out, int32_t samples) {
+    size_t got = ring.read(out, samples);
+    if (got < static_cast<size_t>(samples))
+      memset(out + got, 0, (samples - got) * sizeof(int16_t));
+  }
+  int32_t available() const {
+    return static_cast<int32_t>(ring.availableToRead());
+  }
+  void flush() { ring.reset(); }
+};
+
+template <typename Ring> void runChannels(int32_t channels) {
+  auto ring = std::make_unique<Ring>();
+  std::vector<int16_t> in(kCodecFrames * channels);
+  std::vector<int16_t> out(kCallbackFrames * channels);
+  for (size_t i = 0; i < in.size(); ++i)
+    in[i] = static_cast<int16_t>(i * 37);
+
+  int64_t writeNs = 0;
+  int64_t readNs = 0;
+  int64_t framesWritten = 0;
+  int64_t framesRead = 0;
+
+  const int64_t budgetNs = 300 * 1000 * 1000;
+  while (writeNs + readNs < budgetNs) {
+    int64_t t0 = bench::nowNs();
+    bool ok = ring->produce(in.data(), kCodecFrames * channels);
+    int64_t t1 = bench::nowNs();
+    if (ok) {
+      writeNs += t1 - t0;
+      framesWritten += kCodecFrames;
+    }
+
+    // Drain roughly what we produced, one callback burst at a time.
+    while (ring->available() >= kCallbackFrames * channels) {
+      t0 = bench::nowNs();
+      ring->consume(out.data(), kCallbackFrames * channels);
+      t1 = bench::nowNs();
+      bench::doNotOptimize(out[0]);
+      readNs += t1 - t0;
+      framesRead += kCallbackFrames;
+    }
+  }
+
+  char name[64];
+  snprintf(name, sizeof(name), "%s_produce_%dch", Ring::kName, channels);
+  bench::report("ring", name, double(writeNs) / framesWritten, "ns/frame");
+  snprintf(name, sizeof(name), "%s_consume_%dch", Ring::kName, channels);
+  bench::report("ring", name, double(readNs) / framesRead, "ns/frame");
+}
+
+// flushRingBuffer() runs on every seek.
+template <typename Ring> void runFlush() {
+  auto ring = std::make_unique<Ring>();
+  bench::Timing t = bench::measure(
+      [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+          ring->flush();
+          bench::clobberMemory();
+        }
+      },
+      50 * 1000 * 1000);
+
+  char name[64];
+  snprintf(name, sizeof(name), "%s_flush", Ring::kName);
+  bench::report("ring", name, double(t.elapsedNs) / t.iterations / 1000.0,
+                "us/call");
+}
+
+} // namespace
+
+void runRingBench() {
+  for (int32_t channels : {1, 2, 6, 8}) {
+    runChannels<ModuloAdapter>(channels);
+    runChannels<SpscAdapter>(channels);
+  }
+  runFlush<ModuloAdapter>();
+  runFlush<SpscAdapter>();
+}
@@ -0,0 +1,61 @@
+#include "Bench.h"
+#include "core/TimeStretch.h"
+
+#include <cmath>
+#include <vector>
+
+/*
+ * WSOLA time-stretch cost, stereo 48 kHz, fed in 1024-frame chunks the way
+ * AudioEngine::pumpHistory does.
+ *
+ * "ms/s" is CPU time per second of played (output) audio at that rate, i.e.
+ * the share of one core the stage takes during playback; "x realtime" is its
+ * inverse.
+ */
+namespace {
+
+constexpr size_t kChunkFrames = 1024;
+constexpr int32_t kChannels = 2;
+constexpr int32_t kRate = 48000;
+
+void runCase(float rate) {
+  TimeStretcher ts;
+  ts.configure(kRate, kChannels, kChunkFrames);
+  ts.setRate(rate);
+
+  // Speech-like input: a gliding harmonic tone, so the search has work to do.
+  std::vector<float> in(kChunkFrames * kChannels);
+  std::vector<float> out(ts.maxOutputFramesPerCall() * kChannels);
+  double phase = 0.0;
+  for (size_t i = 0; i < kChunkFrames; ++i) {
+    phase += 2.0 * M_PI * (140.0 + 20.0 * std::sin(double(i) * 0.003)) / kRate;
+    float v = float(0.4 * std::sin(phase) + 0.2 * std::sin(3.0 * phase));
+    in[i * kChannels] = v;
+    in[i * kChannels + 1] = 0.8f * v;
+  }
+
+  int64_t produced = 0;
+  bench::Timing t = bench::measure([&](int64_t n) {
+    produced = 0;
+    for (int64_t i = 0; i < n; ++i) {
+      produced += int64_t(ts.process(in.data(), kChunkFrames, out.data()));
+      bench::clobberMemory();
+    }
+  });
+
+  double outSeconds = double(produced) / kRate;
+  double msPerSecond = double(t.elapsedNs) / 1e6 / outSeconds;
+
+  char name[64];
+  snprintf(name, sizeof(name), "rate_%.2f", rate);
+  bench::report("stretch", name, msPerSecond, "ms/s");
+  snprintf(name, sizeof(name), "rate_%.2f_rt", rate);
+  bench::report("stretch", name, 1000.0 / msPerSecond, "x realtime");
+}
+
+} // namespace
+
+void runStretchBench() {
+  for (float rate : {0.5f, 0.75f, 1.25f, 1.5f, 2.0f, 3.0f})
+    runCase(rate);
+}
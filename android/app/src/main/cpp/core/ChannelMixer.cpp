@@ -0,0 +1,306 @@
+#include "ChannelMixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MX_MIX_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MX_MIX_SSE2 1
+#endif
+
+using namespace channelmask;
+
+uint32_t channelmask::defaultForCount(int32_t channels) {
+  switch (channels) {
+  case 1:
+    return kFrontLeft; // CHANNEL_OUT_MONO
+  case 2:
+    return kFrontLeft | kFrontRight;
+  case 3:
+    return kFrontLeft | kFrontRight | kFrontCenter;
+  case 4: // quad
+    return kFrontLeft | kFrontRight | kBackLeft | kBackRight;
+  case 5: // quad + center
+    return kFrontLeft | kFrontRight | kFrontCenter | kBackLeft | kBackRight;
+  case 6: // 5.1
+    return kFrontLeft | kFrontRight | kFrontCenter | kLowFrequency |
+           kBackLeft | kBackRight;
+  case 7: // 6.1
+    return defaultForCount(6) | kBackCenter;
+  case 8: // 7.1
+    return defaultForCount(6) | kSideLeft | kSideRight;
+  default:
+    return 0;
+  }
+}
+
+namespace {
+
+constexpr float kMinus3dB = 0.70710678f;
+
+int popcount(uint32_t v) { return __builtin_popcount(v); }
+
+// Output slot of `bit` in `mask`, or -1 when the layout lacks it.
+int slotOf(uint32_t mask, uint32_t bit) {
+  return (mask & bit) ? popcount(mask & (bit - 1)) : -1;
+}
+
+// Builds [out][in] gains from inMask into a layout of >= 2 channels.
+void buildMatrix(float rows[][ChannelMixer::kMaxChannels], uint32_t inMask,
+                 int32_t inChannels, uint32_t outMask,
+                 const DownmixOptions &options) {
+  auto add = [&](uint32_t bit, int in, float gain) {
+    int out = slotOf(outMask, bit);
+    if (out < 0)
+      return false;
+    rows[out][in] += gain;
+    return true;
+  };
+  auto addPair = [&](uint32_t left, uint32_t right, int in, float gain) {
+    bool l = add(left, in, gain);
+    bool r = add(right, in, gain);
+    return l || r;
+  };
+
+  if (inChannels == 1) {
+    // Mono plays on both front speakers.
+    addPair(kFrontLeft, kFrontRight, 0, 1.0f);
+    return;
+  }
+
+  // Surround pairs fold into the other surround pair when present, else into
+  // the front pair, always at -3 dB.
+  int in = 0;
+  for (uint32_t bit = 1; bit != 0 && in < inChannels; bit <<= 1) {
+    if (!(inMask & bit))
+      continue;
+
+    if (add(bit, in, 1.0f)) {
+      ++in;
+      continue;
+    }
+
+    switch (bit) {
+    case kFrontCenter:
+      addPair(kFrontLeft, kFrontRight, in, options.centerGain * kMinus3dB);
+      break;
+    case kLowFrequency:
+      if (options.lfeGain > 0.0f && !add(kFrontCenter, in, options.lfeGain))
+        addPair(kFrontLeft, kFrontRight, in, options.lfeGain * kMinus3dB);
+      break;
+    case kBackLeft:
+      if (!add(kSideLeft, in, kMinus3dB))
+        add(kFrontLeft, in, kMinus3dB);
+      break;
+    case kBackRight:
+      if (!add(kSideRight, in, kMinus3dB))
+        add(kFrontRight, in, kMinus3dB);
+      break;
+    case kSideLeft:
+      if (!add(kBackLeft, in, kMinus3dB))
+        add(kFrontLeft, in, kMinus3dB);
+      break;
+    case kSideRight:
+      if (!add(kBackRight, in, kMinus3dB))
+        add(kFrontRight, in, kMinus3dB);
+      break;
+    case kBackCenter:
+      if (!addPair(kBackLeft, kBackRight, in, kMinus3dB) &&
+          !addPair(kSideLeft, kSideRight, in, kMinus3dB))
+        addPair(kFrontLeft, kFrontRight, in, 0.5f);
+      break;
+    case kFrontLeftOfCenter:
+      add(kFrontLeft, in, 1.0f);
+      break;
+    case kFrontRightOfCenter:
+      add(kFrontRight, in, 1.0f);
+      break;
+    default: // top / unknown positions
+      addPair(kFrontLeft, kFrontRight, in, 0.5f);
+      break;
+    }
+    ++in;
+  }
+}
+
+} // namespace
+
+/* ───────── Kernels ───────── */
+
+struct ChannelMixerKernels {
+  // Up to 4 outputs: one accumulator vector per frame, built from the input
+  // samples broadcast against the matrix columns.
+  template <int In, int Out>
+  static void small(const ChannelMixer &m, const float *in, float *out,
+                    size_t frames) {
+#if MX_MIX_NEON
+    float32x4_t c[In];
+    for (int i = 0; i < In; ++i)
+      c[i] = vld1q_f32(m.cols_[i]);
+    for (size_t f = 0; f < frames; ++f, in += In, out += Out) {
+      float32x4_t acc = vmulq_n_f32(c[0], in[0]);
+      for (int i = 1; i < In; ++i)
+        acc = vmlaq_n_f32(acc, c[i], in[i]);
+      if (Out == 4) {
+        vst1q_f32(out, acc);
+      } else if (Out >= 2) {
+        vst1_f32(out, vget_low_f32(acc));
+        if (Out == 3)
+          vst1q_lane_f32(out + 2, acc, 2);
+      } else {
+        vst1q_lane_f32(out, acc, 0);
+      }
+    }
+#elif MX_MIX_SSE2
+    __m128 c[In];
+    for (int i = 0; i < In; ++i)
+      c[i] = _mm_load_ps(m.cols_[i]);
+    for (size_t f = 0; f < frames; ++f, in += In, out += Out) {
+      __m128 acc = _mm_mul_ps(c[0], _mm_set1_ps(in[0]));
+      for (int i = 1; i < In; ++i)
+        acc = _mm_add_ps(acc, _mm_mul_ps(c[i], _mm_set1_ps(in[i])));
+      if (Out == 4) {
+        _mm_storeu_ps(out, acc);
+      } else if (Out >= 2) {
+        _mm_storel_pi(reinterpret_cast<__m64 *>(out), acc);
+        if (Out == 3)
+          _mm_store_ss(out + 2, _mm_movehl_ps(acc, acc));
+      } else {
+        _mm_store_ss(out, acc);
+      }
+    }
+#else
+    for (size_t f = 0; f < frames; ++f, in += In, out += Out) {
+      for (int o = 0; o < Out; ++o) {
+        float sum = 0.0f;
+        for (int i = 0; i < In; ++i)
+          sum += m.rows_[o][i] * in[i];
+        out[o] = sum;
+      }
+    }
+#endif
+  }
+
+  // Wider outputs (e.g. 7.1 -> 5.1): rare, plain row loops.
+  static void generic(const ChannelMixer &m, const float *in, float *out,
+                      size_t frames) {
+    const int inCh = m.inChannels_;
+    const int outCh = m.outChannels_;
+    for (size_t f = 0; f < frames; ++f, in += inCh, out += outCh) {
+      for (int o = 0; o < outCh; ++o) {
+        float sum = 0.0f;
+        for (int i = 0; i < inCh; ++i)
+          sum += m.rows_[o][i] * in[i];
+        out[o] = sum;
+      }
+    }
+  }
+
+  template <int Out> static ChannelMixer::Kernel pick(int in) {
+    switch (in) {
+    case 1:
+      return &small<1, Out>;
+    case 2:
+      return &small<2, Out>;
+    case 3:
+      return &small<3, Out>;
+    case 4:
+      return &small<4, Out>;
+    case 5:
+      return &small<5, Out>;
+    case 6:
+      return &small<6, Out>;
+    case 7:
+      return &small<7, Out>;
+    case 8:
+      return &small<8, Out>;
+    default:
+      return &generic;
+    }
+  }
+
+  static ChannelMixer::Kernel pick(int in, int out) {
+    switch (out) {
+    case 1:
+      return pick<1>(in);
+    case 2:
+      return pick<2>(in);
+    case 3:
+      return pick<3>(in);
+    case 4:
+      return pick<4>(in);
+    default:
+      return &generic;
+    }
+  }
+};
+
+/* ───────── ChannelMixer ───────── */
+
+bool ChannelMixer::configure(int32_t inChannels, uint32_t inMask,
+                             int32_t outChannels,
+                             const DownmixOptions &options) {
+  active_ = false;
+  if (inChannels < 1 || inChannels > kMaxChannels || outChannels < 1 ||
+      outChannels > kMaxChannels)
+    return false;
+
+  inChannels_ = inChannels;
+  outChannels_ = outChannels;
+  for (auto &row : rows_)
+    std::fill(std::begin(row), std::end(row), 0.0f);
+
+  if (popcount(inMask) != inChannels)
+    inMask = defaultForCount(inChannels);
+
+  if (inMask == 0) {
+    // Unknown layout of this size: pass through what lines up.
+    for (int32_t c = 0; c < std::min(inChannels, outChannels); ++c)
+      rows_[c][c] = 1.0f;
+  } else if (outChannels == 1) {
+    // Mono: average of the stereo downmix.
+    float stereo[kMaxChannels][kMaxChannels] = {};
+    buildMatrix(stereo, inMask, inChannels, defaultForCount(2), options);
+    for (int32_t i = 0; i < inChannels; ++i)
+      rows_[0][i] = 0.5f * (stereo[0][i] + stereo[1][i]);
+  } else {
+    buildMatrix(rows_, inMask, inChannels, defaultForCount(outChannels),
+                options);
+  }
+
+  if (options.normalize) {
+    float peak = 0.0f;
+    for (int32_t o = 0; o < outChannels; ++o) {
+      float sum = 0.0f;
+      for (int32_t i = 0; i < inChannels; ++i)
+        sum += std::fabs(rows_[o][i]);
+      peak = std::max(peak, sum);
+    }
+    if (peak > 1.0f) {
+      for (int32_t o = 0; o < outChannels; ++o)
+        for (int32_t i = 0; i < inChannels; ++i)
+          rows_[o][i] /= peak;
+    }
+  }
+
+  bool identity = inChannels == outChannels;
+  for (int32_t o = 0; o < outChannels && identity; ++o)
+    for (int32_t i = 0; i < inChannels && identity; ++i)
+      identity = rows_[o][i] == (o == i ? 1.0f : 0.0f);
+
+  for (int32_t i = 0; i < kMaxChannels; ++i)
+    for (int32_t o = 0; o < 4; ++o)
+      cols_[i][o] = o < outChannels ? rows_[o][i] : 0.0f;
+
+  kernel_ = ChannelMixerKernels::pick(inChannels, outChannels);
+  active_ = !identity;
+  return true;
+}
+
+void ChannelMixer::process(const float *in, float *out, size_t frames) const {
+  kernel_(*this, in, out, frames);
+}
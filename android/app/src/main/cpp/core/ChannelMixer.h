@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* ===================== Channel layouts ===================== */
+
+// android.media.AudioFormat CHANNEL_OUT_* bits (also MediaFormat
+// "channel-mask"). Interleaved PCM carries the present channels in
+// ascending bit order.
+namespace channelmask {
+constexpr uint32_t kFrontLeft = 0x4;
+constexpr uint32_t kFrontRight = 0x8;
+constexpr uint32_t kFrontCenter = 0x10;
+constexpr uint32_t kLowFrequency = 0x20;
+constexpr uint32_t kBackLeft = 0x40;
+constexpr uint32_t kBackRight = 0x80;
+constexpr uint32_t kFrontLeftOfCenter = 0x100;
+constexpr uint32_t kFrontRightOfCenter = 0x200;
+constexpr uint32_t kBackCenter = 0x400;
+constexpr uint32_t kSideLeft = 0x800;
+constexpr uint32_t kSideRight = 0x1000;
+
+// Canonical layout for a channel count (mono .. 7.1), as used by AAudio and
+// by decoders that do not report a mask. 0 for unsupported counts.
+uint32_t defaultForCount(int32_t channels);
+} // namespace channelmask
+
+/* ===================== Channel mixer ===================== */
+
+struct DownmixOptions {
+  // Extra gain on the center channel when it is folded into L/R (dialog
+  // boost); 1 = ITU.
+  float centerGain = 1.0f;
+  // Gain for LFE when the output has no LFE channel; ITU drops it (0).
+  float lfeGain = 0.0f;
+  // Scale the matrix so no output can exceed full scale.
+  bool normalize = true;
+};
+
+/*
+ * Interleaved float channel remapping / downmix (ITU-R BS.775 coefficients:
+ * center and surrounds at -3 dB into the front pair).
+ *
+ * process() is a matrix multiply with kernels specialised per input/output
+ * channel count; outputs up to 4 channels are one SIMD accumulator per frame
+ * (NEON/SSE2). No allocation; configure() only fills fixed-size tables.
+ */
+class ChannelMixer {
+public:
+  static constexpr int32_t kMaxChannels = 8;
+
+  // inMask may be 0 (or inconsistent with inChannels): the default layout is
+  // used then. Returns false for unsupported channel counts.
+  bool configure(int32_t inChannels, uint32_t inMask, int32_t outChannels,
+                 const DownmixOptions &options = DownmixOptions());
+
+  // False when the mapping is the identity (callers bypass it).
+  bool active() const { return active_; }
+  int32_t inChannels() const { return inChannels_; }
+  int32_t outChannels() const { return outChannels_; }
+  float coefficient(int32_t out, int32_t in) const { return rows_[out][in]; }
+
+  void process(const float *in, float *out, size_t frames) const;
+
+  using Kernel = void (*)(const ChannelMixer &mixer, const float *in,
+                          float *out, size_t frames);
+
+private:
+  bool active_ = false;
+  int32_t inChannels_ = 0;
+  int32_t outChannels_ = 0;
+  Kernel kernel_ = nullptr;
+
+  float rows_[kMaxChannels][kMaxChannels] = {}; // [out][in]
+  // Column-major copy padded to 4 outputs (SIMD kernels, outChannels <= 4).
+  alignas(16) float cols_[kMaxChannels][4] = {};
+
+  friend struct ChannelMixerKernels;
+};
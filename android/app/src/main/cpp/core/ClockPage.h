@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Master clock timeline in a fixed, shareable memory layout.
+ *
+ * Same single-writer sequence protocol as Seqlock<T>, but with every field at
+ * a known offset so the block can be handed out as a direct ByteBuffer.
+ * Kotlin readers (ClockSnapshot.kt) then get the clock with a few loads and
+ * System.nanoTime(), without a JNI transition.
+ *
+ * Layout (little-endian, byte offsets; keep ClockSnapshot.kt in sync):
+ *    0  uint32 seq       odd while a write is in progress
+ *    4  int32  running
+ *    8  int64  baseUs    CLOCK_MONOTONIC, same base as System.nanoTime()
+ *   16  int64  offsetUs
+ *   24  int32  slewPpm
+ *   28  int32  rateMilli  playback rate, 1000 = 1x
+ *
+ * position = offsetUs + r + r * slewPpm / 1e6,
+ *   r = max(0, now - baseUs) * rateMilli / 1000
+ * (if running; a baseUs in the future holds the position until then)
+ *
+ * Writers must serialize among themselves; readers never block them.
+ */
+class alignas(64) ClockPage {
+public:
+  struct Snapshot {
+    int64_t baseUs;
+    int64_t offsetUs;
+    int32_t slewPpm;
+    int32_t running;
+    int32_t rateMilli = 1000;
+  };
+
+  static constexpr size_t kSeqOffset = 0;
+  static constexpr size_t kRunningOffset = 4;
+  static constexpr size_t kBaseOffset = 8;
+  static constexpr size_t kOffsetOffset = 16;
+  static constexpr size_t kSlewOffset = 24;
+  static constexpr size_t kRateOffset = 28;
+
+  ClockPage() { store(Snapshot{0, 0, 0, 0}); }
+
+  ClockPage(const ClockPage &) = delete;
+  ClockPage &operator=(const ClockPage &) = delete;
+
+  void store(const Snapshot &s) {
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    running_.store(s.running, std::memory_order_relaxed);
+    baseUs_.store(s.baseUs, std::memory_order_relaxed);
+    offsetUs_.store(s.offsetUs, std::memory_order_relaxed);
+    slewPpm_.store(s.slewPpm, std::memory_order_relaxed);
+    rateMilli_.store(s.rateMilli, std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  Snapshot load() const {
+    Snapshot s;
+    while (!tryLoad(&s)) {
+    }
+    return s;
+  }
+
+  // One attempt; false if a write was in progress or completed meanwhile.
+  bool tryLoad(Snapshot *out) const {
+    uint32_t before = seq_.load(std::memory_order_acquire);
+    if (before & 1u)
+      return false;
+    Snapshot s;
+    s.running = running_.load(std::memory_order_relaxed);
+    s.baseUs = baseUs_.load(std::memory_order_relaxed);
+    s.offsetUs = offsetUs_.load(std::memory_order_relaxed);
+    s.slewPpm = slewPpm_.load(std::memory_order_relaxed);
+    s.rateMilli = rateMilli_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq_.load(std::memory_order_relaxed) != before)
+      return false;
+    *out = s;
+    return true;
+  }
+
+  static int64_t positionAt(const Snapshot &s, int64_t nowUs) {
+    if (!s.running)
+      return s.offsetUs;
+    int64_t elapsed = nowUs > s.baseUs ? nowUs - s.baseUs : 0;
+    int64_t media = elapsed * s.rateMilli / 1000;
+    return s.offsetUs + media + media * s.slewPpm / 1000000;
+  }
+
+  // Monotonic time (us) at which a running clock reaches `positionUs`; the
+  // inverse of positionAt(). Meaningless when the clock is paused.
+  static int64_t timeAtPosition(const Snapshot &s, int64_t positionUs) {
+    int64_t delta = positionUs - s.offsetUs;
+    int64_t media = delta * 1000000 / (1000000 + s.slewPpm);
+    return s.baseUs + media * 1000 / s.rateMilli;
+  }
+
+  int64_t positionUs(int64_t nowUs) const { return positionAt(load(), nowUs); }
+
+  // Start of the shared block and its size, for NewDirectByteBuffer.
+  void *data() { return this; }
+  static constexpr size_t size() { return 32; }
+
+private:
+  std::atomic<uint32_t> seq_{0};
+  std::atomic<int32_t> running_{0};
+  std::atomic<int64_t> baseUs_{0};
+  std::atomic<int64_t> offsetUs_{0};
+  std::atomic<int32_t> slewPpm_{0};
+  std::atomic<int32_t> rateMilli_{1000};
+
+  friend struct ClockPageLayoutCheck;
+};
+
+struct ClockPageLayoutCheck {
+  static_assert(std::atomic<int64_t>::is_always_lock_free,
+                "ClockPage needs lock-free 64-bit atomics");
+  static_assert(sizeof(std::atomic<int64_t>) == 8 &&
+                    sizeof(std::atomic<int32_t>) == 4 &&
+                    sizeof(std::atomic<uint32_t>) == 4,
+                "ClockPage fields must have plain integer layout");
+  static_assert(offsetof(ClockPage, seq_) == ClockPage::kSeqOffset, "seq");
+  static_assert(offsetof(ClockPage, running_) == ClockPage::kRunningOffset,
+                "running");
+  static_assert(offsetof(ClockPage, baseUs_) == ClockPage::kBaseOffset,
+                "baseUs");
+  static_assert(offsetof(ClockPage, offsetUs_) == ClockPage::kOffsetOffset,
+                "offsetUs");
+  static_assert(offsetof(ClockPage, slewPpm_) == ClockPage::kSlewOffset,
+                "slewPpm");
+  static_assert(offsetof(ClockPage, rateMilli_) == ClockPage::kRateOffset,
+                "rateMilli");
+};
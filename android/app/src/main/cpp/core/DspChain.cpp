@@ -0,0 +1,378 @@
+#include "DspChain.h"
+#include "NativeLog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MX_DSP_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MX_DSP_SSE2 1
+#endif
+
+#define LOG_TAG "DspChain"
+
+namespace {
+
+// One octave per band.
+constexpr double kEqQ = 1.41421356;
+constexpr float kFlatDb = 0.05f;
+
+// Night mode: compresses above -30 dBFS at 4:1 and makes up 9 dB, so quiet
+// dialogue comes up and explosions come down.
+constexpr float kCompThresholdDb = -30.0f;
+constexpr float kCompRatio = 4.0f;
+constexpr float kCompKneeDb = 10.0f;
+constexpr float kCompMakeupDb = 9.0f;
+constexpr double kCompAttackMs = 5.0;
+constexpr double kCompReleaseMs = 200.0;
+
+constexpr double kLookaheadMs = 1.5;
+constexpr double kLimiterReleaseMs = 80.0;
+
+// Below this a filter state is a denormal in the making.
+constexpr float kDenormal = 1e-20f;
+
+float dbToGain(float db) { return std::pow(10.0f, db / 20.0f); }
+
+// Per-frame coefficient of a one-pole follower with time constant `ms`.
+float followerCoef(double ms, int32_t sampleRate) {
+  return float(1.0 - std::exp(-1000.0 / (ms * double(sampleRate))));
+}
+
+// Compressor gain reduction (dB, >= 0) at envelope level `env`.
+float compressorReduction(float env) {
+  float levelDb = 20.0f * std::log10(std::max(env, 1e-6f));
+  float over = levelDb - kCompThresholdDb;
+  float slope = 1.0f - 1.0f / kCompRatio;
+  if (2.0f * over <= -kCompKneeDb)
+    return 0.0f;
+  if (2.0f * over >= kCompKneeDb)
+    return over * slope;
+  float x = over + kCompKneeDb / 2.0f;
+  return slope * x * x / (2.0f * kCompKneeDb);
+}
+
+// One biquad section (transposed direct form II) over a block of
+// four-lane frames. c: b0 b1 b2 a1 a2; z: z1[4], z2[4].
+void biquadBlock(float *lanes, size_t frames, const float *c, float *z) {
+#if MX_DSP_NEON
+  const float32x4_t b0 = vdupq_n_f32(c[0]);
+  const float32x4_t b1 = vdupq_n_f32(c[1]);
+  const float32x4_t b2 = vdupq_n_f32(c[2]);
+  const float32x4_t a1 = vdupq_n_f32(c[3]);
+  const float32x4_t a2 = vdupq_n_f32(c[4]);
+  float32x4_t z1 = vld1q_f32(z);
+  float32x4_t z2 = vld1q_f32(z + 4);
+  for (size_t f = 0; f < frames; ++f) {
+    float32x4_t x = vld1q_f32(lanes + f * 4);
+    float32x4_t y = vmlaq_f32(z1, b0, x);
+    z1 = vmlsq_f32(vmlaq_f32(z2, b1, x), a1, y);
+    z2 = vmlsq_f32(vmulq_f32(b2, x), a2, y);
+    vst1q_f32(lanes + f * 4, y);
+  }
+  vst1q_f32(z, z1);
+  vst1q_f32(z + 4, z2);
+#elif MX_DSP_SSE2
+  const __m128 b0 = _mm_set1_ps(c[0]);
+  const __m128 b1 = _mm_set1_ps(c[1]);
+  const __m128 b2 = _mm_set1_ps(c[2]);
+  const __m128 a1 = _mm_set1_ps(c[3]);
+  const __m128 a2 = _mm_set1_ps(c[4]);
+  __m128 z1 = _mm_loadu_ps(z);
+  __m128 z2 = _mm_loadu_ps(z + 4);
+  for (size_t f = 0; f < frames; ++f) {
+    __m128 x = _mm_load_ps(lanes + f * 4);
+    __m128 y = _mm_add_ps(z1, _mm_mul_ps(b0, x));
+    z1 = _mm_sub_ps(_mm_add_ps(z2, _mm_mul_ps(b1, x)), _mm_mul_ps(a1, y));
+    z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+    _mm_store_ps(lanes + f * 4, y);
+  }
+  _mm_storeu_ps(z, z1);
+  _mm_storeu_ps(z + 4, z2);
+#else
+  for (int lane = 0; lane < 4; ++lane) {
+    float z1 = z[lane];
+    float z2 = z[4 + lane];
+    for (size_t f = 0; f < frames; ++f) {
+      float x = lanes[f * 4 + lane];
+      float y = c[0] * x + z1;
+      z1 = c[1] * x - c[3] * y + z2;
+      z2 = c[2] * x - c[4] * y;
+      lanes[f * 4 + lane] = y;
+    }
+    z[lane] = z1;
+    z[4 + lane] = z2;
+  }
+#endif
+  for (int i = 0; i < 8; ++i) {
+    if (std::fabs(z[i]) < kDenormal)
+      z[i] = 0.0f;
+  }
+}
+
+} // namespace
+
+bool DspChain::configure(int32_t sampleRate, int32_t channels) {
+  configured_ = false;
+  active_ = false;
+  if (sampleRate <= 0 || channels <= 0 || channels > kMaxChannels)
+    return false;
+
+  sampleRate_ = sampleRate;
+  channels_ = channels;
+  compAttack_ = followerCoef(kCompAttackMs, sampleRate);
+  compRelease_ = followerCoef(kCompReleaseMs, sampleRate);
+  ceiling_ = dbToGain(kCeilingDb);
+  limRelease_ = followerCoef(kLimiterReleaseMs, sampleRate);
+
+  lookahead_ = std::max<size_t>(
+      1, size_t(std::lround(kLookaheadMs * sampleRate / 1000.0)));
+  delay_.assign(lookahead_ * size_t(channels), 0.0f);
+  box_.assign(lookahead_, 1.0f);
+  minValue_.assign(lookahead_ + 1, 1.0f);
+  minFrame_.assign(lookahead_ + 1, 0);
+
+  std::fill(std::begin(bandActive_), std::end(bandActive_), false);
+  configured_ = true;
+  reset();
+  applyParams(params_.load());
+  appliedSeq_ = params_.sequence();
+  MX_LOGD(LOG_TAG, "%d Hz, %d ch, look-ahead %zu frames", sampleRate,
+          channels, lookahead_);
+  return true;
+}
+
+void DspChain::update() {
+  uint32_t seq = params_.sequence();
+  if (seq == appliedSeq_ || !configured_)
+    return;
+  DspParams params;
+  if (!params_.tryLoad(&params))
+    return; // mid-write: next block
+  appliedSeq_ = seq;
+  applyParams(params);
+}
+
+void DspChain::applyParams(const DspParams &params) {
+  float boostDb = std::clamp(params.boostDb, 0.0f, kMaxBoostDb);
+  gainTarget_ = dbToGain(boostDb);
+
+  sectionCount_ = 0;
+  for (int b = 0; b < kEqBands; ++b) {
+    float db = std::clamp(params.eqDb[b], -kMaxEqDb, kMaxEqDb);
+    double hz = kEqBandHz[b];
+    if (!params.eqEnabled || std::fabs(db) < kFlatDb ||
+        hz >= 0.45 * sampleRate_) {
+      bandActive_[b] = false;
+      continue;
+    }
+
+    // RBJ peaking EQ, normalized by a0.
+    double a = std::pow(10.0, db / 40.0);
+    double w0 = 2.0 * M_PI * hz / sampleRate_;
+    double alpha = std::sin(w0) / (2.0 * kEqQ);
+    double cosw = std::cos(w0);
+    double a0 = 1.0 + alpha / a;
+    coef_[b][0] = float((1.0 + alpha * a) / a0);
+    coef_[b][1] = float(-2.0 * cosw / a0);
+    coef_[b][2] = float((1.0 - alpha * a) / a0);
+    coef_[b][3] = float(-2.0 * cosw / a0);
+    coef_[b][4] = float((1.0 - alpha / a) / a0);
+
+    // A band coming back starts from silence, not from stale state.
+    if (!bandActive_[b]) {
+      for (auto &group : state_)
+        std::fill(&group[b][0][0], &group[b][0][0] + 2 * kLanes, 0.0f);
+      bandActive_[b] = true;
+    }
+    sectionBand_[sectionCount_++] = b;
+  }
+
+  if (params.nightMode && !compress_) {
+    compEnv_ = 0.0f;
+    compGain_ = 1.0f;
+  }
+  compress_ = params.nightMode;
+
+  bool wasActive = active_;
+  active_ = configured_ &&
+            (boostDb >= kFlatDb || sectionCount_ > 0 || compress_);
+  if (active_ && !wasActive) {
+    // Bypass was unity gain: ramp the boost up from there.
+    gain_ = 1.0f;
+    reset();
+  }
+  if (!active_) {
+    compressorReductionDb_.store(0.0f, std::memory_order_relaxed);
+    limiterReductionDb_.store(0.0f, std::memory_order_relaxed);
+  }
+  MX_LOGD(LOG_TAG, "boost %.1f dB, %d EQ bands, night %d -> %s", boostDb,
+          sectionCount_, compress_ ? 1 : 0, active_ ? "active" : "bypass");
+}
+
+void DspChain::reset() {
+  for (auto &group : state_)
+    std::fill(&group[0][0][0], &group[0][0][0] + kEqBands * 2 * kLanes, 0.0f);
+  compEnv_ = 0.0f;
+  compGain_ = 1.0f;
+
+  std::fill(delay_.begin(), delay_.end(), 0.0f);
+  std::fill(box_.begin(), box_.end(), 1.0f);
+  boxSum_ = double(lookahead_);
+  pos_ = 0;
+  held_ = 1.0f;
+  minHead_ = 0;
+  minCount_ = 0;
+  frame_ = 0;
+}
+
+void DspChain::process(const float *in, float *out, size_t frames) {
+  compBlockReductionDb_ = 0.0f;
+  limBlockMinGain_ = 1.0f;
+  const size_t ch = size_t(channels_);
+  while (frames > 0) {
+    size_t n = std::min(frames, kBlockFrames);
+    processBlock(in, out, n);
+    in += n * ch;
+    out += n * ch;
+    frames -= n;
+  }
+  compressorReductionDb_.store(compBlockReductionDb_,
+                               std::memory_order_relaxed);
+  limiterReductionDb_.store(-20.0f * std::log10(limBlockMinGain_),
+                            std::memory_order_relaxed);
+}
+
+void DspChain::processBlock(const float *in, float *out, size_t frames) {
+  int32_t groups = (channels_ + kLanes - 1) / kLanes;
+  for (int32_t g = 0; g < groups; ++g)
+    eqGroup(in, out, frames, g);
+  gain_ = gainTarget_;
+  if (compress_)
+    compress(out, frames);
+  limit(out, frames);
+}
+
+// Boost and EQ for channels [group * 4, group * 4 + 4): gathered into
+// four-lane frames, filtered section by section, scattered back.
+void DspChain::eqGroup(const float *in, float *out, size_t frames,
+                       int32_t group) {
+  const size_t ch = size_t(channels_);
+  const size_t first = size_t(group) * kLanes;
+  const size_t n = std::min<size_t>(kLanes, ch - first);
+
+  float g = gain_;
+  const float step = (gainTarget_ - gain_) / float(frames);
+  for (size_t f = 0; f < frames; ++f) {
+    g += step;
+    const float *src = in + f * ch + first;
+    float *lane = &lanes_[f * kLanes];
+    for (size_t c = 0; c < n; ++c)
+      lane[c] = src[c] * g;
+    for (size_t c = n; c < size_t(kLanes); ++c)
+      lane[c] = 0.0f;
+  }
+
+  for (int32_t s = 0; s < sectionCount_; ++s) {
+    int32_t b = sectionBand_[s];
+    biquadBlock(lanes_, frames, coef_[b], &state_[group][b][0][0]);
+  }
+
+  for (size_t f = 0; f < frames; ++f) {
+    float *dst = out + f * ch + first;
+    const float *lane = &lanes_[f * kLanes];
+    for (size_t c = 0; c < n; ++c)
+      dst[c] = lane[c];
+  }
+}
+
+void DspChain::compress(float *pcm, size_t frames) {
+  const size_t ch = size_t(channels_);
+  const float makeupDb = kCompMakeupDb;
+  for (size_t start = 0; start < frames; start += kControlFrames) {
+    size_t n = std::min(kControlFrames, frames - start);
+    float *p = pcm + start * ch;
+
+    // Linked peak envelope over the control block, then one gain for its
+    // end, ramped to from the previous one.
+    float env = compEnv_;
+    for (size_t f = 0; f < n; ++f) {
+      float peak = 0.0f;
+      for (size_t c = 0; c < ch; ++c)
+        peak = std::max(peak, std::fabs(p[f * ch + c]));
+      env += (peak > env ? compAttack_ : compRelease_) * (peak - env);
+    }
+    compEnv_ = env;
+
+    float reduction = compressorReduction(env);
+    compBlockReductionDb_ = std::max(compBlockReductionDb_, reduction);
+    float target = dbToGain(makeupDb - reduction);
+    float g = compGain_;
+    const float step = (target - g) / float(n);
+    for (size_t f = 0; f < n; ++f) {
+      g += step;
+      for (size_t c = 0; c < ch; ++c)
+        p[f * ch + c] *= g;
+    }
+    compGain_ = target;
+  }
+}
+
+void DspChain::limit(float *pcm, size_t frames) {
+  const size_t ch = size_t(channels_);
+  const double invWindow = 1.0 / double(lookahead_);
+  for (size_t f = 0; f < frames; ++f) {
+    float *x = pcm + f * ch;
+    float peak = 0.0f;
+    for (size_t c = 0; c < ch; ++c)
+      peak = std::max(peak, std::fabs(x[c]));
+    float need = peak > ceiling_ ? ceiling_ / peak : 1.0f;
+
+    // Never above what the window needs; recovers at the release rate.
+    float hold = slidingMin(need);
+    held_ = hold < held_ ? hold : held_ + limRelease_ * (hold - held_);
+    boxSum_ += double(held_) - double(box_[pos_]);
+    box_[pos_] = held_;
+    float g = float(boxSum_ * invWindow);
+    limBlockMinGain_ = std::min(limBlockMinGain_, g);
+
+    float *d = &delay_[pos_ * ch];
+    for (size_t c = 0; c < ch; ++c) {
+      float delayed = d[c];
+      d[c] = x[c];
+      x[c] = delayed * g;
+    }
+    pos_ = pos_ + 1 == lookahead_ ? 0 : pos_ + 1;
+  }
+}
+
+// Minimum of the required gains of the last lookahead_ + 1 frames,
+// `value` (this frame's) included. The box filter then averages
+// lookahead_ of these, each covering the frame leaving the delay line.
+float DspChain::slidingMin(float value) {
+  const size_t cap = minValue_.size();
+  if (minCount_ > 0 && minFrame_[minHead_] + int64_t(lookahead_) < frame_) {
+    minHead_ = minHead_ + 1 == cap ? 0 : minHead_ + 1;
+    --minCount_;
+  }
+  while (minCount_ > 0) {
+    size_t back = minHead_ + minCount_ - 1;
+    if (back >= cap)
+      back -= cap;
+    if (minValue_[back] < value)
+      break;
+    --minCount_;
+  }
+  size_t slot = minHead_ + minCount_;
+  if (slot >= cap)
+    slot -= cap;
+  minValue_[slot] = value;
+  minFrame_[slot] = frame_;
+  ++minCount_;
+  ++frame_;
+  return minValue_[minHead_];
+}
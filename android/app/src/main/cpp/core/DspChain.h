@@ -0,0 +1,144 @@
+#pragma once
+
+#include "core/Seqlock.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* ===================== Output DSP chain ===================== */
+
+// User settings. Copied whole through a seqlock, so plain values only.
+struct DspParams {
+  static constexpr int kEqBands = 10;
+
+  float boostDb = 0.0f; // pre-gain, 0 .. DspChain::kMaxBoostDb
+  bool eqEnabled = false;
+  float eqDb[kEqBands] = {}; // per band, +-DspChain::kMaxEqDb
+  bool nightMode = false;    // dynamic range compressor
+};
+
+/*
+ * Volume boost, 10-band graphic EQ, night-mode compressor and a look-ahead
+ * limiter for interleaved float PCM, in that order.
+ *
+ * EQ: RBJ peaking biquads an octave apart (31 Hz .. 16 kHz), transposed
+ * direct form II, run section by section over a block with up to four
+ * channels per NEON/SSE2 vector. Flat bands are skipped.
+ * Compressor: linked peak envelope, soft knee, gain recomputed every
+ * kControlFrames and ramped in between.
+ * Limiter: the gain needed to keep each frame under kCeilingDb is held over
+ * the look-ahead window, released slowly and box-smoothed over the window,
+ * so the smoothed gain is down to the required one by the time the delayed
+ * frame comes out. It runs whenever the chain does (boost and EQ both add
+ * level); the chain delays audio by its look-ahead.
+ *
+ * With every stage neutral the chain is inactive and callers bypass it.
+ *
+ * setParams() may be called from any thread (one at a time); the producer
+ * picks the new values up in update(). All memory is allocated in
+ * configure(); update()/process()/reset() never allocate.
+ */
+class DspChain {
+public:
+  static constexpr int kEqBands = DspParams::kEqBands;
+  static constexpr float kEqBandHz[kEqBands] = {
+      31.25f, 62.5f, 125.0f, 250.0f, 500.0f,
+      1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f};
+  static constexpr float kMaxBoostDb = 12.0f;
+  static constexpr float kMaxEqDb = 12.0f;
+  static constexpr float kCeilingDb = -1.0f;
+  static constexpr int32_t kMaxChannels = 8;
+
+  bool configure(int32_t sampleRate, int32_t channels);
+
+  // Any thread. Values are clamped when applied.
+  void setParams(const DspParams &params) { params_.store(params); }
+  DspParams params() const { return params_.load(); }
+
+  // Producer side: applies parameters set since the last call. Cheap when
+  // nothing changed (one atomic load).
+  void update();
+  // As of the last update().
+  bool active() const { return active_; }
+
+  // Producer side. in and out may be the same buffer.
+  void process(const float *in, float *out, size_t frames);
+
+  // Drops filter state, envelopes and the look-ahead (seek / flush).
+  void reset();
+
+  // Gain reduction (dB, >= 0) of the compressor and the limiter over the
+  // last processed block, for diagnostics. Any thread.
+  float compressorReductionDb() const {
+    return compressorReductionDb_.load(std::memory_order_relaxed);
+  }
+  float limiterReductionDb() const {
+    return limiterReductionDb_.load(std::memory_order_relaxed);
+  }
+
+private:
+  static constexpr size_t kBlockFrames = 256;
+  static constexpr size_t kControlFrames = 16;
+  static constexpr int32_t kLanes = 4;
+  static constexpr int32_t kMaxGroups = kMaxChannels / kLanes;
+
+  void applyParams(const DspParams &params);
+  void processBlock(const float *in, float *out, size_t frames);
+  void eqGroup(const float *in, float *out, size_t frames, int32_t group);
+  void compress(float *pcm, size_t frames);
+  void limit(float *pcm, size_t frames);
+  float slidingMin(float value);
+
+  bool configured_ = false;
+  int32_t sampleRate_ = 0;
+  int32_t channels_ = 0;
+  bool active_ = false;
+
+  Seqlock<DspParams> params_;
+  uint32_t appliedSeq_ = UINT32_MAX;
+
+  /* Boost: linear gain, ramped per block towards gainTarget_ */
+  float gain_ = 1.0f;
+  float gainTarget_ = 1.0f;
+
+  /* EQ: active sections in band order, coefficients b0 b1 b2 a1 a2 */
+  int32_t sectionCount_ = 0;
+  int32_t sectionBand_[kEqBands] = {};
+  bool bandActive_[kEqBands] = {};
+  float coef_[kEqBands][5] = {};
+  // Per band so a band keeps its state while others toggle.
+  alignas(16) float state_[kMaxGroups][kEqBands][2][kLanes] = {};
+  alignas(16) float lanes_[kBlockFrames * kLanes] = {};
+
+  /* Compressor */
+  bool compress_ = false;
+  float compAttack_ = 0.0f;  // per-frame envelope coefficients
+  float compRelease_ = 0.0f;
+  float compEnv_ = 0.0f;
+  float compGain_ = 1.0f;    // at the end of the last control block
+
+  /* Limiter */
+  size_t lookahead_ = 0;     // frames of delay
+  float ceiling_ = 1.0f;
+  float limRelease_ = 0.0f;
+  std::vector<float> delay_; // lookahead_ frames, interleaved
+  std::vector<float> box_;   // last lookahead_ held gains
+  double boxSum_ = 0.0;
+  size_t pos_ = 0;           // delay_ / box_ slot of the current frame
+  float held_ = 1.0f;
+  // Monotonic queue of (frame, gain) for the minimum over the last
+  // lookahead_ + 1 required gains.
+  std::vector<float> minValue_;
+  std::vector<int64_t> minFrame_;
+  size_t minHead_ = 0;
+  size_t minCount_ = 0;
+  int64_t frame_ = 0;
+
+  // Over the current process() call, published at its end.
+  float compBlockReductionDb_ = 0.0f;
+  float limBlockMinGain_ = 1.0f;
+  std::atomic<float> compressorReductionDb_{0.0f};
+  std::atomic<float> limiterReductionDb_{0.0f};
+};
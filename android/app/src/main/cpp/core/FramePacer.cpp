@@ -0,0 +1,197 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Plausible display refresh: 24..500 Hz.
+constexpr int64_t kMinPeriodNs = 2000000;
+constexpr int64_t kMaxPeriodNs = 42000000;
+// Consecutive off-estimate periods that mean the refresh rate switched.
+constexpr int32_t kPeriodSwitchCount = 4;
+// A cadence q is accepted when q frames span a whole number of vsyncs to
+// within this fraction of a vsync.
+constexpr double kCadenceTolerance = 0.02;
+// Fraction of each frame's bin error folded into the shift.
+constexpr double kShiftGain = 0.05;
+
+double fractional(double x) { return x - std::floor(x); }
+} // namespace
+
+/* ===================== Vsync ===================== */
+
+void FramePacer::onVsync(int64_t frameTimeNs) {
+  VsyncTimeline tl = vsync_.load();
+  int64_t period = tl.periodNs;
+
+  if (tl.lastVsyncNs > 0 && frameTimeNs > tl.lastVsyncNs) {
+    int64_t delta = frameTimeNs - tl.lastVsyncNs;
+    if (period == 0) {
+      if (delta >= kMinPeriodNs && delta <= kMaxPeriodNs)
+        period = delta;
+    } else {
+      // Missed callbacks show up as whole multiples of the period.
+      int64_t n = std::max<int64_t>(1, (delta + period / 2) / period);
+      int64_t observed = delta / n;
+      if (std::abs(observed - period) < period / 10) {
+        period += (observed - period) / 8;
+        periodOutliers_ = 0;
+      } else if (++periodOutliers_ >= kPeriodSwitchCount &&
+                 observed >= kMinPeriodNs && observed <= kMaxPeriodNs) {
+        period = observed; // refresh-rate switch (e.g. 60 -> 48 Hz)
+        periodOutliers_ = 0;
+      }
+    }
+  }
+  vsync_.store(VsyncTimeline{frameTimeNs, period});
+}
+
+/* ===================== Frame rate ===================== */
+
+void FramePacer::onFramePts(int64_t ptsUs) {
+  if (lastPtsUs_ != INT64_MIN) {
+    int64_t d = ptsUs - lastPtsUs_;
+    if (d > 0 && d < 200000) {
+      frameDeltasUs_[deltaPos_] = d;
+      deltaPos_ = (deltaPos_ + 1) % kRateWindow;
+      deltaCount_ = std::min(deltaCount_ + 1, kRateWindow);
+    }
+  }
+  lastPtsUs_ = ptsUs;
+
+  if (deltaCount_ < kRateWindow / 2)
+    return;
+
+  int64_t sorted[kRateWindow];
+  std::copy(frameDeltasUs_, frameDeltasUs_ + deltaCount_, sorted);
+  std::sort(sorted, sorted + deltaCount_);
+  int64_t median = sorted[deltaCount_ / 2];
+  int64_t tolerance = std::max<int64_t>(500, median / 50);
+
+  int64_t sum = 0;
+  int32_t inRange = 0;
+  for (int32_t i = 0; i < deltaCount_; ++i) {
+    if (std::abs(sorted[i] - median) <= tolerance) {
+      sum += sorted[i];
+      ++inRange;
+    }
+  }
+  // Fixed rate only if nearly every delta agrees (VFR content stays at 0).
+  frameDurationUs_ = inRange * 5 >= deltaCount_ * 4 ? sum / inRange : 0;
+  contentFps_.store(frameDurationUs_ > 0 ? 1e6f / frameDurationUs_ : 0.0f,
+                    std::memory_order_relaxed);
+}
+
+void FramePacer::updateCadence() {
+  int64_t period = vsync_.load().periodNs;
+  if (period == cadencePeriodNs_ && frameDurationUs_ == cadenceFrameUs_)
+    return;
+  cadencePeriodNs_ = period;
+  cadenceFrameUs_ = frameDurationUs_;
+
+  int32_t q = 1;
+  if (period > 0 && frameDurationUs_ > 0) {
+    double ratio = double(frameDurationUs_) * 1000.0 / double(period);
+    for (int32_t candidate = 1; candidate <= kMaxCadence; ++candidate) {
+      double span = ratio * candidate;
+      if (std::abs(span - std::round(span)) < kCadenceTolerance) {
+        q = candidate;
+        break;
+      }
+    }
+  }
+  if (q != cadence_)
+    shiftValid_ = false;
+  cadence_ = q;
+  cadenceOut_.store(q, std::memory_order_relaxed);
+}
+
+/* ===================== Scheduling ===================== */
+
+int64_t FramePacer::snap(int64_t idealNs) {
+  VsyncTimeline tl = vsync_.load();
+  if (tl.periodNs <= 0)
+    return idealNs;
+  updateCadence();
+
+  double period = double(tl.periodNs);
+  double x = double(idealNs - tl.lastVsyncNs) / period;
+  double bin = 1.0 / cadence_;
+
+  // Error of this frame from the middle of its 1/q bin. The first frame
+  // sets the shift; afterwards it only follows slowly (PLL), which averages
+  // out clock noise but tracks real drift (slew, 23.976 vs 24).
+  double err = std::fmod(fractional(x + shift_), bin) - bin / 2;
+  shift_ -= shiftValid_ ? err * kShiftGain : err;
+  shiftValid_ = true;
+  // Wrapping by a whole vsync moves every frame by the same amount: at most
+  // one longer/shorter frame, and frames stay within a vsync of their ideal
+  // time.
+  shift_ = fractional(shift_);
+
+  int64_t n = static_cast<int64_t>(std::floor(x + shift_));
+  lastSnappedNs_ = tl.lastVsyncNs + n * tl.periodNs;
+  return lastSnappedNs_;
+}
+
+/* ===================== Statistics ===================== */
+
+void FramePacer::onFrameShown(bool shown) {
+  frames_.fetch_add(1, std::memory_order_relaxed);
+  if (!shown) {
+    histogram_[0].fetch_add(1, std::memory_order_relaxed);
+    janks_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  int64_t period = vsync_.load().periodNs;
+  if (prevShownNs_ > 0 && period > 0 && lastSnappedNs_ > prevShownNs_) {
+    // How many vsyncs the previous frame stayed on screen.
+    int64_t vsyncs = (lastSnappedNs_ - prevShownNs_ + period / 2) / period;
+    int32_t bucket =
+        static_cast<int32_t>(std::min<int64_t>(vsyncs, kMaxBucket));
+    histogram_[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    // With a fixed frame rate the durations repeat every `cadence_` frames
+    // (3,2,3,2 for 24p@60); anything else is visible judder.
+    bool jank = vsyncs == 0;
+    if (frameDurationUs_ > 0 && durationCount_ >= cadence_) {
+      int32_t prev = (durationPos_ - cadence_ + kMaxCadence) % kMaxCadence;
+      jank = jank || durations_[prev] != vsyncs;
+    }
+    if (jank)
+      janks_.fetch_add(1, std::memory_order_relaxed);
+
+    durations_[durationPos_] = vsyncs;
+    durationPos_ = (durationPos_ + 1) % kMaxCadence;
+    durationCount_ = std::min(durationCount_ + 1, kMaxCadence);
+  }
+  prevShownNs_ = lastSnappedNs_;
+}
+
+void FramePacer::reset() {
+  lastPtsUs_ = INT64_MIN;
+  shiftValid_ = false;
+  prevShownNs_ = 0;
+  durationCount_ = 0;
+  durationPos_ = 0;
+}
+
+void FramePacer::resetStats() {
+  frames_.store(0, std::memory_order_relaxed);
+  janks_.store(0, std::memory_order_relaxed);
+  for (auto &bucket : histogram_)
+    bucket.store(0, std::memory_order_relaxed);
+}
+
+FramePacer::Stats FramePacer::stats() const {
+  Stats st{};
+  st.vsyncPeriodNs = vsyncPeriodNs();
+  st.contentFps = contentFps();
+  st.cadence = cadenceOut_.load(std::memory_order_relaxed);
+  st.frames = frames_.load(std::memory_order_relaxed);
+  st.janks = janks_.load(std::memory_order_relaxed);
+  for (int i = 0; i <= kMaxBucket; ++i)
+    st.histogram[i] = histogram_[i].load(std::memory_order_relaxed);
+  return st;
+}
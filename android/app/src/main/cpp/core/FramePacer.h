@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "core/Seqlock.h"
+
+/*
+ * Vsync-aligned frame scheduling for the video render loop.
+ *
+ * Fed with display vsync timestamps (AChoreographer) and with the PTS of
+ * every frame it schedules, it snaps each frame's ideal presentation time
+ * to a vsync so that the cadence stays regular: 24p on 60 Hz alternates
+ * 3:2 vsyncs every time instead of flipping between 2:2/3:3 whenever a
+ * frame lands near the middle of a vsync interval.
+ *
+ * How: with v = vsync period and d = frame duration, frame k falls at
+ * fractional vsync position x_k = x_0 + k * d / v. If d / v is close to
+ * p / q (q <= kMaxCadence), the fractional parts only take q values spaced
+ * 1/q apart. A phase shift `s` puts all of them in the middle of their 1/q
+ * bin, so floor(x_k + s) never sits on a rounding boundary; `s` follows
+ * drift slowly instead of reacting to per-frame clock noise. Without a
+ * stable frame rate q = 1, i.e. nearest-vsync snapping.
+ *
+ * Not thread-safe except where noted: onVsync() may run on another thread
+ * than the render loop (the vsync timeline is published atomically).
+ */
+class FramePacer {
+public:
+  // Display duration histogram, in vsyncs per frame: [0] = dropped before
+  // display, [1..kMaxBucket-1], [kMaxBucket] = kMaxBucket or more.
+  static constexpr int kMaxBucket = 6;
+
+  struct Stats {
+    int64_t vsyncPeriodNs;
+    float contentFps; // 0 until a fixed rate is detected
+    int32_t cadence;  // q above; 1 = no repeating pattern
+    int64_t frames;
+    int64_t janks; // display duration broke the cadence (or was 0)
+    int64_t histogram[kMaxBucket + 1];
+  };
+
+  // Vsync callback (any thread). `frameTimeNs` is CLOCK_MONOTONIC.
+  void onVsync(int64_t frameTimeNs);
+  bool hasVsync() const { return vsyncPeriodNs() > 0; }
+  int64_t vsyncPeriodNs() const { return vsync_.load().periodNs; }
+
+  // Records the PTS of a frame about to be scheduled (frame-rate detection).
+  void onFramePts(int64_t ptsUs);
+
+  // Vsync (CLOCK_MONOTONIC ns) on which a frame ideally shown at `idealNs`
+  // should appear. Returns idealNs unchanged until vsync is known.
+  int64_t snap(int64_t idealNs);
+
+  // The frame snapped last was displayed (true) or dropped (false); feeds
+  // the jank histogram.
+  void onFrameShown(bool shown);
+
+  // Discontinuity (seek, surface change): forget phase and frame history,
+  // keep the vsync timeline and the statistics.
+  void reset();
+  void resetStats();
+
+  // Detected content frame rate (0 = unknown). Any thread.
+  float contentFps() const {
+    return contentFps_.load(std::memory_order_relaxed);
+  }
+
+  Stats stats() const;
+
+private:
+  static constexpr int kMaxCadence = 8;
+  static constexpr int kRateWindow = 16;
+
+  void updateCadence();
+
+  /* Vsync timeline (single writer: the onVsync thread) */
+  struct VsyncTimeline {
+    int64_t lastVsyncNs;
+    int64_t periodNs; // 0 = unknown
+  };
+  Seqlock<VsyncTimeline> vsync_;
+  int32_t periodOutliers_ = 0; // onVsync thread
+
+  /* Frame rate detection (render thread) */
+  int64_t lastPtsUs_ = INT64_MIN;
+  int64_t frameDeltasUs_[kRateWindow] = {};
+  int32_t deltaCount_ = 0;
+  int32_t deltaPos_ = 0;
+  int64_t frameDurationUs_ = 0; // stable frame duration, 0 = unknown
+  std::atomic<float> contentFps_{0.0f};
+
+  /* Cadence (render thread) */
+  int32_t cadence_ = 1;
+  int64_t cadencePeriodNs_ = 0;
+  int64_t cadenceFrameUs_ = 0;
+  double shift_ = 0.5;
+  bool shiftValid_ = false;
+  int64_t lastSnappedNs_ = 0;
+  int64_t prevShownNs_ = 0;
+  // Display durations (vsyncs) of the last kMaxCadence frames
+  int64_t durations_[kMaxCadence] = {};
+  int32_t durationCount_ = 0;
+  int32_t durationPos_ = 0;
+
+  /* Stats (render thread writes, any thread reads) */
+  std::atomic<int64_t> frames_{0};
+  std::atomic<int64_t> janks_{0};
+  std::atomic<int64_t> histogram_[kMaxBucket + 1] = {};
+  std::atomic<int32_t> cadenceOut_{1};
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+/*
+ * Bounded lock-free multi-producer / single-consumer queue.
+ *
+ * Control commands for an engine thread: any thread may push(), only the
+ * engine thread pops. Each cell carries a sequence number telling whether
+ * it is free for the producer that claimed its position or holds a value
+ * for the consumer (Vyukov's bounded queue), so a producer never waits on
+ * another one and push() is a CAS plus two stores.
+ *
+ * Capacity is rounded up to a power of two. Storage is allocated once in
+ * the constructor; push() and pop() never allocate or block. push() fails
+ * when the queue is full.
+ */
+template <typename T> class MpscQueue {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "MpscQueue copies values in and out of its cells");
+
+public:
+  static constexpr size_t kCacheLine = 64;
+
+  explicit MpscQueue(size_t minCapacity)
+      : capacity_(roundUpPow2(minCapacity)), mask_(capacity_ - 1),
+        cells_(new Cell[capacity_]) {
+    for (size_t i = 0; i < capacity_; ++i)
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  size_t capacity() const { return capacity_; }
+
+  // Any thread. Returns false if the queue is full.
+  bool push(const T &value) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell &cell = cells_[pos & mask_];
+      size_t seq = cell.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        // Cell free for this position: claim it.
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false; // consumer has not freed it yet: full
+      } else {
+        pos = tail_.load(std::memory_order_relaxed); // lost a race
+      }
+    }
+    Cell &cell = cells_[pos & mask_];
+    cell.value = value;
+    cell.sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer thread only. Returns false if nothing is ready (a producer
+  // that claimed the head cell but has not written it yet counts as empty).
+  bool pop(T &value) {
+    Cell &cell = cells_[head_ & mask_];
+    size_t seq = cell.sequence.load(std::memory_order_acquire);
+    if (seq != head_ + 1)
+      return false;
+    value = cell.value;
+    cell.sequence.store(head_ + capacity_, std::memory_order_release);
+    ++head_;
+    return true;
+  }
+
+  // Consumer thread only.
+  bool empty() const {
+    return cells_[head_ & mask_].sequence.load(std::memory_order_acquire) !=
+           head_ + 1;
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  static size_t roundUpPow2(size_t n) {
+    size_t cap = 2;
+    while (cap < n)
+      cap <<= 1;
+    return cap;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+
+  alignas(kCacheLine) std::atomic<size_t> tail_{0}; // producers
+  alignas(kCacheLine) size_t head_ = 0;             // consumer
+};
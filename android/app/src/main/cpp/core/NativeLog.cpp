@@ -0,0 +1,32 @@
+#include "NativeLog.h"
+
+#if !defined(__ANDROID__)
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+
+namespace mxlite {
+
+static std::atomic<bool> gHostLogEnabled{true};
+
+void setHostLogEnabled(bool enabled) {
+  gHostLogEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void hostLog(char level, const char *tag, const char *fmt, ...) {
+  if (!gHostLogEnabled.load(std::memory_order_relaxed))
+    return;
+
+  char buf[512];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+
+  fprintf(stderr, "%c/%s: %s\n", level, tag, buf);
+}
+
+} // namespace mxlite
+
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+
+// Logging shim for code that must also build on the host (mxlite-core).
+// On Android this forwards to logcat; on the host it writes to stderr so the
+// benchmarks and tools can run without the NDK.
+
+#if defined(__ANDROID__)
+
+#include <android/log.h>
+
+#define MX_LOGD(tag, ...) __android_log_print(ANDROID_LOG_DEBUG, tag, __VA_ARGS__)
+#define MX_LOGW(tag, ...) __android_log_print(ANDROID_LOG_WARN, tag, __VA_ARGS__)
+#define MX_LOGE(tag, ...) __android_log_print(ANDROID_LOG_ERROR, tag, __VA_ARGS__)
+
+#else
+
+namespace mxlite {
+// Host builds only: benchmarks silence logging so the numbers are not
+// dominated by stderr writes.
+void setHostLogEnabled(bool enabled);
+void hostLog(char level, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+} // namespace mxlite
+
+#define MX_LOGD(tag, ...) ::mxlite::hostLog('D', tag, __VA_ARGS__)
+#define MX_LOGW(tag, ...) ::mxlite::hostLog('W', tag, __VA_ARGS__)
+#define MX_LOGE(tag, ...) ::mxlite::hostLog('E', tag, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,320 @@
+#include "PcmConvert.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MX_PCM_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MX_PCM_SSE2 1
+#endif
+
+namespace {
+
+constexpr float kScale16 = 32768.0f;
+constexpr float kScale24 = 8388608.0f;
+constexpr float kScale32 = 2147483648.0f;
+
+// Largest float below 2^31 (2^31 itself overflows int32).
+constexpr float kMax32 = 2147483520.0f;
+
+constexpr float kInv65536 = 1.0f / 65536.0f;
+
+/* ───────── Scalar helpers (tails and fallback) ───────── */
+
+inline uint32_t xorshift32(uint32_t &s) {
+  s ^= s << 13;
+  s ^= s >> 17;
+  s ^= s << 5;
+  return s;
+}
+
+// Difference of two 16-bit uniforms: triangular noise in (-1, 1) LSB.
+inline float tpdf(uint32_t r) {
+  return (float(r >> 16) - float(r & 0xFFFFu)) * kInv65536;
+}
+
+inline int32_t quantize(float v, float lo, float hi) {
+  v = std::min(hi, std::max(lo, v));
+  return static_cast<int32_t>(lrintf(v));
+}
+
+inline float scalarDither(PcmDither *dither) {
+  return dither ? tpdf(xorshift32(dither->state[0])) : 0.0f;
+}
+
+/* ───────── SIMD helpers ───────── */
+
+#if MX_PCM_NEON
+inline int32x4_t roundToInt(float32x4_t v) {
+#if defined(__aarch64__)
+  return vcvtnq_s32_f32(v);
+#else
+  // ARMv7 only truncates: add +-0.5 with the sign of v first.
+  uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(v), vdupq_n_u32(0x80000000u));
+  float32x4_t half = vreinterpretq_f32_u32(
+      vorrq_u32(sign, vreinterpretq_u32_f32(vdupq_n_f32(0.5f))));
+  return vcvtq_s32_f32(vaddq_f32(v, half));
+#endif
+}
+
+inline float32x4_t tpdf4(uint32x4_t &s) {
+  s = veorq_u32(s, vshlq_n_u32(s, 13));
+  s = veorq_u32(s, vshrq_n_u32(s, 17));
+  s = veorq_u32(s, vshlq_n_u32(s, 5));
+  float32x4_t hi = vcvtq_f32_u32(vshrq_n_u32(s, 16));
+  float32x4_t lo = vcvtq_f32_u32(vandq_u32(s, vdupq_n_u32(0xFFFFu)));
+  return vmulq_n_f32(vsubq_f32(hi, lo), kInv65536);
+}
+#elif MX_PCM_SSE2
+inline __m128 tpdf4(__m128i &s) {
+  s = _mm_xor_si128(s, _mm_slli_epi32(s, 13));
+  s = _mm_xor_si128(s, _mm_srli_epi32(s, 17));
+  s = _mm_xor_si128(s, _mm_slli_epi32(s, 5));
+  __m128 hi = _mm_cvtepi32_ps(_mm_srli_epi32(s, 16));
+  __m128 lo = _mm_cvtepi32_ps(_mm_and_si128(s, _mm_set1_epi32(0xFFFF)));
+  return _mm_mul_ps(_mm_sub_ps(hi, lo), _mm_set1_ps(kInv65536));
+}
+#endif
+
+/* ───────── integer -> float ───────── */
+
+void i16ToFloat(const int16_t *in, float *out, size_t n) {
+  const float k = 1.0f / kScale16;
+  size_t i = 0;
+#if MX_PCM_NEON
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t v = vld1q_s16(in + i);
+    vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), k));
+    vst1q_f32(out + i + 4,
+              vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), k));
+  }
+#elif MX_PCM_SSE2
+  const __m128 kv = _mm_set1_ps(k);
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), kv));
+    _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), kv));
+  }
+#endif
+  for (; i < n; ++i)
+    out[i] = float(in[i]) * k;
+}
+
+void i32ToFloat(const int32_t *in, float *out, size_t n) {
+  const float k = 1.0f / kScale32;
+  size_t i = 0;
+#if MX_PCM_NEON
+  for (; i + 4 <= n; i += 4) {
+    vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(in + i)), k));
+  }
+#elif MX_PCM_SSE2
+  const __m128 kv = _mm_set1_ps(k);
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(v), kv));
+  }
+#endif
+  for (; i < n; ++i)
+    out[i] = float(in[i]) * k;
+}
+
+void i24ToFloat(const uint8_t *in, float *out, size_t n) {
+  // Unpack into the top 24 bits of an int32, then reuse the int32 kernel.
+  constexpr size_t kBlock = 256;
+  int32_t tmp[kBlock];
+  while (n > 0) {
+    size_t count = std::min(n, kBlock);
+    for (size_t i = 0; i < count; ++i) {
+      const uint8_t *p = in + i * 3;
+      tmp[i] = static_cast<int32_t>((uint32_t(p[0]) << 8) |
+                                    (uint32_t(p[1]) << 16) |
+                                    (uint32_t(p[2]) << 24));
+    }
+    i32ToFloat(tmp, out, count);
+    in += count * 3;
+    out += count;
+    n -= count;
+  }
+}
+
+/* ───────── float -> integer ───────── */
+
+void floatToI16(const float *in, int16_t *out, size_t n, PcmDither *dither) {
+  size_t i = 0;
+#if MX_PCM_NEON
+  const float32x4_t lo = vdupq_n_f32(-kScale16);
+  const float32x4_t hi = vdupq_n_f32(kScale16 - 1.0f);
+  uint32x4_t s = vld1q_u32(dither ? dither->state : PcmDither().state);
+  for (; i + 8 <= n; i += 8) {
+    float32x4_t a = vmulq_n_f32(vld1q_f32(in + i), kScale16);
+    float32x4_t b = vmulq_n_f32(vld1q_f32(in + i + 4), kScale16);
+    if (dither) {
+      a = vaddq_f32(a, tpdf4(s));
+      b = vaddq_f32(b, tpdf4(s));
+    }
+    a = vminq_f32(hi, vmaxq_f32(lo, a));
+    b = vminq_f32(hi, vmaxq_f32(lo, b));
+    vst1q_s16(out + i, vcombine_s16(vqmovn_s32(roundToInt(a)),
+                                    vqmovn_s32(roundToInt(b))));
+  }
+  if (dither)
+    vst1q_u32(dither->state, s);
+#elif MX_PCM_SSE2
+  const __m128 k = _mm_set1_ps(kScale16);
+  __m128i s = _mm_loadu_si128(
+      reinterpret_cast<const __m128i *>(dither ? dither->state : PcmDither().state));
+  for (; i + 8 <= n; i += 8) {
+    __m128 a = _mm_mul_ps(_mm_loadu_ps(in + i), k);
+    __m128 b = _mm_mul_ps(_mm_loadu_ps(in + i + 4), k);
+    if (dither) {
+      a = _mm_add_ps(a, tpdf4(s));
+      b = _mm_add_ps(b, tpdf4(s));
+    }
+    // cvtps rounds to nearest; packs saturates to int16 (no clamp needed
+    // except for values beyond int32, which cvtps maps to INT32_MIN).
+    a = _mm_min_ps(_mm_set1_ps(kScale16), a);
+    b = _mm_min_ps(_mm_set1_ps(kScale16), b);
+    __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+  }
+  if (dither)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dither->state), s);
+#endif
+  for (; i < n; ++i) {
+    out[i] = static_cast<int16_t>(quantize(in[i] * kScale16 + scalarDither(dither),
+                                           -kScale16, kScale16 - 1.0f));
+  }
+}
+
+// Scales, optionally dithers, clamps to [lo, hi] and rounds to int32.
+void floatToI32Scaled(const float *in, int32_t *out, size_t n, float scale,
+                      float loLimit, float hiLimit, PcmDither *dither) {
+  size_t i = 0;
+#if MX_PCM_NEON
+  const float32x4_t lo = vdupq_n_f32(loLimit);
+  const float32x4_t hi = vdupq_n_f32(hiLimit);
+  uint32x4_t s = vld1q_u32(dither ? dither->state : PcmDither().state);
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t a = vmulq_n_f32(vld1q_f32(in + i), scale);
+    if (dither)
+      a = vaddq_f32(a, tpdf4(s));
+    vst1q_s32(out + i, roundToInt(vminq_f32(hi, vmaxq_f32(lo, a))));
+  }
+  if (dither)
+    vst1q_u32(dither->state, s);
+#elif MX_PCM_SSE2
+  const __m128 k = _mm_set1_ps(scale);
+  const __m128 lo = _mm_set1_ps(loLimit);
+  const __m128 hi = _mm_set1_ps(hiLimit);
+  __m128i s = _mm_loadu_si128(
+      reinterpret_cast<const __m128i *>(dither ? dither->state : PcmDither().state));
+  for (; i + 4 <= n; i += 4) {
+    __m128 a = _mm_mul_ps(_mm_loadu_ps(in + i), k);
+    if (dither)
+      a = _mm_add_ps(a, tpdf4(s));
+    a = _mm_min_ps(hi, _mm_max_ps(lo, a));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_cvtps_epi32(a));
+  }
+  if (dither)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dither->state), s);
+#endif
+  for (; i < n; ++i)
+    out[i] = quantize(in[i] * scale + scalarDither(dither), loLimit, hiLimit);
+}
+
+void floatToI24(const float *in, uint8_t *out, size_t n, PcmDither *dither) {
+  constexpr size_t kBlock = 256;
+  int32_t tmp[kBlock];
+  while (n > 0) {
+    size_t count = std::min(n, kBlock);
+    floatToI32Scaled(in, tmp, count, kScale24, -kScale24, kScale24 - 1.0f,
+                     dither);
+    for (size_t i = 0; i < count; ++i) {
+      uint32_t v = static_cast<uint32_t>(tmp[i]);
+      out[i * 3] = uint8_t(v);
+      out[i * 3 + 1] = uint8_t(v >> 8);
+      out[i * 3 + 2] = uint8_t(v >> 16);
+    }
+    in += count;
+    out += count * 3;
+    n -= count;
+  }
+}
+
+} // namespace
+
+size_t pcmBytesPerSample(PcmEncoding encoding) {
+  switch (encoding) {
+  case PcmEncoding::I16:
+    return 2;
+  case PcmEncoding::I24Packed:
+    return 3;
+  case PcmEncoding::I32:
+  case PcmEncoding::Float:
+    return 4;
+  }
+  return 2;
+}
+
+PcmEncoding pcmEncodingFromAndroid(int32_t androidEncoding) {
+  switch (androidEncoding) {
+  case kAndroidEncodingPcmFloat:
+    return PcmEncoding::Float;
+  case 21: // ENCODING_PCM_24BIT_PACKED
+    return PcmEncoding::I24Packed;
+  case 22: // ENCODING_PCM_32BIT
+    return PcmEncoding::I32;
+  default: // ENCODING_PCM_16BIT (2) / missing
+    return PcmEncoding::I16;
+  }
+}
+
+void convertToFloat(PcmEncoding encoding, const void *in, float *out,
+                    size_t samples) {
+  switch (encoding) {
+  case PcmEncoding::I16:
+    i16ToFloat(static_cast<const int16_t *>(in), out, samples);
+    break;
+  case PcmEncoding::I24Packed:
+    i24ToFloat(static_cast<const uint8_t *>(in), out, samples);
+    break;
+  case PcmEncoding::I32:
+    i32ToFloat(static_cast<const int32_t *>(in), out, samples);
+    break;
+  case PcmEncoding::Float:
+    std::copy_n(static_cast<const float *>(in), samples, out);
+    break;
+  }
+}
+
+void convertFromFloat(PcmEncoding encoding, const float *in, void *out,
+                      size_t samples, PcmDither *dither) {
+  switch (encoding) {
+  case PcmEncoding::I16:
+    floatToI16(in, static_cast<int16_t *>(out), samples, dither);
+    break;
+  case PcmEncoding::I24Packed:
+    floatToI24(in, static_cast<uint8_t *>(out), samples, dither);
+    break;
+  case PcmEncoding::I32:
+    floatToI32Scaled(in, static_cast<int32_t *>(out), samples, kScale32,
+                     -kScale32, kMax32, nullptr);
+    break;
+  case PcmEncoding::Float:
+    std::copy_n(in, samples, static_cast<float *>(out));
+    break;
+  }
+}
+
+void convertFloatToPcm16(const float *in, int16_t *out, size_t samples) {
+  floatToI16(in, out, samples, nullptr);
+}
+
+void convertPcm16ToFloat(const int16_t *in, float *out, size_t samples) {
+  i16ToFloat(in, out, samples);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* ===================== PCM helpers ===================== */
+
+static inline int16_t floatToPcm16(float v) {
+  if (v > 1.0f)
+    v = 1.0f;
+  if (v < -1.0f)
+    v = -1.0f;
+  return static_cast<int16_t>(v * 32767.0f);
+}
+
+static inline float pcm16ToFloat(int16_t v) {
+  return static_cast<float>(v) * (1.0f / 32768.0f);
+}
+
+/* ===================== Sample formats ===================== */
+
+// Interleaved PCM encodings we exchange with MediaCodec and AAudio.
+enum class PcmEncoding : int32_t {
+  I16 = 0,
+  I24Packed = 1, // 3 bytes, little endian
+  I32 = 2,
+  Float = 3,
+};
+
+size_t pcmBytesPerSample(PcmEncoding encoding);
+
+// Maps MediaFormat "pcm-encoding" (android.media.AudioFormat.ENCODING_*) to
+// PcmEncoding. Unknown or missing values mean 16-bit, which is what
+// MediaCodec outputs unless asked otherwise.
+PcmEncoding pcmEncodingFromAndroid(int32_t androidEncoding);
+
+// AudioFormat.ENCODING_PCM_FLOAT, used to request float decoder output.
+constexpr int32_t kAndroidEncodingPcmFloat = 4;
+
+/* ===================== Vectorized conversion ===================== */
+
+// TPDF dither state for float -> integer conversions (one per output stream;
+// not thread-safe). Dither is +-1 LSB triangular noise, which decorrelates
+// the quantization error from the signal when reducing to 16/24 bits.
+struct PcmDither {
+  uint32_t state[4] = {0x9E3779B9u, 0x243F6A88u, 0xB7E15162u, 0x85A308D3u};
+};
+
+// Full scale is 2^(bits-1) in both directions, so integer -> float -> integer
+// round-trips exactly; +1.0f saturates to the largest positive code.
+//
+// All kernels are NEON (ARM) / SSE2 (x86) with a scalar tail and work on
+// interleaved samples, so they are independent of the channel count.
+// `samples` = frames * channels.
+void convertToFloat(PcmEncoding encoding, const void *in, float *out,
+                    size_t samples);
+
+// `dither` may be null (no dither). It is ignored for Float and I32 output.
+void convertFromFloat(PcmEncoding encoding, const float *in, void *out,
+                      size_t samples, PcmDither *dither);
+
+// Kept for callers that only deal with 16-bit (no dither).
+void convertFloatToPcm16(const float *in, int16_t *out, size_t samples);
+void convertPcm16ToFloat(const int16_t *in, float *out, size_t samples);
@@ -0,0 +1,83 @@
+#include "core/PcmHistory.h"
+
+#include <algorithm>
+#include <cstring>
+
+void PcmHistory::configure(int32_t channels, int32_t sampleRate,
+                           size_t capacityFrames) {
+  channels_ = std::max(1, channels);
+  sampleRate_ = std::max(1, sampleRate);
+  capacity_ = std::max<size_t>(1, capacityFrames);
+  data_.reset(new float[capacity_ * channels_]());
+  clear();
+}
+
+void PcmHistory::clear() {
+  start_ = cursor_ = end_ = 0;
+  baseFrame_ = 0;
+  baseUs_ = 0;
+}
+
+PcmHistory::Span PcmHistory::acquireWrite(size_t frames) {
+  Span span;
+  if (!data_)
+    return span;
+  frames = std::min(frames, writableFrames());
+  size_t offset = static_cast<size_t>(end_ % capacity_);
+  size_t firstFrames = std::min(frames, capacity_ - offset);
+  span.first = data_.get() + offset * channels_;
+  span.firstCount = firstFrames * channels_;
+  span.second = data_.get();
+  span.secondCount = (frames - firstFrames) * channels_;
+  return span;
+}
+
+void PcmHistory::commitWrite(size_t frames, int64_t ptsUs) {
+  if (frames == 0)
+    return;
+  if (empty()) {
+    baseFrame_ = end_;
+    baseUs_ = ptsUs;
+  }
+  end_ += static_cast<int64_t>(frames);
+  // Oldest (already read) frames make room.
+  start_ = std::max(start_, end_ - static_cast<int64_t>(capacity_));
+}
+
+size_t PcmHistory::write(const float *pcm, size_t frames, int64_t ptsUs) {
+  Span span = acquireWrite(frames);
+  memcpy(span.first, pcm, span.firstCount * sizeof(float));
+  if (span.secondCount) {
+    memcpy(span.second, pcm + span.firstCount,
+           span.secondCount * sizeof(float));
+  }
+  size_t written = span.size() / channels_;
+  commitWrite(written, ptsUs);
+  return written;
+}
+
+PcmHistory::Span PcmHistory::acquireRead(size_t frames) const {
+  Span span;
+  if (!data_)
+    return span;
+  frames = std::min(frames, readableFrames());
+  size_t offset = static_cast<size_t>(cursor_ % capacity_);
+  size_t firstFrames = std::min(frames, capacity_ - offset);
+  span.first = data_.get() + offset * channels_;
+  span.firstCount = firstFrames * channels_;
+  span.second = data_.get();
+  span.secondCount = (frames - firstFrames) * channels_;
+  return span;
+}
+
+void PcmHistory::commitRead(size_t frames) {
+  cursor_ += static_cast<int64_t>(std::min(frames, readableFrames()));
+}
+
+bool PcmHistory::seekTo(int64_t us) {
+  if (empty() || us < startUs() || us >= endUs())
+    return false;
+  int64_t frame = baseFrame_ + (us - baseUs_) * sampleRate_ / 1000000;
+  cursor_ = std::clamp(frame, start_, end_ - 1);
+  return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*
+ * Timestamped store of recently decoded PCM (interleaved float, output
+ * layout and rate), for rewinds that do not touch the decoder.
+ *
+ * Frames are appended at the end and handed on from a read cursor; played
+ * frames stay behind the cursor until newer ones push them out. The content
+ * is one continuous run of media time: frame f plays at
+ * baseUs + (f - baseFrame) / sampleRate. seekTo() moves the cursor anywhere
+ * inside the run, so the same audio is handed on again (or skipped ahead)
+ * without decoding it twice.
+ *
+ * Frame positions are absolute (they keep counting across wraps). Span
+ * sizes are in samples, like SpscRing. Storage is allocated in configure()
+ * only. Not thread-safe: one producer thread (or callers serialized by a
+ * mutex).
+ */
+class PcmHistory {
+public:
+  // Up to two contiguous regions (the second one only when wrapping).
+  struct Span {
+    float *first = nullptr;
+    size_t firstCount = 0;
+    float *second = nullptr;
+    size_t secondCount = 0;
+
+    size_t size() const { return firstCount + secondCount; }
+  };
+
+  // Drops the content and reallocates for `capacityFrames` frames.
+  void configure(int32_t channels, int32_t sampleRate, size_t capacityFrames);
+  // Drops the content; the next append starts a new run.
+  void clear();
+
+  size_t capacityFrames() const { return capacity_; }
+  size_t bytes() const { return capacity_ * channels_ * sizeof(float); }
+
+  /* ───────── Append ───────── */
+
+  // Frames that can be appended without evicting frames not yet read.
+  size_t writableFrames() const {
+    return capacity_ - static_cast<size_t>(end_ - cursor_);
+  }
+  // Free space for up to `frames` more frames (whole frames, samples).
+  Span acquireWrite(size_t frames);
+  // Appends what was written into the span. `ptsUs` (first frame) starts
+  // the run when the history is empty; later appends continue it.
+  void commitWrite(size_t frames, int64_t ptsUs);
+  // acquireWrite + copy + commitWrite; returns frames appended.
+  size_t write(const float *pcm, size_t frames, int64_t ptsUs);
+
+  /* ───────── Read cursor ───────── */
+
+  size_t readableFrames() const { return static_cast<size_t>(end_ - cursor_); }
+  // Up to `frames` frames from the cursor (samples); commitRead() advances.
+  Span acquireRead(size_t frames) const;
+  void commitRead(size_t frames);
+
+  // Media time of the cursor / of the oldest and newest (exclusive) frame.
+  int64_t cursorUs() const { return frameUs(cursor_); }
+  int64_t startUs() const { return frameUs(start_); }
+  int64_t endUs() const { return frameUs(end_); }
+  bool empty() const { return end_ == start_; }
+
+  // Moves the cursor to the frame playing at `us`. False (cursor unchanged)
+  // if `us` is outside [startUs, endUs).
+  bool seekTo(int64_t us);
+
+private:
+  int64_t frameUs(int64_t frame) const {
+    return baseUs_ + (frame - baseFrame_) * 1000000 / sampleRate_;
+  }
+
+  std::unique_ptr<float[]> data_;
+  size_t capacity_ = 0; // frames
+  int32_t channels_ = 0;
+  int32_t sampleRate_ = 1;
+
+  int64_t start_ = 0;  // oldest frame kept
+  int64_t cursor_ = 0; // next frame acquireRead() returns
+  int64_t end_ = 0;    // next frame appended
+  int64_t baseFrame_ = 0;
+  int64_t baseUs_ = 0;
+};
@@ -0,0 +1,246 @@
+#include "Resampler.h"
+#include "NativeLog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MX_RS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MX_RS_SSE2 1
+#endif
+
+#define LOG_TAG "Resampler"
+
+namespace {
+
+// Phase tables beyond this are approximated (only exotic rate pairs; every
+// combination of the usual 8k..192k rates reduces to far fewer phases).
+constexpr uint32_t kMaxPhases = 1024;
+constexpr size_t kMaxTaps = 256;
+
+struct QualityParams {
+  size_t taps;
+  double beta;    // Kaiser window shape
+  double rolloff; // passband edge relative to the lower Nyquist
+};
+
+QualityParams paramsFor(ResamplerQuality quality) {
+  switch (quality) {
+  case ResamplerQuality::Low:
+    return {16, 5.7, 0.85};
+  case ResamplerQuality::High:
+    return {64, 11.0, 0.95};
+  case ResamplerQuality::Medium:
+  default:
+    return {32, 8.0, 0.91};
+  }
+}
+
+// Modified Bessel function of the first kind, order 0 (series).
+double besselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  double q = x * x * 0.25;
+  for (int k = 1; k < 64 && term > 1e-12 * sum; ++k) {
+    term *= q / (double(k) * k);
+    sum += term;
+  }
+  return sum;
+}
+
+// taps is a multiple of 8.
+inline float dot(const float *a, const float *b, size_t taps) {
+#if MX_RS_NEON
+  float32x4_t acc0 = vdupq_n_f32(0.0f);
+  float32x4_t acc1 = vdupq_n_f32(0.0f);
+  for (size_t i = 0; i < taps; i += 8) {
+    acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+  float32x4_t acc = vaddq_f32(acc0, acc1);
+#if defined(__aarch64__)
+  return vaddvq_f32(acc);
+#else
+  float32x2_t s = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+  return vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+#elif MX_RS_SSE2
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  for (size_t i = 0; i < taps; i += 8) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+                                       _mm_loadu_ps(b + i + 4)));
+  }
+  __m128 acc = _mm_add_ps(acc0, acc1);
+  acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+  acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+  return _mm_cvtss_f32(acc);
+#else
+  float sum = 0.0f;
+  for (size_t i = 0; i < taps; ++i)
+    sum += a[i] * b[i];
+  return sum;
+#endif
+}
+
+} // namespace
+
+bool PolyphaseResampler::configure(int32_t inRate, int32_t outRate,
+                                   int32_t channels, ResamplerQuality quality,
+                                   size_t maxInputFrames) {
+  active_ = false;
+  if (inRate <= 0 || outRate <= 0 || channels <= 0 || maxInputFrames == 0)
+    return false;
+
+  inRate_ = inRate;
+  outRate_ = outRate;
+  channels_ = channels;
+  maxInputFrames_ = maxInputFrames;
+
+  if (inRate == outRate) {
+    // Bypass: callers write straight to the ring.
+    table_.clear();
+    history_.clear();
+    return true;
+  }
+
+  uint32_t g = std::gcd(uint32_t(inRate), uint32_t(outRate));
+  up_ = uint32_t(outRate) / g;
+  down_ = uint32_t(inRate) / g;
+  if (up_ > kMaxPhases) {
+    // Nearest representable ratio (rate error below 1 / (2 * down)).
+    up_ = kMaxPhases;
+    down_ = uint32_t(std::llround(double(inRate) * kMaxPhases / outRate));
+    MX_LOGW(LOG_TAG, "%d -> %d Hz approximated as %u/%u", inRate, outRate, up_,
+            down_);
+  }
+
+  buildTable(quality);
+
+  stride_ = taps_ + maxInputFrames_;
+  history_.assign(stride_ * channels_, 0.0f);
+  reset();
+
+  active_ = true;
+  MX_LOGD(LOG_TAG, "%d -> %d Hz, %d ch, %u phases x %zu taps", inRate, outRate,
+          channels, up_, taps_);
+  return true;
+}
+
+void PolyphaseResampler::buildTable(ResamplerQuality quality) {
+  QualityParams p = paramsFor(quality);
+
+  // Downsampling narrows the cutoff; keep the transition band the same width
+  // in output terms by widening the filter accordingly.
+  double ratio = double(outRate_) / double(inRate_);
+  double fc = p.rolloff * std::min(1.0, ratio);
+  size_t taps = p.taps;
+  if (ratio < 1.0)
+    taps = size_t(std::ceil(double(taps) / ratio));
+  taps_ = std::min(kMaxTaps, (taps + 7) & ~size_t(7));
+
+  table_.assign(size_t(up_) * taps_, 0.0f);
+
+  const double half = double(taps_) / 2.0;
+  const double i0Beta = besselI0(p.beta);
+  for (uint32_t phase = 0; phase < up_; ++phase) {
+    double frac = double(phase) / double(up_);
+    float *row = &table_[size_t(phase) * taps_];
+    double sum = 0.0;
+    for (size_t k = 0; k < taps_; ++k) {
+      // Distance from the interpolation point (center tap half - 1 + frac).
+      double d = double(k) - (half - 1.0) - frac;
+      double x = d / half;
+      double w = std::fabs(x) >= 1.0
+                     ? 0.0
+                     : besselI0(p.beta * std::sqrt(1.0 - x * x)) / i0Beta;
+      double arg = M_PI * fc * d;
+      double s = std::fabs(arg) < 1e-9 ? 1.0 : std::sin(arg) / arg;
+      double h = fc * s * w;
+      row[k] = float(h);
+      sum += h;
+    }
+    // Unity DC gain per phase (no ripple at the phase rate).
+    for (size_t k = 0; k < taps_; ++k)
+      row[k] = float(row[k] / sum);
+  }
+}
+
+void PolyphaseResampler::reset() {
+  if (history_.empty())
+    return;
+  std::fill(history_.begin(), history_.end(), 0.0f);
+  // Prime with half a window of silence so the first output is centered on
+  // the first input frame (no added delay on the media timeline).
+  filled_ = taps_ / 2 - 1;
+  inputPos_ = 0;
+  phase_ = 0;
+}
+
+size_t PolyphaseResampler::maxOutputFrames(size_t inFrames) const {
+  if (!active_)
+    return inFrames;
+  int64_t avail = int64_t(filled_ + inFrames) - int64_t(taps_) -
+                  int64_t(inputPos_);
+  if (avail < 0)
+    return 0;
+  // Output n reads from window start floor((phase + n * down) / up).
+  return size_t(((avail + 1) * up_ - 1 - phase_) / down_ + 1);
+}
+
+size_t PolyphaseResampler::maxInputFramesFor(size_t outFrames) const {
+  if (!active_)
+    return std::min(outFrames, maxInputFrames_);
+  // Largest avail for which maxOutputFrames() stays <= outFrames.
+  int64_t maxAvail = (int64_t(outFrames) * down_ + phase_) / up_ - 1;
+  int64_t k = maxAvail + int64_t(taps_) + int64_t(inputPos_) - int64_t(filled_);
+  return size_t(std::clamp<int64_t>(k, 0, int64_t(maxInputFrames_)));
+}
+
+size_t PolyphaseResampler::process(const float *in, size_t inFrames,
+                                   float *out) {
+  inFrames = std::min(inFrames, maxInputFrames_);
+  const size_t ch = size_t(channels_);
+
+  // Deinterleave behind the history.
+  for (size_t c = 0; c < ch; ++c) {
+    float *dst = history_.data() + c * stride_ + filled_;
+    const float *src = in + c;
+    for (size_t i = 0; i < inFrames; ++i)
+      dst[i] = src[i * ch];
+  }
+  filled_ += inFrames;
+
+  size_t produced = 0;
+  while (inputPos_ + taps_ <= filled_) {
+    const float *coef = &table_[size_t(phase_) * taps_];
+    const float *x = history_.data() + inputPos_;
+    for (size_t c = 0; c < ch; ++c)
+      out[c] = dot(coef, x + c * stride_, taps_);
+    out += ch;
+    ++produced;
+
+    phase_ += down_;
+    inputPos_ += phase_ / up_;
+    phase_ %= up_;
+  }
+
+  // Keep only what later windows still need.
+  size_t shift = std::min(inputPos_, filled_);
+  if (shift > 0) {
+    size_t keep = filled_ - shift;
+    for (size_t c = 0; c < ch; ++c) {
+      float *plane = history_.data() + c * stride_;
+      memmove(plane, plane + shift, keep * sizeof(float));
+    }
+    filled_ = keep;
+    inputPos_ -= shift;
+  }
+  return produced;
+}
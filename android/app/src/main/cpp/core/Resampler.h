@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* ===================== Polyphase resampler ===================== */
+
+// Filter length / stopband trade-off. Taps are per output sample when
+// upsampling and grow with the ratio when downsampling.
+enum class ResamplerQuality : int32_t {
+  Low = 0,    // 16 taps, ~60 dB
+  Medium = 1, // 32 taps, ~85 dB
+  High = 2,   // 64 taps, ~110 dB
+};
+
+/*
+ * Rational polyphase sample-rate converter for interleaved float PCM.
+ *
+ * The windowed-sinc prototype is split into `up` phases of `taps` coefficients
+ * each (up/down = outRate/inRate reduced by their gcd), so every output frame
+ * is one dot product per channel against a contiguous coefficient row
+ * (NEON/SSE2). Input is kept planar internally for that reason.
+ *
+ * All memory is allocated in configure(); process()/reset() never allocate.
+ * Not thread-safe: owned by the producer (decode) side.
+ */
+class PolyphaseResampler {
+public:
+  // Returns false for invalid rates/channels. maxInputFrames bounds the size
+  // of each process() call.
+  bool configure(int32_t inRate, int32_t outRate, int32_t channels,
+                 ResamplerQuality quality, size_t maxInputFrames = 1024);
+
+  // True when configured with differing rates (otherwise callers bypass it).
+  bool active() const { return active_; }
+
+  int32_t inRate() const { return inRate_; }
+  int32_t outRate() const { return outRate_; }
+  size_t taps() const { return taps_; }
+
+  // Upper bound on frames produced by process(inFrames).
+  size_t maxOutputFrames(size_t inFrames) const;
+  // Largest input (<= maxInputFrames) whose output fits in outFrames.
+  size_t maxInputFramesFor(size_t outFrames) const;
+
+  // Consumes all inFrames (<= maxInputFrames) and writes the produced
+  // interleaved frames to out, returning how many.
+  size_t process(const float *in, size_t inFrames, float *out);
+
+  // Drops filter history (seek / flush).
+  void reset();
+
+private:
+  void buildTable(ResamplerQuality quality);
+
+  bool active_ = false;
+  int32_t inRate_ = 0;
+  int32_t outRate_ = 0;
+  int32_t channels_ = 0;
+
+  // Phase step: each output advances the input position by down/up frames.
+  uint32_t up_ = 1;
+  uint32_t down_ = 1;
+  size_t taps_ = 0; // multiple of 8
+  size_t maxInputFrames_ = 0;
+
+  std::vector<float> table_; // up_ rows x taps_
+
+  // Planar history: per channel [stride_] floats, first filled_ valid.
+  std::vector<float> history_;
+  size_t stride_ = 0;
+  size_t filled_ = 0;
+  size_t inputPos_ = 0; // window start (frames into history)
+  uint32_t phase_ = 0;  // 0..up_-1
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+// Adds to a counter that only the calling thread ever writes: a relaxed
+// load + store instead of fetch_add, so realtime threads never run a
+// read-modify-write (an LL/SC retry loop on 32-bit ARM).
+inline void rtCounterAdd(std::atomic<int64_t> &counter, int64_t by) {
+  counter.store(counter.load(std::memory_order_relaxed) + by,
+                std::memory_order_relaxed);
+}
+
+/*
+ * Duration histogram for realtime threads: log2 buckets of microseconds
+ * plus count, sum and max.
+ *
+ * One writer thread, any number of readers. record() is wait-free: every
+ * counter is updated with rtCounterAdd() by its only writer. Readers see
+ * each counter atomically but not all of them at the same instant, which is
+ * fine for statistics.
+ *
+ * Bucket 0 holds durations below 1 us, bucket i in [1, kBuckets - 2] holds
+ * [2^(i-1), 2^i) us and the last one everything from 2^(kBuckets-2) us on.
+ */
+class RtHistogram {
+public:
+  static constexpr int kBuckets = 20; // last bucket: >= 262 ms
+  // Values written by snapshot(): count, sumUs, maxUs, buckets.
+  static constexpr int kSnapshotSize = 3 + kBuckets;
+
+  static int bucketFor(int64_t us) {
+    if (us <= 0)
+      return 0;
+    int bits = 64 - __builtin_clzll(static_cast<unsigned long long>(us));
+    return std::min(bits, kBuckets - 1);
+  }
+
+  // Writer thread only.
+  void record(int64_t us) {
+    rtCounterAdd(count_, 1);
+    rtCounterAdd(sumUs_, us);
+    if (us > maxUs_.load(std::memory_order_relaxed))
+      maxUs_.store(us, std::memory_order_relaxed);
+    rtCounterAdd(buckets_[bucketFor(us)], 1);
+  }
+
+  // Any thread: fills kSnapshotSize values.
+  void snapshot(int64_t *out) const {
+    out[0] = count_.load(std::memory_order_relaxed);
+    out[1] = sumUs_.load(std::memory_order_relaxed);
+    out[2] = maxUs_.load(std::memory_order_relaxed);
+    for (int i = 0; i < kBuckets; ++i)
+      out[3 + i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+
+  // Not safe against a concurrent record(); callers reset while the
+  // writer is idle (or accept a torn first sample).
+  void reset() {
+    count_.store(0, std::memory_order_relaxed);
+    sumUs_.store(0, std::memory_order_relaxed);
+    maxUs_.store(0, std::memory_order_relaxed);
+    for (auto &b : buckets_)
+      b.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<int64_t> count_{0};
+  std::atomic<int64_t> sumUs_{0};
+  std::atomic<int64_t> maxUs_{0};
+  std::atomic<int64_t> buckets_[kBuckets] = {};
+};
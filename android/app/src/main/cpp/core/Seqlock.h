@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/*
+ * Single-writer sequence lock for small trivially-copyable snapshots.
+ *
+ * The writer bumps the sequence to odd, stores the payload, bumps it back to
+ * even; readers copy the payload and retry if the sequence was odd or moved.
+ * Writers never wait (safe from the audio callback); readers never block the
+ * writer. The payload lives in relaxed atomic words so concurrent copies are
+ * not data races.
+ *
+ * Several writer threads must serialize among themselves (e.g. a mutex).
+ */
+template <typename T> class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Seqlock payload must be trivially copyable");
+
+public:
+  Seqlock() { store(T{}); }
+  explicit Seqlock(const T &initial) { store(initial); }
+
+  void store(const T &value) {
+    uint64_t words[kWords] = {};
+    memcpy(words, &value, sizeof(T));
+
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kWords; ++i)
+      words_[i].store(words[i], std::memory_order_relaxed);
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  T load() const {
+    T value;
+    while (!tryLoad(&value)) {
+    }
+    return value;
+  }
+
+  // One attempt; false if a write was in progress or completed meanwhile.
+  bool tryLoad(T *out) const {
+    uint32_t before = seq_.load(std::memory_order_acquire);
+    if (before & 1u)
+      return false;
+    uint64_t words[kWords];
+    for (size_t i = 0; i < kWords; ++i)
+      words[i] = words_[i].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq_.load(std::memory_order_relaxed) != before)
+      return false;
+    memcpy(out, words, sizeof(T));
+    return true;
+  }
+
+  uint32_t sequence() const { return seq_.load(std::memory_order_acquire); }
+
+private:
+  static constexpr size_t kWords = (sizeof(T) + 7) / 8;
+
+  std::atomic<uint32_t> seq_{0};
+  std::atomic<uint64_t> words_[kWords];
+};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+/*
+ * Lock-free single-producer / single-consumer ring buffer.
+ *
+ * - Capacity is rounded up to a power of two so wrapping is a mask, not a
+ *   division (the old PCM ring paid one `%` per sample in the callback).
+ * - Head and tail live on separate cache lines; each side also keeps a
+ *   cached copy of the other side's index so the shared line is only touched
+ *   when the cached view runs out.
+ * - Bulk read/write are at most two memcpy calls.
+ * - acquireWrite()/commitWrite() expose the free space as (up to) two spans
+ *   so a producer can convert/decode straight into the ring without a
+ *   staging buffer. acquireRead()/commitRead() mirror this for consumers.
+ *
+ * Indices are free-running and wrap naturally; only the difference is used.
+ * Storage is allocated once in the constructor. Nothing after that allocates
+ * or blocks, so both sides are safe on a realtime thread.
+ */
+template <typename T> class SpscRing {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SpscRing stores raw samples and copies with memcpy");
+
+public:
+  static constexpr size_t kCacheLine = 64;
+
+  // Up to two contiguous regions (the second one is non-empty only when the
+  // region wraps around the end of storage).
+  struct Span {
+    T *first = nullptr;
+    size_t firstCount = 0;
+    T *second = nullptr;
+    size_t secondCount = 0;
+
+    size_t size() const { return firstCount + secondCount; }
+  };
+
+  explicit SpscRing(size_t minCapacity)
+      : capacity_(roundUpPow2(minCapacity)), mask_(capacity_ - 1),
+        storage_(new T[capacity_]()) {}
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  size_t capacity() const { return capacity_; }
+
+  /* ───────── Producer side ───────── */
+
+  size_t availableToWrite() const {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return capacity_ - clampUsed(head - tail);
+  }
+
+  // All-or-nothing write. Returns false without writing anything when there
+  // is not enough room; never waits.
+  bool write(const T *data, size_t count) {
+    if (freeSpace(count) < count)
+      return false;
+    writeUnchecked(data, count);
+    return true;
+  }
+
+  // Writes as much as fits and returns the number of elements written.
+  size_t writeSome(const T *data, size_t count) {
+    count = std::min(count, freeSpace(count));
+    writeUnchecked(data, count);
+    return count;
+  }
+
+  // Reserves up to `count` elements of free space. The caller fills the
+  // returned span(s) and publishes with commitWrite(n), n <= span.size().
+  Span acquireWrite(size_t count) {
+    count = std::min(count, freeSpace(count));
+    return spanAt(head_.load(std::memory_order_relaxed), count);
+  }
+
+  void commitWrite(size_t count) {
+    head_.store(head_.load(std::memory_order_relaxed) + count,
+                std::memory_order_release);
+  }
+
+  /* ───────── Consumer side ───────── */
+
+  size_t availableToRead() const {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+    return clampUsed(head - tail);
+  }
+
+  // Reads up to `count` elements and returns how many were copied.
+  size_t read(T *out, size_t count) {
+    count = std::min(count, filled(count));
+    Span s = spanAt(tail_.load(std::memory_order_relaxed), count);
+    if (s.firstCount)
+      memcpy(out, s.first, s.firstCount * sizeof(T));
+    if (s.secondCount)
+      memcpy(out + s.firstCount, s.second, s.secondCount * sizeof(T));
+    commitRead(count);
+    return count;
+  }
+
+  Span acquireRead(size_t count) {
+    count = std::min(count, filled(count));
+    return spanAt(tail_.load(std::memory_order_relaxed), count);
+  }
+
+  void commitRead(size_t count) {
+    tail_.store(tail_.load(std::memory_order_relaxed) + count,
+                std::memory_order_release);
+  }
+
+  /* ───────── Positions ───────── */
+
+  // Elements ever written (producer) / read (consumer) since the last
+  // reset(); free-running like the indices, so compare by difference.
+  size_t writePosition() const { return head_.load(std::memory_order_relaxed); }
+  size_t readPosition() const { return tail_.load(std::memory_order_relaxed); }
+
+  /* ───────── Control ───────── */
+
+  // Empties the ring and zeroes storage (no ghost audio after a seek). Not
+  // safe against a concurrent producer or consumer; callers gate both sides
+  // first.
+  void reset() {
+    memset(static_cast<void *>(storage_.get()), 0, capacity_ * sizeof(T));
+    head_.store(0, std::memory_order_release);
+    tail_.store(0, std::memory_order_release);
+    cachedTail_ = 0;
+    cachedHead_ = 0;
+  }
+
+private:
+  static size_t roundUpPow2(size_t v) {
+    size_t p = 1;
+    while (p < v)
+      p <<= 1;
+    return p;
+  }
+
+  // A reset racing with the consumer can briefly leave tail ahead of head;
+  // treat that as empty instead of reading a huge bogus length.
+  size_t clampUsed(size_t used) const { return used > capacity_ ? 0 : used; }
+
+  // Producer-only: free space, touching the consumer's line only when the
+  // cached (conservative) view is not enough for `want`.
+  size_t freeSpace(size_t want) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t free = capacity_ - clampUsed(head - cachedTail_);
+    if (free < want) {
+      cachedTail_ = tail_.load(std::memory_order_acquire);
+      free = capacity_ - clampUsed(head - cachedTail_);
+    }
+    return free;
+  }
+
+  // Consumer-only: readable elements, refreshing the cached head lazily.
+  size_t filled(size_t want) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t used = clampUsed(cachedHead_ - tail);
+    if (used < want) {
+      cachedHead_ = head_.load(std::memory_order_acquire);
+      used = clampUsed(cachedHead_ - tail);
+    }
+    return used;
+  }
+
+  Span spanAt(size_t index, size_t count) const {
+    Span s;
+    size_t start = index & mask_;
+    size_t firstCount = std::min(count, capacity_ - start);
+    s.first = storage_.get() + start;
+    s.firstCount = firstCount;
+    s.second = storage_.get();
+    s.secondCount = count - firstCount;
+    return s;
+  }
+
+  void writeUnchecked(const T *data, size_t count) {
+    Span s = spanAt(head_.load(std::memory_order_relaxed), count);
+    if (s.firstCount)
+      memcpy(s.first, data, s.firstCount * sizeof(T));
+    if (s.secondCount)
+      memcpy(s.second, data + s.firstCount, s.secondCount * sizeof(T));
+    commitWrite(count);
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<T[]> storage_;
+
+  // Producer-owned line: write index + producer's view of the read index.
+  alignas(kCacheLine) std::atomic<size_t> head_{0};
+  size_t cachedTail_ = 0;
+
+  // Consumer-owned line: read index + consumer's view of the write index.
+  alignas(kCacheLine) std::atomic<size_t> tail_{0};
+  size_t cachedHead_ = 0;
+};
@@ -0,0 +1,251 @@
+#include "TimeStretch.h"
+#include "NativeLog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MX_TS_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MX_TS_SSE2 1
+#endif
+
+#define LOG_TAG "TimeStretch"
+
+namespace {
+
+// Segment hop (half the window) and search radius. 12 ms hops keep the
+// overlap shorter than a syllable, 8 ms of search covers one period of any
+// voice fundamental above 125 Hz.
+constexpr int32_t kHopMs = 12;
+constexpr int32_t kSearchMs = 8;
+// The search scans every kCoarseStep-th offset, then refines around the best.
+constexpr size_t kCoarseStep = 4;
+
+// n is a multiple of 8.
+inline float dot(const float *a, const float *b, size_t n) {
+#if MX_TS_NEON
+  float32x4_t acc0 = vdupq_n_f32(0.0f);
+  float32x4_t acc1 = vdupq_n_f32(0.0f);
+  for (size_t i = 0; i < n; i += 8) {
+    acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+  float32x4_t acc = vaddq_f32(acc0, acc1);
+#if defined(__aarch64__)
+  return vaddvq_f32(acc);
+#else
+  float32x2_t s = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+  return vget_lane_f32(vpadd_f32(s, s), 0);
+#endif
+#elif MX_TS_SSE2
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  for (size_t i = 0; i < n; i += 8) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4),
+                                       _mm_loadu_ps(b + i + 4)));
+  }
+  __m128 acc = _mm_add_ps(acc0, acc1);
+  acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+  acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+  return _mm_cvtss_f32(acc);
+#else
+  float sum = 0.0f;
+  for (size_t i = 0; i < n; ++i)
+    sum += a[i] * b[i];
+  return sum;
+#endif
+}
+
+} // namespace
+
+bool TimeStretcher::configure(int32_t sampleRate, int32_t channels,
+                              size_t maxInputFrames) {
+  configured_ = false;
+  if (sampleRate <= 0 || channels <= 0 || maxInputFrames == 0)
+    return false;
+
+  channels_ = channels;
+  maxInputFrames_ = maxInputFrames;
+  hop_ = std::max<size_t>(16, size_t(sampleRate) * kHopMs / 1000);
+  search_ = std::max<size_t>(kCoarseStep, size_t(sampleRate) * kSearchMs / 1000);
+  corrLen_ = hop_ & ~size_t(7);
+
+  window_.resize(2 * hop_);
+  for (size_t i = 0; i < window_.size(); ++i) {
+    // Periodic Hann: w[i] + w[i + hop] == 1, so overlapped halves sum flat.
+    window_[i] = float(0.5 - 0.5 * std::cos(M_PI * double(i) / double(hop_)));
+  }
+
+  // Between calls at most one window, the search area and one input hop
+  // stay buffered (see discardConsumed()).
+  size_t maxHopIn = size_t(std::ceil(double(hop_) * kMaxRate));
+  capacity_ = maxInputFrames_ + 2 * hop_ + 2 * search_ + maxHopIn + 8;
+  input_.assign(capacity_ * size_t(channels_), 0.0f);
+  mono_.assign(capacity_, 0.0f);
+  energy_.assign(2 * search_ + corrLen_ + 2, 0.0);
+  tail_.assign(hop_ * size_t(channels_), 0.0f);
+  // Slowest rate: one segment per half hop of input.
+  maxOutPerCall_ = (2 * capacity_ / hop_ + 1) * hop_;
+
+  configured_ = true;
+  setRate(rate_);
+  reset();
+  MX_LOGD(LOG_TAG, "%d Hz, %d ch, hop %zu, search +-%zu", sampleRate, channels,
+          hop_, search_);
+  return true;
+}
+
+void TimeStretcher::setRate(float rate) {
+  rate_ = std::clamp(rate, kMinRate, kMaxRate);
+  hopInFx_ = std::llround(double(hop_) * rate_ * double(1 << kFxShift));
+}
+
+void TimeStretcher::reset() {
+  filled_ = 0;
+  posFx_ = 0;
+  prevStart_ = 0;
+  havePrev_ = false;
+  std::fill(tail_.begin(), tail_.end(), 0.0f);
+}
+
+size_t TimeStretcher::inputNeededFor(size_t hops) const {
+  // Last of the segments: its window plus the search area past it.
+  size_t nominal =
+      size_t((posFx_ + int64_t(hops - 1) * hopInFx_) >> kFxShift);
+  return nominal + search_ + 2 * hop_;
+}
+
+size_t TimeStretcher::maxOutputFrames(size_t inFrames) const {
+  if (!active())
+    return inFrames;
+  size_t avail = filled_ + inFrames;
+  if (avail < inputNeededFor(1))
+    return 0;
+  // Segment j fits while its nominal start, floor((pos + j * hopIn) / 2^16),
+  // is at most last.
+  int64_t last = int64_t(avail - search_ - 2 * hop_);
+  int64_t span = ((last + 1) << kFxShift) - posFx_;
+  return size_t((span + hopInFx_ - 1) / hopInFx_) * hop_;
+}
+
+size_t TimeStretcher::maxInputFramesFor(size_t outFrames) const {
+  if (!active())
+    return outFrames;
+  // One frame short of what the (hops + 1)-th segment needs.
+  size_t hops = outFrames / hop_;
+  size_t limit = inputNeededFor(hops + 1) - 1;
+  return limit > filled_ ? limit - filled_ : 0;
+}
+
+size_t TimeStretcher::bestOffset(size_t nominal) {
+  // Continue the previous segment: its input right after the overlap.
+  const float *target = &mono_[prevStart_ + hop_];
+  size_t lo = nominal > search_ ? nominal - search_ : 0;
+  size_t hi = nominal + search_;
+
+  // Candidate energies from running sums, so scoring is one dot product.
+  size_t span = hi - lo + corrLen_;
+  energy_[0] = 0.0;
+  for (size_t i = 0; i < span; ++i) {
+    double s = mono_[lo + i];
+    energy_[i + 1] = energy_[i] + s * s;
+  }
+  const double floor = 1e-9 * double(corrLen_);
+  auto score = [&](size_t x) {
+    double e = energy_[x - lo + corrLen_] - energy_[x - lo];
+    return double(dot(target, &mono_[x], corrLen_)) / std::sqrt(e + floor);
+  };
+
+  size_t best = nominal;
+  double bestScore = score(nominal);
+  for (size_t x = lo; x <= hi; x += kCoarseStep) {
+    double s = score(x);
+    if (s > bestScore) {
+      bestScore = s;
+      best = x;
+    }
+  }
+  size_t fineLo = best > lo + kCoarseStep - 1 ? best - (kCoarseStep - 1) : lo;
+  size_t fineHi = std::min(hi, best + kCoarseStep - 1);
+  for (size_t x = fineLo; x <= fineHi; ++x) {
+    double s = score(x);
+    if (s > bestScore) {
+      bestScore = s;
+      best = x;
+    }
+  }
+  return best;
+}
+
+size_t TimeStretcher::process(const float *in, size_t inFrames, float *out) {
+  if (!active()) {
+    std::memcpy(out, in, inFrames * size_t(channels_) * sizeof(float));
+    return inFrames;
+  }
+
+  const size_t ch = size_t(channels_);
+  inFrames = std::min(inFrames, capacity_ - filled_);
+  std::memcpy(&input_[filled_ * ch], in, inFrames * ch * sizeof(float));
+  const float norm = 1.0f / float(channels_);
+  for (size_t f = 0; f < inFrames; ++f) {
+    float sum = 0.0f;
+    for (size_t c = 0; c < ch; ++c)
+      sum += in[f * ch + c];
+    mono_[filled_ + f] = sum * norm;
+  }
+  filled_ += inFrames;
+
+  size_t produced = 0;
+  while (inputNeededFor(1) <= filled_) {
+    size_t nominal = size_t(posFx_ >> kFxShift);
+    size_t start = havePrev_ ? bestOffset(nominal) : nominal;
+
+    // First half overlaps the pending tail; the second half becomes the
+    // next tail.
+    const float *seg = &input_[start * ch];
+    float *dst = out + produced * ch;
+    for (size_t f = 0; f < hop_; ++f) {
+      float rise = window_[f];
+      float fall = window_[hop_ + f];
+      for (size_t c = 0; c < ch; ++c) {
+        size_t i = f * ch + c;
+        dst[i] = tail_[i] + rise * seg[i];
+        tail_[i] = fall * seg[hop_ * ch + i];
+      }
+    }
+
+    prevStart_ = start;
+    havePrev_ = true;
+    posFx_ += hopInFx_;
+    produced += hop_;
+  }
+
+  discardConsumed();
+  return produced;
+}
+
+void TimeStretcher::discardConsumed() {
+  if (!havePrev_)
+    return;
+  // Keep what the next segment can still read: the previous segment's
+  // continuation (the correlation target) and the search area.
+  size_t nominal = size_t(posFx_ >> kFxShift);
+  size_t keepFrom = std::min(prevStart_ + hop_,
+                             nominal > search_ ? nominal - search_ : 0);
+  keepFrom = std::min(keepFrom, filled_);
+  if (keepFrom == 0)
+    return;
+
+  const size_t ch = size_t(channels_);
+  size_t keep = filled_ - keepFrom;
+  std::memmove(input_.data(), &input_[keepFrom * ch], keep * ch * sizeof(float));
+  std::memmove(mono_.data(), &mono_[keepFrom], keep * sizeof(float));
+  filled_ = keep;
+  posFx_ -= int64_t(keepFrom) << kFxShift;
+  prevStart_ -= keepFrom;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* ===================== WSOLA time stretcher ===================== */
+
+/*
+ * Pitch-preserving tempo change for interleaved float PCM (WSOLA: waveform
+ * similarity overlap-add).
+ *
+ * Output is built from Hann-windowed segments of 2 * hop frames overlapped by
+ * half. The segment for output hop k is taken near input position
+ * k * hop * rate; within +-kSearchMs of it the start that best continues the
+ * previous segment (normalized cross-correlation of a mono downmix, NEON/SSE2)
+ * is chosen, so the overlap joins waveforms in phase instead of smearing them.
+ * Output frame n corresponds to input frame n * rate, give or take the search
+ * window.
+ *
+ * All memory is allocated in configure(); process()/reset() never allocate.
+ * Not thread-safe: owned by the producer (decode) side.
+ */
+class TimeStretcher {
+public:
+  static constexpr float kMinRate = 0.5f;
+  static constexpr float kMaxRate = 3.0f;
+
+  // Returns false for invalid rates/channels. maxInputFrames bounds the size
+  // of each process() call.
+  bool configure(int32_t sampleRate, int32_t channels,
+                 size_t maxInputFrames = 1024);
+
+  // Clamped to [kMinRate, kMaxRate]. Takes effect at the next hop; callers
+  // that splice the input (seek / flush) reset() as well.
+  void setRate(float rate);
+  float rate() const { return rate_; }
+
+  // True when configured and the rate is not 1 (otherwise callers bypass it).
+  bool active() const { return configured_ && hopInFx_ != hopFx(); }
+
+  // Frames produced by process(inFrames) given the input already buffered.
+  size_t maxOutputFrames(size_t inFrames) const;
+  // Largest input whose output fits in outFrames, fed in process() calls
+  // of at most maxInputFrames each (the output does not depend on how the
+  // input is split).
+  size_t maxInputFramesFor(size_t outFrames) const;
+  // Upper bound on the output of any single process() call.
+  size_t maxOutputFramesPerCall() const { return maxOutPerCall_; }
+
+  // Consumes all inFrames (<= maxInputFrames) and writes the produced
+  // interleaved frames to out, returning how many. Up to one segment plus
+  // the search window of input stays buffered between calls.
+  size_t process(const float *in, size_t inFrames, float *out);
+
+  // Drops buffered input and the pending overlap (seek / flush).
+  void reset();
+
+private:
+  static constexpr int kFxShift = 16; // input positions in 1/65536 frames
+
+  int64_t hopFx() const { return int64_t(hop_) << kFxShift; }
+  // Input frames needed before `hops` more segments can be produced.
+  size_t inputNeededFor(size_t hops) const;
+  size_t bestOffset(size_t nominal);
+  void discardConsumed();
+
+  bool configured_ = false;
+  int32_t channels_ = 0;
+  float rate_ = 1.0f;
+  size_t maxInputFrames_ = 0;
+
+  size_t hop_ = 0;      // output frames per segment, half the window
+  size_t search_ = 0;   // +- frames searched around the nominal position
+  size_t corrLen_ = 0;  // correlated frames, multiple of 8
+  int64_t hopInFx_ = 0; // input advance per segment (hop_ * rate)
+  size_t maxOutPerCall_ = 0;
+
+  std::vector<float> window_; // 2 * hop_ (periodic Hann)
+
+  // Buffered input: interleaved frames, a mono downmix and its running
+  // energy (prefix sums over the search area, rebuilt per segment).
+  std::vector<float> input_;
+  std::vector<float> mono_;
+  std::vector<double> energy_;
+  size_t capacity_ = 0;
+  size_t filled_ = 0;
+
+  std::vector<float> tail_; // second half of the previous segment, windowed
+  int64_t posFx_ = 0;       // nominal start of the next segment
+  size_t prevStart_ = 0;    // chosen start of the previous segment
+  bool havePrev_ = false;
+};
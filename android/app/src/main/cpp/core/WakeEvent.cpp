@@ -0,0 +1,73 @@
+#include "WakeEvent.h"
+
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+              "futex word must be a plain 32-bit integer");
+
+static long futexWait(std::atomic<int32_t> *addr, int32_t expected,
+                      const timespec *timeout) {
+  return syscall(SYS_futex, reinterpret_cast<int32_t *>(addr),
+                 FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+}
+
+static long futexWake(std::atomic<int32_t> *addr, int32_t count) {
+  return syscall(SYS_futex, reinterpret_cast<int32_t *>(addr),
+                 FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+static int64_t monotonicUs() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void WakeEvent::notify() {
+  if (state_.exchange(kSignaled, std::memory_order_acq_rel) == kWaiting) {
+    futexWake(&state_, 1);
+  }
+}
+
+bool WakeEvent::wait(int64_t timeoutUs) {
+  const int64_t deadlineUs = timeoutUs >= 0 ? monotonicUs() + timeoutUs : -1;
+
+  for (;;) {
+    // Consume a pending signal first.
+    int32_t expected = kSignaled;
+    if (state_.compare_exchange_strong(expected, kIdle,
+                                       std::memory_order_acq_rel)) {
+      return true;
+    }
+
+    // Announce that we are about to park. Fails only if a signal raced in.
+    expected = kIdle;
+    if (!state_.compare_exchange_strong(expected, kWaiting,
+                                        std::memory_order_acq_rel) &&
+        expected != kWaiting) {
+      continue;
+    }
+
+    timespec ts{};
+    const timespec *tsp = nullptr;
+    if (deadlineUs >= 0) {
+      int64_t remainingUs = deadlineUs - monotonicUs();
+      if (remainingUs <= 0) {
+        expected = kWaiting;
+        if (state_.compare_exchange_strong(expected, kIdle,
+                                           std::memory_order_acq_rel)) {
+          return false;
+        }
+        continue; // signaled at the last moment
+      }
+      ts.tv_sec = remainingUs / 1000000;
+      ts.tv_nsec = (remainingUs % 1000000) * 1000;
+      tsp = &ts;
+    }
+
+    // Returns immediately if the state is no longer kWaiting (EAGAIN).
+    futexWait(&state_, kWaiting, tsp);
+  }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Auto-reset wake event for one waiting thread (futex based).
+ *
+ * notify() is realtime-safe: one atomic exchange, plus a FUTEX_WAKE syscall
+ * only when the waiter is actually parked. It never blocks or allocates, so
+ * the AAudio data callback can use it to wake the decode thread.
+ *
+ * A notify() that arrives while nobody waits is remembered; the next wait()
+ * returns immediately. Callers always re-check their own condition after
+ * waking.
+ */
+class WakeEvent {
+public:
+  void notify();
+
+  // Blocks until notified or until `timeoutUs` elapses (< 0 = no timeout).
+  // Returns true when woken by notify().
+  bool wait(int64_t timeoutUs = -1);
+
+private:
+  static constexpr int32_t kIdle = 0;
+  static constexpr int32_t kSignaled = 1;
+  static constexpr int32_t kWaiting = 2;
+
+  std::atomic<int32_t> state_{kIdle};
+};
@@ -2,3 +2,33 @@
 
 // Global singleton instance
 AudioDebug gAudioDebug;
+
+void AudioDebug::snapshotMetrics(int64_t *out) {
+  out[0] = callbackCount.load(std::memory_order_relaxed);
+  out[1] = underrunCallbacks.load(std::memory_order_relaxed);
+  out[2] = underrunFrames.load(std::memory_order_relaxed);
+  out[3] = ringFillMinFrames.load(std::memory_order_relaxed);
+  out[4] = ringFillMaxFrames.load(std::memory_order_relaxed);
+  out[5] = xruns.load(std::memory_order_relaxed);
+  out[6] = droppedWrites.load(std::memory_order_relaxed);
+  out[7] = writeShortfalls.load(std::memory_order_relaxed);
+  int64_t *hist = out + kMetricScalars;
+  callbackPeriodUs.snapshot(hist);
+  callbackDurationUs.snapshot(hist + RtHistogram::kSnapshotSize);
+  decodeIterationUs.snapshot(hist + 2 * RtHistogram::kSnapshotSize);
+  fillWindow.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioDebug::resetMetrics() {
+  callbackCount.store(0, std::memory_order_relaxed);
+  underrunCallbacks.store(0, std::memory_order_relaxed);
+  underrunFrames.store(0, std::memory_order_relaxed);
+  ringFillMinFrames.store(-1, std::memory_order_relaxed);
+  ringFillMaxFrames.store(-1, std::memory_order_relaxed);
+  xruns.store(0, std::memory_order_relaxed);
+  droppedWrites.store(0, std::memory_order_relaxed);
+  writeShortfalls.store(0, std::memory_order_relaxed);
+  callbackPeriodUs.reset();
+  callbackDurationUs.reset();
+  decodeIterationUs.reset();
+}
@@ -2,6 +2,8 @@
 #include <atomic>
 #include <cstdint>
 
+#include "core/RtHistogram.h"
+
 struct AudioDebug {
   std::atomic<bool> nativePlayCalled{false}; // ✅ ADD THIS
 
@@ -22,7 +24,127 @@ struct AudioDebug {
   // Decoder
   std::atomic<bool> decoderProduced{false};
   std::atomic<bool> decodeActive{false};
+  // Decode thread returns from a park (event or backoff timeout). Sampled
+  // twice by the overlay to show wakeups per second.
+  std::atomic<int64_t> decodeWakeups{0};
+  // AudioEngine::DecodeMode of the current engine (0 = sync, 1 = async)
+  std::atomic<int> decodeMode{0};
+  // First start() → first callback that rendered decoded audio (-1 = none)
+  std::atomic<int64_t> firstAudioUs{-1};
+
+  // Last open, per stage (us, -1 = not reached): container probe (dup,
+  // fstat, setDataSource, track scan), codec create/configure/start, output
+  // acquire, the output prewarm run alongside the first two (async open
+  // only), open request → ready, and open request → first callback that
+  // rendered decoded audio
+  std::atomic<int64_t> openDemuxUs{-1};
+  std::atomic<int64_t> openCodecUs{-1};
+  std::atomic<int64_t> openOutputUs{-1};
+  std::atomic<int64_t> openWarmUs{-1};
+  std::atomic<int64_t> openReadyUs{-1};
+  std::atomic<int64_t> openFirstAudioUs{-1};
+
+  // Decoder pool: opens that reused an idle decoder vs. created one, and
+  // decoders parked right now
+  std::atomic<int64_t> codecPoolHits{0};
+  std::atomic<int64_t> codecPoolMisses{0};
+  std::atomic<int> codecPoolIdle{0};
+
+  // Last accurate seek: seek → target reached (us, -1 = in progress) and
+  // the decoded frames dropped on the way
+  std::atomic<int64_t> seekLatencyUs{-1};
+  std::atomic<int64_t> seekSkippedFrames{0};
+  // Seek commands posted vs. run by the decode thread (the rest were
+  // superseded by a later seek in the same batch)
+  std::atomic<int64_t> seeksPosted{0};
+  std::atomic<int64_t> seeksApplied{0};
+  // Commands of any kind dropped because the queue stayed full (decode
+  // thread stuck)
+  std::atomic<int64_t> commandsDropped{0};
+
+  // Live audio-track switches and the last one's latency: request → first
+  // audio of the new track queued (us, -1 = none yet)
+  std::atomic<int64_t> trackSwitches{0};
+  std::atomic<int64_t> trackSwitchUs{-1};
+
+  // Rewind cache: decoded audio held (us), its configured size (0 = seeks
+  // are not served from it) and seeks it served
+  std::atomic<int64_t> historyUs{0};
+  std::atomic<int64_t> historyCapacityUs{0};
+  std::atomic<int64_t> historyHits{0};
+
+  // Gapless: a prepared next item is ready, how long preparing it took
+  // (us, -1 while in progress) and transitions made
+  std::atomic<bool> nextReady{false};
+  std::atomic<int64_t> nextPrepareUs{-1};
+  std::atomic<int64_t> gaplessTransitions{0};
+
+  // Shared output session: last engine's stream acquire time (us), whether
+  // the open stream was reused, and opens vs. reuses so far
+  std::atomic<int64_t> outputAcquireUs{-1};
+  std::atomic<bool> outputReused{false};
+  std::atomic<int64_t> outputOpens{0};
+  std::atomic<int64_t> outputReuses{0};
+  // What the open stream was granted (exclusive sharing, its
+  // AAUDIO_PERFORMANCE_MODE_*) and its buffer size and burst (frames)
+  std::atomic<bool> outputExclusive{false};
+  std::atomic<int> outputPerformanceMode{0};
+  std::atomic<int32_t> outputBufferFrames{0};
+  std::atomic<int32_t> outputBurstFrames{0};
+
+  // Sample-rate conversion: decoder rate being converted (0 = none) and the
+  // stream rate it is converted to
+  std::atomic<int> resampleFromHz{0};
+  std::atomic<int> streamSampleRate{0};
+  // Decoder vs. stream channel counts (they differ when downmixing)
+  std::atomic<int> codecChannels{0};
+  std::atomic<int> streamChannels{0};
+
+  // Written-but-not-yet-audible audio, from AAudio timestamps (us)
+  std::atomic<int64_t> outputLatencyUs{0};
 
   // Ring buffer state (frames)
   std::atomic<int64_t> bufferFill{0};
+
+  /* ───────── Realtime metrics ───────── */
+  // Written wait-free by their single writer (rtCounterAdd / relaxed
+  // stores, never a read-modify-write) and read in one batch by
+  // snapshotMetrics().
+
+  // Callback thread: time between callbacks and spent in one (us),
+  // callbacks that had to pad with silence mid-playback and the frames
+  // padded, and the ring fill (frames) seen at callback entry since the
+  // last snapshot (-1 = no callback rendered since)
+  RtHistogram callbackPeriodUs;
+  RtHistogram callbackDurationUs;
+  std::atomic<int64_t> underrunCallbacks{0};
+  std::atomic<int64_t> underrunFrames{0};
+  std::atomic<int64_t> ringFillMinFrames{-1};
+  std::atomic<int64_t> ringFillMaxFrames{-1};
+  // Bumped by each snapshot; the callback starts a new min/max window when
+  // it sees a value other than the one it last acted on.
+  std::atomic<uint32_t> fillWindow{0};
+  uint32_t fillWindowSeen = 0; // callback-owned
+
+  // Decode thread: busy time of one decode-loop pass (us, parks excluded),
+  // ring writes refused for lack of space (audio dropped), decoded audio
+  // the history could not take yet (kept and retried), and the output
+  // stream's underrun count as reported by AAudioStream_getXRunCount
+  RtHistogram decodeIterationUs;
+  std::atomic<int64_t> droppedWrites{0};
+  std::atomic<int64_t> writeShortfalls{0};
+  std::atomic<int64_t> xruns{0};
+
+  // snapshotMetrics() layout: kMetricScalars values in the order
+  // [callbackCount, underrunCallbacks, underrunFrames, ringFillMin,
+  //  ringFillMax, xruns, droppedWrites, writeShortfalls], then the
+  // callbackPeriodUs, callbackDurationUs and decodeIterationUs histograms
+  // (RtHistogram::kSnapshotSize values each).
+  static constexpr int kMetricScalars = 8;
+  static constexpr int kMetricsSize =
+      kMetricScalars + 3 * RtHistogram::kSnapshotSize;
+  // Any thread. Also starts a new ring fill window.
+  void snapshotMetrics(int64_t *out);
+  // Zeroes the metrics; only while no engine is rendering or decoding.
+  void resetMetrics();
 };
\ No newline at end of file
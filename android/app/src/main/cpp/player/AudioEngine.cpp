@@ -1,5 +1,7 @@
 #include "AudioEngine.h"
 #include "AudioDebug.h"
+#include "CodecPool.h"
+#include "NdkCompat.h"
 
 #include <aaudio/AAudio.h>
 #include <media/NdkMediaCodec.h>
@@ -8,10 +10,10 @@
 #include <algorithm>
 #include <android/log.h>
 #include <atomic>
+#include <cmath>
 #include <cstring>
-#include <sys/stat.h>
 #include <thread>
-#include <unistd.h>
+#include <time.h>
 
 #define LOG_TAG "AudioEngine"
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
@@ -31,14 +33,18 @@ static void aaudioStateCallback(AAudioStream *, void *userData,
 }
 #endif
 
-/* ===================== PCM helper ===================== */
-
-static inline int16_t floatToPcm16(float v) {
-  if (v > 1.0f)
-    v = 1.0f;
-  if (v < -1.0f)
-    v = -1.0f;
-  return static_cast<int16_t>(v * 32767.0f);
+// MediaFormat key for the PCM sample encoding (AMEDIAFORMAT_KEY_PCM_ENCODING
+// is only declared from API 28; the key itself is understood earlier).
+static const char *const kKeyPcmEncoding = "pcm-encoding";
+// Same for AMEDIAFORMAT_KEY_CHANNEL_MASK (AudioFormat.CHANNEL_OUT_* bits).
+static const char *const kKeyChannelMask = "channel-mask";
+// AMEDIAFORMAT_KEY_ENCODER_PADDING (API 28 header).
+static const char *const kKeyEncoderPadding = "encoder-padding";
+
+static int64_t monotonicUs() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
 }
 
 /* ===================== Lifecycle ===================== */
@@ -49,6 +55,7 @@ AudioEngine::AudioEngine(VirtualClock *clock) : virtualClock_(clock) {
 
 AudioEngine::~AudioEngine() {
   stop();
+  cancelNext();
   cleanupAAudio();
   cleanupMedia();
 }
@@ -57,37 +64,28 @@ AudioEngine::~AudioEngine() {
 
 bool AudioEngine::open(const char *path) {
   gAudioDebug.openStage.store(1);
-
-  // Reset audio-track flag for this new file (MANDATORY)
-  hasAudioTrack_ = false;
-
-  extractor_ = AMediaExtractor_new();
-  if (!extractor_)
+  auto demuxer = std::make_shared<Demuxer>();
+  if (!demuxer->openPath(path))
     return false;
+  return open(std::move(demuxer));
+}
 
-  if (AMediaExtractor_setDataSource(extractor_, path) != AMEDIA_OK) {
+bool AudioEngine::openFd(int fd, int64_t offset, int64_t length) {
+  gAudioDebug.openStage.store(1);
+  auto demuxer = std::make_shared<Demuxer>();
+  if (!demuxer->openFd(fd, offset, length))
     return false;
-  }
-  gAudioDebug.openStage.store(2);
-
-  int audioTrack = -1;
-  size_t trackCount = AMediaExtractor_getTrackCount(extractor_);
-
-  for (size_t i = 0; i < trackCount; ++i) {
-    AMediaFormat *fmt = AMediaExtractor_getTrackFormat(extractor_, i);
-    const char *mime = nullptr;
-
-    if (AMediaFormat_getString(fmt, AMEDIAFORMAT_KEY_MIME, &mime) && mime &&
-        !strncmp(mime, "audio/", 6)) {
+  return open(std::move(demuxer));
+}
 
-      format_ = fmt;
-      audioTrack = (int)i;
-      break;
-    }
+bool AudioEngine::open(std::shared_ptr<Demuxer> demuxer) {
+  // Reset audio-track flag for this new file (MANDATORY)
+  hasAudioTrack_ = false;
 
-    AMediaFormat_delete(fmt);
-  }
+  gAudioDebug.openStage.store(2);
 
+  // ─── Find audio track ───
+  int32_t audioTrack = demuxer->findTrack("audio/");
   if (audioTrack < 0) {
     return false;
   }
@@ -97,7 +95,11 @@ bool AudioEngine::open(const char *path) {
 
   gAudioDebug.openStage.store(3);
 
-  AMediaExtractor_selectTrack(extractor_, audioTrack);
+  demuxer_ = std::move(demuxer);
+  track_ = audioTrack;
+  format_ = demuxer_->trackFormat(track_);
+  // Packets start queueing now, while the codec and AAudio are set up.
+  demuxSerial_ = demuxer_->attach(track_, &wakeEvent_);
 
   const char *mime = nullptr;
   AMediaFormat_getString(format_, AMEDIAFORMAT_KEY_MIME, &mime);
@@ -110,6 +112,10 @@ bool AudioEngine::open(const char *path) {
 
   sampleRate_ = (sr > 0) ? sr : 48000;
   channelCount_ = (ch > 0) ? ch : 2;
+  codecSampleRate_ = sampleRate_;
+  codecChannelCount_ = channelCount_;
+  codecChannelMask_ = 0;
+  AMediaFormat_getInt32(format_, kKeyChannelMask, &codecChannelMask_);
 
   // Extract duration from format
   int64_t durationUs = 0;
@@ -118,151 +124,168 @@ bool AudioEngine::open(const char *path) {
   } else {
     durationUs_ = 0;
   }
+  itemEndUs_ = itemEndFor(format_, durationUs_);
 
-  codec_ = AMediaCodec_createDecoderByType(mime);
-  if (!codec_)
-    return false;
-  gAudioDebug.openStage.store(4);
-
-  if (AMediaCodec_configure(codec_, format_, nullptr, nullptr, 0) != AMEDIA_OK)
-    return false;
-  gAudioDebug.openStage.store(5);
-
-  if (AMediaCodec_start(codec_) != AMEDIA_OK)
+  int64_t stageUs = monotonicUs();
+  if (!configureCodec(mime))
     return false;
-  gAudioDebug.openStage.store(6);
-
-  gAudioDebug.openStage.store(7);
+  gAudioDebug.openCodecUs.store(monotonicUs() - stageUs);
 
+  stageUs = monotonicUs();
   if (!setupAAudio())
     return false;
+  gAudioDebug.openOutputUs.store(monotonicUs() - stageUs);
 
+  gAudioDebug.openStage.store(7);
   return true;
 }
 
-bool AudioEngine::openFd(int fd, int64_t offset, int64_t length) {
+/* ===================== Codec ===================== */
 
-  // 🔐 CRITICAL: duplicate fd so GC / Java cannot close it
-  int dupFd = dup(fd);
-  if (dupFd < 0) {
+bool AudioEngine::configureCodec(const char *mime) {
+  // A pooled decoder of the same type skips component creation. Which pool
+  // entries fit depends on the decode mode it is going to be used in.
+  bool wantAsync =
+      preferAsyncDecode_ && ndkcompat::mediaCodecSetAsyncNotifyCallback();
+  CodecPool::Key key = CodecPool::keyFor(format_);
+  key.mime = mime;
+  codec_ = CodecPool::instance().acquire(key, wantAsync);
+  if (!codec_)
     return false;
-  }
 
-  // Reset audio-track flag for this new file (MANDATORY)
-  hasAudioTrack_ = false;
+  gAudioDebug.openStage.store(4);
 
-  // Rewind fix: ensure duplicated fd points to file start. Some Java callers
-  // may have advanced the shared offset which breaks native extraction.
-  if (lseek(dupFd, 0, SEEK_SET) < 0) {
-    close(dupFd);
-    return false;
+  // Async mode: the notify callback must be installed before configure.
+  decodeMode_ = DecodeMode::Sync;
+  if (preferAsyncDecode_) {
+    auto setAsyncCallback = ndkcompat::mediaCodecSetAsyncNotifyCallback();
+    if (setAsyncCallback) {
+      if (setAsyncCallback(codec_, asyncCallbacks(), this) == AMEDIA_OK) {
+        decodeMode_ = DecodeMode::Async;
+      } else {
+        LOGE("setAsyncNotifyCallback failed, using sync decode");
+      }
+    }
   }
+  gAudioDebug.decodeMode.store(static_cast<int>(decodeMode_));
 
-  gAudioDebug.openStage.store(1);
-
-  extractor_ = AMediaExtractor_new();
-  if (!extractor_) {
-    close(dupFd);
-    return false;
-  }
+  // Ask for float output. Decoders that cannot do it keep 16-bit; the actual
+  // encoding is read back from the output format either way.
+  AMediaFormat_setInt32(format_, kKeyPcmEncoding, kAndroidEncodingPcmFloat);
 
-  // NDK requirement: AMediaExtractor_setDataSourceFd does NOT accept length=-1.
-  // Calculate actual file length using fstat and pass it explicitly.
-  struct stat st{};
-  if (fstat(dupFd, &st) != 0) {
-    close(dupFd);
-    LOGE("fstat(dupFd) failed");
+  if (AMediaCodec_configure(codec_, format_, nullptr, nullptr, 0) != AMEDIA_OK)
     return false;
-  }
 
-  int64_t fileLength = st.st_size;
+  gAudioDebug.openStage.store(5);
 
-  // Ensure fd is at start
-  if (lseek(dupFd, 0, SEEK_SET) < 0) {
-    close(dupFd);
-    LOGE("lseek(dupFd) failed");
+  if (AMediaCodec_start(codec_) != AMEDIA_OK)
     return false;
-  }
 
-  if (AMediaExtractor_setDataSourceFd(extractor_, dupFd, offset, fileLength) !=
-      AMEDIA_OK) {
-    close(dupFd);
-    LOGE("Extractor setDataSourceFd FAILED");
-    return false;
-  }
+  gAudioDebug.openStage.store(6);
 
-  gAudioDebug.openStage.store(2);
+  if (AMediaFormat *outFormat = AMediaCodec_getOutputFormat(codec_)) {
+    updateCodecOutputFormat(outFormat);
+    AMediaFormat_delete(outFormat);
+  }
 
-  // ─── Find audio track ───
-  int audioTrack = -1;
-  size_t trackCount = AMediaExtractor_getTrackCount(extractor_);
+  LOGD("Codec %s started (%s decode)", mime,
+       decodeMode_ == DecodeMode::Async ? "async" : "sync");
+  return true;
+}
 
-  for (size_t i = 0; i < trackCount; ++i) {
-    AMediaFormat *fmt = AMediaExtractor_getTrackFormat(extractor_, i);
-    const char *mime = nullptr;
+AMediaCodecOnAsyncNotifyCallback AudioEngine::asyncCallbacks() {
+  AMediaCodecOnAsyncNotifyCallback cb{};
+  cb.onAsyncInputAvailable = AudioEngine::onAsyncInputAvailable;
+  cb.onAsyncOutputAvailable = AudioEngine::onAsyncOutputAvailable;
+  cb.onAsyncFormatChanged = AudioEngine::onAsyncFormatChanged;
+  cb.onAsyncError = AudioEngine::onAsyncError;
+  return cb;
+}
 
-    if (AMediaFormat_getString(fmt, AMEDIAFORMAT_KEY_MIME, &mime)) {
-      if (mime && !strncmp(mime, "audio/", 6)) {
-        format_ = fmt;
-        audioTrack = (int)i;
-        break;
-      }
-    }
-    AMediaFormat_delete(fmt);
+// Where the item's audio ends. When the container declares encoder
+// padding, its duration is sample-exact and whatever decodes past it is
+// padding; decoders that trim it themselves leave nothing there to drop.
+int64_t AudioEngine::itemEndFor(AMediaFormat *format, int64_t durationUs) {
+  int32_t padding = 0;
+  if (durationUs > 0 &&
+      AMediaFormat_getInt32(format, kKeyEncoderPadding, &padding) &&
+      padding > 0) {
+    return durationUs;
   }
+  return kNoItemEnd;
+}
 
-  if (audioTrack < 0) {
-    return false;
+// Called whenever the decoder reports its output format (after start and on
+// INFO_OUTPUT_FORMAT_CHANGED). Only touched by the thread that writes the
+// ring (decode thread, or codec callback under asyncMutex_).
+void AudioEngine::updateCodecOutputFormat(AMediaFormat *format) {
+  int32_t encoding = 0;
+  AMediaFormat_getInt32(format, kKeyPcmEncoding, &encoding);
+  codecEncoding_ = pcmEncodingFromAndroid(encoding);
+  LOGD("Codec output encoding %d (pcm-encoding=%d)",
+       static_cast<int>(codecEncoding_), encoding);
+
+  // The real output rate / layout can differ from the container's
+  // (HE-AAC/SBR, AAC with a program config element, ...).
+  bool changed = false;
+  int32_t rate = 0;
+  if (AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_SAMPLE_RATE, &rate) &&
+      rate > 0 && rate != codecSampleRate_) {
+    LOGD("Codec output rate %d -> %d", codecSampleRate_, rate);
+    codecSampleRate_ = rate;
+    changed = true;
   }
-
-  // Mark that we found an audio track
-  hasAudioTrack_ = true;
-
-  gAudioDebug.openStage.store(3);
-
-  AMediaExtractor_selectTrack(extractor_, audioTrack);
-
-  const char *mime = nullptr;
-  AMediaFormat_getString(format_, AMEDIAFORMAT_KEY_MIME, &mime);
-
-  // Read audio format from the track and set safe defaults if missing
-  int32_t sr = 0;
-  int32_t ch = 0;
-  AMediaFormat_getInt32(format_, AMEDIAFORMAT_KEY_SAMPLE_RATE, &sr);
-  AMediaFormat_getInt32(format_, AMEDIAFORMAT_KEY_CHANNEL_COUNT, &ch);
-
-  sampleRate_ = (sr > 0) ? sr : 48000;
-  channelCount_ = (ch > 0) ? ch : 2;
-
-  // Extract duration from format
-  int64_t durationUs = 0;
-  if (AMediaFormat_getInt64(format_, AMEDIAFORMAT_KEY_DURATION, &durationUs)) {
-    durationUs_ = durationUs;
-  } else {
-    durationUs_ = 0;
+  int32_t channels = 0;
+  if (AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_CHANNEL_COUNT,
+                            &channels) &&
+      channels > 0 && channels != codecChannelCount_) {
+    LOGD("Codec output channels %d -> %d", codecChannelCount_, channels);
+    codecChannelCount_ = channels;
+    changed = true;
   }
+  int32_t mask = 0;
+  if (AMediaFormat_getInt32(format, kKeyChannelMask, &mask) &&
+      mask != codecChannelMask_) {
+    codecChannelMask_ = mask;
+    changed = true;
+  }
+  if (changed && stream_) {
+    configureConversion();
+  }
+}
 
-  codec_ = AMediaCodec_createDecoderByType(mime);
-  if (!codec_)
-    return false;
-
-  gAudioDebug.openStage.store(4);
-
-  if (AMediaCodec_configure(codec_, format_, nullptr, nullptr, 0) != AMEDIA_OK)
-    return false;
-
-  gAudioDebug.openStage.store(5);
-
-  if (AMediaCodec_start(codec_) != AMEDIA_OK)
-    return false;
-
-  gAudioDebug.openStage.store(6);
-
-  if (!setupAAudio())
-    return false;
+// (Re)builds the decode-side conversion chain: codec layout -> stream layout
+// (mixer_), then codecSampleRate_ -> sampleRate_ (resampler_), plus the
+// staging buffers between them. Allocates; only called on open and on
+// decoder format changes.
+void AudioEngine::configureConversion() {
+  if (!mixer_.configure(codecChannelCount_,
+                        static_cast<uint32_t>(codecChannelMask_),
+                        channelCount_, downmixOptions_)) {
+    LOGE("Unsupported channel layout %d -> %d", codecChannelCount_,
+         channelCount_);
+  }
+  resampler_.configure(codecSampleRate_, sampleRate_, channelCount_,
+                       resamplerQuality_, kStageChunkFrames);
+  resamplerResetPending_.store(false, std::memory_order_relaxed);
+
+  if (mixer_.active() || resampler_.active()) {
+    stageIn_.assign(kStageChunkFrames * codecChannelCount_, 0.0f);
+    stageMix_.assign(mixer_.active() ? kStageChunkFrames * channelCount_ : 0,
+                     0.0f);
+    stageOut_.assign(
+        resampler_.active()
+            ? resampler_.maxOutputFrames(kStageChunkFrames +
+                                         resampler_.taps()) *
+                  channelCount_
+            : 0,
+        0.0f);
+  }
 
-  gAudioDebug.openStage.store(7);
-  return true;
+  gAudioDebug.resampleFromHz.store(resampler_.active() ? codecSampleRate_ : 0);
+  gAudioDebug.streamSampleRate.store(sampleRate_);
+  gAudioDebug.codecChannels.store(codecChannelCount_);
+  gAudioDebug.streamChannels.store(channelCount_);
 }
 
 /* ===================== Start / Stop ===================== */
@@ -282,16 +305,148 @@ void AudioEngine::start() {
   if (!stream_)
     return;
 
+  // Start decode thread if not already running (non-blocking); it applies
+  // the Resume posted below.
+  if (!decodeThread_.joinable()) {
+    threadRunning_.store(true, std::memory_order_release);
+    decodeThread_ = std::thread(decodeMode_ == DecodeMode::Async
+                                    ? &AudioEngine::asyncDecodeLoop
+                                    : &AudioEngine::decodeLoop,
+                                this);
+  }
+  post(Command::Type::Resume);
+}
+
+void AudioEngine::pause() {
+  // Instant silence: the callback gate closes right here. Everything else
+  // (clock, decode gate) follows in command order.
+  audioOutputEnabled_.store(false, std::memory_order_release);
+  post(Command::Type::Pause);
+}
+
+void AudioEngine::stop() {
+  // 1️⃣ IMMEDIATELY mute audio and stop decoding
+  audioOutputEnabled_.store(false, std::memory_order_release);
+  decodeEnabled_.store(false, std::memory_order_release);
+  threadRunning_.store(false,
+                       std::memory_order_release); // Signal thread to exit
+  wakeEvent_.notify();
+
+  // 2️⃣ NOW it is safe to join decode thread
+  if (decodeThread_.joinable()) {
+    decodeThread_.join();
+  }
+
+  // Commands posted while the thread was exiting
+  drainCommands();
+
+  // 3️⃣ Flush buffers
+  flushRingBuffer();
+
+  gAudioHealthy.store(false);
+}
+
+void AudioEngine::seekUs(int64_t us, uint32_t seekId) {
+  gAudioDebug.seeksPosted.fetch_add(1, std::memory_order_relaxed);
+  post(Command::Type::Seek, us, seekId);
+}
+
+void AudioEngine::setPlaybackRate(float rate) {
+  rate = std::clamp(rate, TimeStretcher::kMinRate, TimeStretcher::kMaxRate);
+  post(Command::Type::Rate, std::lround(rate * 1000.0f));
+}
+
+void AudioEngine::selectAudioTrack(int32_t track) {
+  post(Command::Type::Track, track);
+}
+
+/* ===================== Control commands ===================== */
+
+void AudioEngine::post(Command::Type type, int64_t us, uint32_t seekId) {
+  Command command{type, us, monotonicUs(), seekId};
+  // Full only if the decode thread is stuck; it drains a whole batch per
+  // pass. Without one running the caller drains. Either way the caller
+  // gives up after kPostTimeoutUs: a dropped command is counted, a caller
+  // spinning forever would hang the UI.
+  while (!commands_.push(command)) {
+    if (threadRunning_.load(std::memory_order_acquire)) {
+      wakeEvent_.notify();
+    } else {
+      drainCommands();
+    }
+    if (monotonicUs() - command.postedUs >= kPostTimeoutUs) {
+      gAudioDebug.commandsDropped.fetch_add(1, std::memory_order_relaxed);
+      LOGE("Command queue full: dropped command %d",
+           static_cast<int>(type));
+      return;
+    }
+    std::this_thread::yield();
+  }
+
+  if (threadRunning_.load(std::memory_order_acquire)) {
+    wakeEvent_.notify();
+  } else {
+    drainCommands();
+  }
+}
+
+// Applies queued commands in order. Of several seeks drained together only
+// the last one runs: a seek always leaves playback paused and pause/resume
+// do not depend on the position, so the earlier ones would only cost a
+// codec flush and an extractor seek each (seek-bar scrubbing).
+void AudioEngine::drainCommands() {
+  if (draining_.exchange(true, std::memory_order_acquire))
+    return;
+
+  size_t count = 0;
+  while (count < kCommandCapacity && commands_.pop(commandBatch_[count]))
+    ++count;
+
+  size_t lastSeek = count;
+  for (size_t i = 0; i < count; ++i) {
+    if (commandBatch_[i].type == Command::Type::Seek)
+      lastSeek = i;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    const Command &command = commandBatch_[i];
+    switch (command.type) {
+    case Command::Type::Resume:
+      applyResume();
+      break;
+    case Command::Type::Pause:
+      applyPause();
+      break;
+    case Command::Type::Seek:
+      if (i == lastSeek)
+        applySeek(command.us, command.seekId, command.postedUs);
+      break;
+    case Command::Type::Rate:
+      applyRate(static_cast<int32_t>(command.us));
+      break;
+    case Command::Type::Track:
+      applyTrack(static_cast<int32_t>(command.us), command.postedUs);
+      break;
+    }
+  }
+
+  draining_.store(false, std::memory_order_release);
+}
+
+void AudioEngine::applyResume() {
   // 🔴 REQUIRED ONCE: start the AAudio stream on the first start/play only
+  // (a no-op on a session stream that is already running).
   if (!aaudioStarted_.exchange(true)) {
-    aaudio_result_t r = AAudioStream_requestStart(stream_);
-    if (r != AAUDIO_OK) {
-      LOGE("AAudio start failed: %s", AAudio_convertResultToText(r));
+    if (!AudioOutput::instance().start())
       return;
-    }
     gAudioDebug.aaudioStarted.store(true);
   }
 
+  if (startRequestUs_.load(std::memory_order_relaxed) == 0) {
+    startRequestUs_.store(monotonicUs(), std::memory_order_relaxed);
+    gAudioDebug.firstAudioUs.store(-1, std::memory_order_relaxed);
+  }
+
   // Start or resume the VirtualClock (authoritative time source)
   if (!clockStarted_.exchange(true, std::memory_order_acq_rel)) {
     virtualClock_->start();
@@ -299,20 +454,18 @@ void AudioEngine::start() {
     virtualClock_->resume();
   }
 
+  // A seek made while paused only starts decoding now.
+  if (seekSkipping()) {
+    seekStartUs_.store(monotonicUs(), std::memory_order_relaxed);
+  }
+
   audioOutputEnabled_.store(true, std::memory_order_release);
   decodeEnabled_.store(true, std::memory_order_release);
-  threadRunning_.store(true, std::memory_order_release);
   gAudioHealthy.store(true);
-
-  // Start decode thread if not already running (non-blocking)
-  if (!decodeThread_.joinable()) {
-    decodeThread_ = std::thread(&AudioEngine::decodeLoop, this);
-  }
 }
 
-void AudioEngine::pause() {
-  // Soft pause only: do not stop the driver or perform blocking operations on
-  // UI thread.
+void AudioEngine::applyPause() {
+  // Soft pause only: do not stop the driver.
   virtualClock_->pause();
 
   // 🔑 HARD GATE: Disable decoding and output
@@ -320,94 +473,299 @@ void AudioEngine::pause() {
   audioOutputEnabled_.store(false, std::memory_order_release);
 
   // IMPORTANT: DO NOT call AAudioStream_requestStop(stream_);
-  // DO NOT join threads, flush codec, or touch extractor here.
+  // DO NOT flush codec or touch extractor here.
 
   gAudioHealthy.store(false, std::memory_order_release);
 }
 
-void AudioEngine::stop() {
-  // 1️⃣ IMMEDIATELY mute audio and stop decoding
-  audioOutputEnabled_.store(false, std::memory_order_release);
-  decodeEnabled_.store(false, std::memory_order_release);
-  threadRunning_.store(false,
-                       std::memory_order_release); // Signal thread to exit
-
-  // 2️⃣ NOW it is safe to join decode thread
-  if (decodeThread_.joinable()) {
-    decodeThread_.join();
-  }
-
-  // 3️⃣ Flush buffers
-  flushRingBuffer();
-
-  gAudioHealthy.store(false);
-}
+void AudioEngine::applySeek(int64_t us, uint32_t seekId, int64_t postedUs) {
+  gAudioDebug.seeksApplied.fetch_add(1, std::memory_order_relaxed);
 
-void AudioEngine::seekUs(int64_t us) {
   // 1. Pause logical playback
   virtualClock_->pause();
   decodeEnabled_.store(false, std::memory_order_release);
 
-  // 2. Flush PCM immediately (Ring buffer memory cleared in flushRingBuffer)
-  flushRingBuffer();
+  // 1b. Inside the decoded history: play it again from `us`. The codec and
+  // the demuxer stay where they are and carry on from the history's end.
+  bool cached;
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex_);
+    cached = rewindCacheUs_ > 0 &&
+             !discontinuityPending_.load(std::memory_order_acquire) &&
+             history_.seekTo(us);
+    if (cached) {
+      flushRingBuffer();
+    }
+  }
+  if (cached) {
+    gAudioDebug.historyHits.fetch_add(1, std::memory_order_relaxed);
+    virtualClock_->seekUs(us);
+    return;
+  }
 
-  // 3. Flush decoder & extractor
-  if (codec_) {
-    AMediaCodec_flush(codec_);
+  // 2. Reposition the (shared) demuxer. If video already applied this seek
+  // and we adopted its serial, what we decoded since is already from
+  // there: keep it.
+  uint32_t serial = demuxer_ ? demuxer_->seekUs(us, seekId) : 0;
+  // A decoder still resyncing onto the history's end holds audio from
+  // before the seek.
+  bool current;
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex_);
+    current = demuxer_ && serial == demuxSerial_ &&
+              !discontinuityPending_.load(std::memory_order_acquire) &&
+              (!seekSkipping() ||
+               seekSkipMeasured_.load(std::memory_order_relaxed));
   }
 
-  if (extractor_) {
-    AMediaExtractor_seekTo(extractor_, us, AMEDIAEXTRACTOR_SEEK_CLOSEST_SYNC);
+  seekTargetUs_.store(kNoSeekTarget, std::memory_order_release);
+  targetFollowsClock_.store(false, std::memory_order_relaxed);
+  if (!current) {
+    // 3. Flush PCM immediately (Ring buffer memory cleared in
+    // flushRingBuffer). Under asyncMutex_: a codec callback may be writing
+    // to the ring.
+    {
+      std::lock_guard<std::mutex> lock(asyncMutex_);
+      flushRingBuffer();
+      clearHistoryLocked();
+      resamplerResetPending_.store(true, std::memory_order_release);
+    }
+    discontinuityPending_.store(false, std::memory_order_release);
+
+    // 4. Flush decoder
+    flushCodec(serial);
+
+    // Accurate seek: decode from the sync sample, play from `us`. Latency
+    // counts from the seekUs() call, queueing included.
+    if (accurateSeek_.load(std::memory_order_relaxed)) {
+      gAudioDebug.seekLatencyUs.store(-1, std::memory_order_relaxed);
+      gAudioDebug.seekSkippedFrames.store(0, std::memory_order_relaxed);
+      seekStartUs_.store(postedUs, std::memory_order_relaxed);
+      seekSkipMeasured_.store(true, std::memory_order_relaxed);
+      seekTargetUs_.store(us, std::memory_order_release);
+    }
   }
 
-  // 4. Update clock position (but do NOT start)
+  // 5. Update clock position (but do NOT start)
   virtualClock_->seekUs(us);
 }
 
-/* ===================== AAudio ===================== */
+// Tempo change without a pause. The ring holds audio stretched for the old
+// rate: drop it and replay the history from the first frame not rendered
+// yet, stretched for the new one. The clock changes rate at the same point
+// without moving and re-anchors on the new segment's timestamps.
+void AudioEngine::applyRate(int32_t rateMilli) {
+  std::lock_guard<std::mutex> lock(asyncMutex_);
+  if (rateMilli == playbackRateMilli_)
+    return;
+  playbackRateMilli_ = rateMilli;
+  stretcher_.setRate(static_cast<float>(rateMilli) / 1000.0f);
+  virtualClock_->setRate(static_cast<float>(rateMilli) / 1000.0f);
+
+  int64_t us = nextRenderUs();
+  // Evicted already (small history, deep ring): resume at its oldest frame.
+  if (!history_.empty() && !history_.seekTo(us) && us < history_.startUs()) {
+    history_.seekTo(history_.startUs());
+  }
+  flushRingBuffer();
+  LOGD("Playback rate %d.%03dx from %lld us", rateMilli / 1000,
+       rateMilli % 1000, static_cast<long long>(us));
+}
 
-bool AudioEngine::setupAAudio() {
+// Media time of the next frame the callback renders: past the last anchor,
+// the segment's first frame when none has played yet, else the history
+// cursor (kNoSeekTarget if the history is empty too). Caller holds
+// asyncMutex_.
+int64_t AudioEngine::nextRenderUs() const {
+  uint32_t gen = flushGeneration_.load(std::memory_order_acquire);
+  AudioAnchor a = anchor_.load();
+  if (a.generation == gen && a.frames > 0)
+    return a.mediaUs + ringFramesUs(a.frames, a.rateMilli);
+  if (ptsGeneration_.load(std::memory_order_acquire) == gen)
+    return ringBasePtsUs_.load(std::memory_order_relaxed);
+  return history_.empty() ? kNoSeekTarget : history_.cursorUs();
+}
 
-  gAudioDebug.aaudioError.store(-999); // probe
+// Another audio track of the same file, without touching the stream or
+// the clock. The new decoder is configured and started before anything is
+// torn down (a failure leaves the old track playing); then the queued
+// audio of the old track is dropped, the demuxer repositions on the new
+// track at the next unplayed frame and the old decoder goes back to the
+// pool, where a switch back finds it. The clock keeps running meanwhile;
+// the new track's audio is skipped up to wherever it has got to by then.
+void AudioEngine::applyTrack(int32_t track, int64_t postedUs) {
+  if (!demuxer_ || track == track_ || track < 0 ||
+      track >= demuxer_->trackCount() ||
+      demuxer_->trackMime(track).compare(0, 6, "audio/") != 0) {
+    LOGE("Audio track %d: not an audio track of this file", track);
+    return;
+  }
+
+  AMediaFormat *format = demuxer_->trackFormat(track);
+  bool async = decodeMode_ == DecodeMode::Async;
+  CodecPool::Key key = CodecPool::keyFor(format);
+  AMediaCodec *codec = CodecPool::instance().acquire(key, async);
+  bool ok = codec != nullptr;
+  if (ok && async) {
+    auto setAsyncCallback = ndkcompat::mediaCodecSetAsyncNotifyCallback();
+    ok = setAsyncCallback &&
+         setAsyncCallback(codec, asyncCallbacks(), this) == AMEDIA_OK;
+  }
+  if (ok) {
+    AMediaFormat_setInt32(format, kKeyPcmEncoding, kAndroidEncodingPcmFloat);
+    ok = AMediaCodec_configure(codec, format, nullptr, nullptr, 0) ==
+         AMEDIA_OK;
+  }
+  if (ok) {
+    // Published before start so the input buffers it offers are parked.
+    {
+      std::lock_guard<std::mutex> lock(asyncMutex_);
+      switchCodec_ = codec;
+    }
+    ok = AMediaCodec_start(codec) == AMEDIA_OK;
+    if (!ok) {
+      std::lock_guard<std::mutex> lock(asyncMutex_);
+      switchCodec_ = nullptr;
+      switchInputs_.clear();
+    }
+  }
+  if (!ok) {
+    LOGE("Audio track %d: decoder setup failed for %s", track,
+         key.mime.empty() ? "?" : key.mime.c_str());
+    CodecPool::instance().recycle(codec, key, async);
+    if (format)
+      AMediaFormat_delete(format);
+    return;
+  }
 
-  AAudioStreamBuilder *builder = nullptr;
-  aaudio_result_t result = AAudio_createStreamBuilder(&builder);
+  AMediaCodec *oldCodec;
+  CodecPool::Key oldKey;
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex_);
+    int64_t spliceUs = nextRenderUs();
+    if (spliceUs == kNoSeekTarget)
+      spliceUs = virtualClock_->positionUs();
+
+    // The old decoder's callbacks are ignored from here on.
+    oldCodec = codec_;
+    oldKey = CodecPool::keyFor(format_);
+    if (format_)
+      AMediaFormat_delete(format_);
+    codec_ = codec;
+    format_ = format;
+    switchCodec_ = nullptr;
+    pendingInputs_ = std::move(switchInputs_);
+    switchInputs_.clear();
+    pendingOutputs_.clear();
+    inputEos_ = false;
+    demuxSerial_ = demuxer_->switchTrack(track_, track, spliceUs, &wakeEvent_);
+    track_ = track;
+
+    int32_t sr = 0;
+    int32_t ch = 0;
+    AMediaFormat_getInt32(format_, AMEDIAFORMAT_KEY_SAMPLE_RATE, &sr);
+    AMediaFormat_getInt32(format_, AMEDIAFORMAT_KEY_CHANNEL_COUNT, &ch);
+    codecSampleRate_ = sr > 0 ? sr : codecSampleRate_;
+    codecChannelCount_ = ch > 0 ? ch : codecChannelCount_;
+    codecChannelMask_ = 0;
+    AMediaFormat_getInt32(format_, kKeyChannelMask, &codecChannelMask_);
+    itemEndUs_ = itemEndFor(format_, durationUs_.load());
+    if (AMediaFormat *outFormat = AMediaCodec_getOutputFormat(codec_)) {
+      updateCodecOutputFormat(outFormat);
+      AMediaFormat_delete(outFormat);
+    }
+    configureConversion();
+
+    flushRingBuffer();
+    history_.clear();
+    itemEnded_.store(false, std::memory_order_relaxed);
+    discontinuityPending_.store(false, std::memory_order_relaxed);
+    seekStartUs_.store(postedUs, std::memory_order_relaxed);
+    seekSkipMeasured_.store(false, std::memory_order_relaxed);
+    targetFollowsClock_.store(true, std::memory_order_relaxed);
+    seekTargetUs_.store(spliceUs, std::memory_order_release);
+    // Buffers offered before the swap.
+    if (async)
+      feedInputsLocked();
+  }
+  CodecPool::instance().recycle(oldCodec, oldKey, async);
+  gAudioDebug.trackSwitches.fetch_add(1, std::memory_order_relaxed);
+  LOGD("Audio track %d (%s) in %lld us", track, key.mime.c_str(),
+       static_cast<long long>(monotonicUs() - postedUs));
+}
 
-  if (result != AAUDIO_OK) {
-    gAudioDebug.aaudioError.store(result);
-    gAudioHealthy.store(false);
-    LOGE("AAudio createStreamBuilder failed: %s",
-         AAudio_convertResultToText(result));
-    return false;
+// Drops everything inside the codec and continues with packets of `serial`.
+void AudioEngine::flushCodec(uint32_t serial) {
+  {
+    // Parked buffer indices die with the flush. Async callbacks cannot
+    // consume new ones while decodeEnabled_ is false.
+    std::lock_guard<std::mutex> lock(asyncMutex_);
+    pendingInputs_.clear();
+    pendingOutputs_.clear();
+    inputEos_ = false;
+    demuxSerial_ = serial;
+  }
+  itemEnded_.store(false, std::memory_order_relaxed);
+
+  if (codec_) {
+    AMediaCodec_flush(codec_);
+    // Async codecs stop offering buffers after a flush until restarted.
+    if (decodeMode_ == DecodeMode::Async) {
+      AMediaCodec_start(codec_);
+    }
   }
+}
 
-  // Configure builder with SAFE parameters (do NOT auto-detect or use float)
-  AAudioStreamBuilder_setFormat(builder, AAUDIO_FORMAT_PCM_I16);
-  // Use format values discovered from MediaCodec if available
-  AAudioStreamBuilder_setChannelCount(builder, channelCount_);
-  AAudioStreamBuilder_setSampleRate(builder, sampleRate_);
+// Decode thread: another consumer of the shared demuxer repositioned it
+// (video seek, surface change). When it restarts inside the decoded
+// history, what is queued keeps playing and the decoder only has to catch
+// up with the history's end, dropping what it decodes before it. Otherwise
+// same flush as a seek, but the clock stays where it is.
+void AudioEngine::applyDiscontinuity() {
+  discontinuityPending_.store(false, std::memory_order_relaxed);
+  uint32_t serial = discontinuitySerial_.load(std::memory_order_acquire);
+  int64_t ptsUs = discontinuityPtsUs_.load(std::memory_order_relaxed);
+
+  int64_t resumeUs = kNoSeekTarget;
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex_);
+    if (!history_.empty() && ptsUs >= history_.startUs() &&
+        ptsUs <= history_.endUs()) {
+      resumeUs = history_.endUs();
+    }
+  }
 
-  AAudioStreamBuilder_setSharingMode(builder, AAUDIO_SHARING_MODE_SHARED);
+  if (resumeUs != kNoSeekTarget) {
+    flushCodec(serial);
+    seekSkipMeasured_.store(false, std::memory_order_relaxed);
+    targetFollowsClock_.store(false, std::memory_order_relaxed);
+    seekTargetUs_.store(resumeUs, std::memory_order_release);
+    return;
+  }
 
-  // Explicit direction is required on some OEM ROMs (MIUI/ColorOS) where
-  // implicit direction can cause the stream to hang and the callback to never
-  // fire.
-  AAudioStreamBuilder_setDirection(builder, AAUDIO_DIRECTION_OUTPUT);
+  // The gates stay open here: fence off the codec callbacks, which may be
+  // writing to the ring.
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex_);
+    flushRingBuffer();
+    clearHistoryLocked();
+    resamplerResetPending_.store(true, std::memory_order_release);
+  }
+  flushCodec(serial);
+}
 
-  AAudioStreamBuilder_setPerformanceMode(builder, AAUDIO_PERFORMANCE_MODE_NONE);
+/* ===================== AAudio ===================== */
 
-  // VERY IMPORTANT: use data callback for delivery
-  // Use the exact symbol name required by the platform/QA
-  AAudioStreamBuilder_setDataCallback(builder, AudioEngine::dataCallback, this);
+bool AudioEngine::setupAAudio() {
 
-  // Try opening the stream and log detailed reason if it fails
-  result = AAudioStreamBuilder_openStream(builder, &stream_);
-  AAudioStreamBuilder_delete(builder);
+  gAudioDebug.aaudioError.store(-999); // probe
 
-  if (result != AAUDIO_OK || !stream_) {
-    gAudioDebug.aaudioError.store(result);
+  // The process-wide session keeps its stream running across files and
+  // only reopens when this item's channels cannot be converted onto it.
+  // channelCount_ is still the codec's count here.
+  stream_ = AudioOutput::instance().acquire(&sink_, channelCount_);
+  if (!stream_) {
     gAudioHealthy.store(false);
-    LOGE("AAudio open failed: %s", AAudio_convertResultToText(result));
     return false;
   }
 
@@ -420,18 +778,67 @@ bool AudioEngine::setupAAudio() {
     channelCount_ = 2;
   }
 
+  switch (AAudioStream_getFormat(stream_)) {
+  case AAUDIO_FORMAT_PCM_FLOAT:
+    streamEncoding_ = PcmEncoding::Float;
+    break;
+  case AAUDIO_FORMAT_PCM_I24_PACKED:
+    streamEncoding_ = PcmEncoding::I24Packed;
+    break;
+  case AAUDIO_FORMAT_PCM_I32:
+    streamEncoding_ = PcmEncoding::I32;
+    break;
+  default:
+    streamEncoding_ = PcmEncoding::I16;
+    break;
+  }
+
+  configureConversion();
+  crossfadeTail_.assign(
+      static_cast<size_t>(kMaxCrossfadeUs * sampleRate_ / 1000000) *
+          channelCount_,
+      0.0f);
+
+  // Rewind cache in the stream's format, bounded by time and by memory. It
+  // also stages every decoded buffer, so it never gets smaller than
+  // kMinHistoryUs.
+  size_t bytesPerFrame = sizeof(float) * channelCount_;
+  int64_t historyUs = std::max(
+      kMinHistoryUs,
+      std::min<int64_t>(rewindCacheUs_, static_cast<int64_t>(
+                                            rewindCacheBytes_ / bytesPerFrame *
+                                            1000000 / sampleRate_)));
+  history_.configure(channelCount_, sampleRate_,
+                     static_cast<size_t>(historyUs * sampleRate_ / 1000000));
+  gAudioDebug.historyCapacityUs.store(rewindCacheUs_ > 0 ? historyUs : 0);
+
+  // Keeps a rate set before open (the engine's, or the previous file's).
+  stretcher_.configure(sampleRate_, channelCount_, kStageChunkFrames);
+  stretchOut_.assign(stretcher_.maxOutputFramesPerCall() * channelCount_,
+                     0.0f);
+  // Same for the DSP settings.
+  dsp_.configure(sampleRate_, channelCount_);
+  dspOut_.assign(kStageChunkFrames * channelCount_, 0.0f);
+
+  virtualClock_->setOutputLatencyUs(AudioOutput::instance().bufferLatencyUs());
+
   gAudioDebug.aaudioOpened.store(true);
+  // Everything the callback reads is set up; start rendering.
+  AudioOutput::instance().attach(&sink_);
 
-  LOGD("AAudio stream opened (sampleRate=%d channels=%d)", sampleRate_,
-       channelCount_);
+  LOGD("AAudio stream opened (sampleRate=%d channels=%d format=%d, codec "
+       "%d Hz / %d ch)",
+       sampleRate_, channelCount_, static_cast<int>(streamEncoding_),
+       codecSampleRate_, codecChannelCount_);
 
   return true;
 }
 
 void AudioEngine::cleanupAAudio() {
   if (stream_) {
-    // Final destroy ONLY (stream must otherwise run forever)
-    AAudioStream_close(stream_);
+    // Hand the stream back; it keeps running for the next engine. No
+    // callback touches this engine once release() returns.
+    AudioOutput::instance().release(&sink_);
     stream_ = nullptr;
   }
 }
@@ -439,18 +846,21 @@ void AudioEngine::cleanupAAudio() {
 void AudioEngine::cleanupMedia() {
   // Ensure decoder thread is stopped before touching MediaCodec
   decodeEnabled_.store(false, std::memory_order_release);
+  wakeEvent_.notify();
   if (decodeThread_.joinable()) {
     decodeThread_.join();
   }
+  releaseRetired();
   if (codec_) {
-    AMediaCodec_stop(codec_);
-    AMediaCodec_delete(codec_);
+    CodecPool::instance().recycle(codec_, CodecPool::keyFor(format_),
+                                  decodeMode_ == DecodeMode::Async);
     codec_ = nullptr;
   }
-  if (extractor_) {
-    AMediaExtractor_delete(extractor_);
-    extractor_ = nullptr;
+  if (demuxer_) {
+    demuxer_->detach(track_);
+    demuxer_.reset();
   }
+  track_ = -1;
   if (format_) {
     AMediaFormat_delete(format_);
     format_ = nullptr;
@@ -470,150 +880,1205 @@ void AudioEngine::writePcmBlocking(const int16_t *in, int frames) {
 
 /* ===================== MediaCodec Decode ===================== */
 
-void AudioEngine::decodeLoop() {
-  // Outer loop governed by threadRunning_
-  while (threadRunning_.load(std::memory_order_acquire)) {
+bool AudioEngine::decodeGatesOpen() const {
+  return virtualClock_->isRunning() &&
+         decodeEnabled_.load(std::memory_order_acquire);
+}
 
-    // 🚨 CLOCK GATE - ABSOLUTE FIRST PRIORITY
-    // DO NOTHING if clock is not running - no dequeue, no advance, no write
-    if (!virtualClock_->isRunning()) {
-      gAudioDebug.decodeActive.store(false);
-      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+// Fills one codec input buffer with the next demuxed packet (or EOS).
+// Returns false if the buffer was left untouched; the demuxer wakes us when
+// a packet arrives.
+bool AudioEngine::queueInputFromDemuxer(size_t inIndex) {
+  if (inputEos_ || discontinuityPending_.load(std::memory_order_acquire))
+    return false;
+
+  size_t bufSize;
+  uint8_t *buf = AMediaCodec_getInputBuffer(codec_, inIndex, &bufSize);
+  if (!buf)
+    return false;
+
+  Demuxer::PacketInfo packet;
+  switch (demuxer_->read(track_, demuxSerial_, buf, bufSize, &packet)) {
+  case Demuxer::ReadStatus::Ok:
+    AMediaCodec_queueInputBuffer(codec_, inIndex, 0, packet.size,
+                                 packet.ptsUs, 0);
+    return true;
+  case Demuxer::ReadStatus::EndOfStream:
+    AMediaCodec_queueInputBuffer(codec_, inIndex, 0, 0, 0,
+                                 AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
+    // Async codecs keep offering buffers after EOS; stop feeding them.
+    inputEos_ = decodeMode_ == DecodeMode::Async;
+    return true;
+  case Demuxer::ReadStatus::Discontinuity:
+    // Flushing is not allowed from a codec callback: the decode thread
+    // does it.
+    discontinuitySerial_.store(packet.serial, std::memory_order_relaxed);
+    discontinuityPtsUs_.store(packet.ptsUs, std::memory_order_relaxed);
+    discontinuityPending_.store(true, std::memory_order_release);
+    wakeEvent_.notify();
+    return false;
+  case Demuxer::ReadStatus::Empty:
+    break;
+  }
+  return false;
+}
+
+void AudioEngine::waitForWork(int64_t timeoutUs) {
+  int64_t parkedUs = monotonicUs();
+  wakeEvent_.wait(timeoutUs);
+  iterationParkedUs_ += monotonicUs() - parkedUs;
+  gAudioDebug.decodeWakeups.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Decode thread: picks up a setDeepBuffer() change. Marks in stream frames.
+void AudioEngine::applyDeepBuffer() {
+  bool deep = deepBuffer_.load(std::memory_order_acquire);
+  if (deep == deepBufferApplied_)
+    return;
+  deepBufferApplied_ = deep;
+  refilling_ = false;
+  if (!deep) {
+    deepLowWater_.store(0, std::memory_order_relaxed);
+    LOGD("Deep buffer off");
+    return;
+  }
+  int64_t capacity =
+      static_cast<int64_t>(ring_.capacity() / channelCount_) * 7 / 8;
+  deepHighWater_ = static_cast<int32_t>(
+      std::min(kDeepBufferUs * sampleRate_ / 1000000, capacity));
+  int32_t low = static_cast<int32_t>(std::min<int64_t>(
+      kDeepLowWaterUs * sampleRate_ / 1000000, deepHighWater_ / 2));
+  deepLowWater_.store(low, std::memory_order_relaxed);
+  LOGD("Deep buffer on: refill below %d frames up to %d", low,
+       deepHighWater_);
+}
+
+// 🛑 DEMAND GATE: whether the ring wants more decoded audio. Normally
+// demand-driven with kDemandLowWaterFrames of headroom (renderCallback
+// wakes us when demand crosses that mark, pacing the decoder to
+// consumption). With a deep buffer, batches between the two fill marks.
+bool AudioEngine::wantsAudio() {
+  if (!deepBufferApplied_) {
+    return framesRequested_.load(std::memory_order_acquire) +
+               kDemandLowWaterFrames >
+           0;
+  }
+  size_t fill = ring_.availableToRead() / channelCount_;
+  size_t mark = refilling_
+                    ? static_cast<size_t>(deepHighWater_)
+                    : static_cast<size_t>(
+                          deepLowWater_.load(std::memory_order_relaxed));
+  refilling_ = fill < mark;
+  return refilling_;
+}
+
+// Top of a decode-loop pass: the previous pass's busy time goes into the
+// iteration histogram.
+void AudioEngine::beginDecodeIteration() {
+  int64_t now = monotonicUs();
+  if (iterationStartUs_ > 0) {
+    gAudioDebug.decodeIterationUs.record(now - iterationStartUs_ -
+                                         iterationParkedUs_);
+  }
+  iterationStartUs_ = now;
+  iterationParkedUs_ = 0;
+}
+
+void AudioEngine::decodeLoop() {
+  // Outer loop governed by threadRunning_
+  while (threadRunning_.load(std::memory_order_acquire)) {
+    beginDecodeIteration();
+    drainCommands();
+    applyDeepBuffer();
+
+    // 🚨 CLOCK GATE - ABSOLUTE FIRST PRIORITY
+    // DO NOTHING if clock is not running - no dequeue, no advance, no write.
+    // Block until start()/stop() wakes us.
+    if (!virtualClock_->isRunning()) {
+      gAudioDebug.decodeActive.store(false);
+      waitForWork();
       continue;
     }
 
-    // ⛔ HARD GATE: Sleep if decoding is disabled
+    // ⛔ HARD GATE: Block while decoding is disabled (paused / seeking)
     if (!decodeEnabled_.load(std::memory_order_acquire)) {
       gAudioDebug.decodeActive.store(false);
-      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      waitForWork();
+      continue;
+    }
+
+    if (discontinuityPending_.load(std::memory_order_acquire)) {
+      applyDiscontinuity();
+    }
+
+    pollAudioTimestamp();
+    pollStreamMetrics();
+    pollItemBoundary();
+
+    // Audio already decoded (replay after a rewind) goes out first.
+    pumpHistory();
+
+    // This item is decoded to its end: a prepared next one takes over.
+    if (itemEnded_.load(std::memory_order_acquire) && advanceItem()) {
       continue;
     }
 
-    // 🛑 DEMAND GATE: Only decode if frames are requested by AAudio
-    // This paces the decoder exactly to consumption.
-    int32_t framesNeeded = framesRequested_.load(std::memory_order_acquire);
-    if (framesNeeded <= 0) {
+    // 🛑 DEMAND GATE (wantsAudio). Decoded audio still waiting for ring
+    // space: nothing to decode either. An accurate seek (or resync) still
+    // skipping to its target decodes flat out.
+    if ((!wantsAudio() || historyBacklog() > 0) && !seekSkipping()) {
       gAudioDebug.decodeActive.store(false);
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      waitForWork();
       continue;
     }
 
     // ✅ All gates passed - decode is active
     gAudioDebug.decodeActive.store(true);
+    bool progressed = false;
 
     // Decode ONE buffer cycle (Input + Output)
     // ----------------------------------------
 
     // INPUT STAGE
-    ssize_t inIndex = AMediaCodec_dequeueInputBuffer(codec_, 0);
-    if (inIndex >= 0) {
-      size_t bufSize;
-      uint8_t *buf = AMediaCodec_getInputBuffer(codec_, inIndex, &bufSize);
-      if (buf) {
-        ssize_t size = AMediaExtractor_readSampleData(extractor_, buf, bufSize);
-        if (size > 0) {
-          int64_t pts = AMediaExtractor_getSampleTime(extractor_);
-          AMediaCodec_queueInputBuffer(codec_, inIndex, 0, size, pts, 0);
-          AMediaExtractor_advance(extractor_);
-        } else {
-          AMediaCodec_queueInputBuffer(codec_, inIndex, 0, 0, 0,
-                                       AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
-        }
+    // An index the demuxer had no packet for yet is kept for the next pass.
+    if (pendingInputs_.empty()) {
+      ssize_t inIndex = AMediaCodec_dequeueInputBuffer(codec_, 0);
+      if (inIndex >= 0) {
+        pendingInputs_.push_back(static_cast<int32_t>(inIndex));
       }
     }
+    if (!pendingInputs_.empty() &&
+        queueInputFromDemuxer(static_cast<size_t>(pendingInputs_.front()))) {
+      pendingInputs_.pop_front();
+      progressed = true;
+    }
 
     // OUTPUT STAGE
     AMediaCodecBufferInfo info;
     ssize_t outIndex =
         AMediaCodec_dequeueOutputBuffer(codec_, &info, 0); // Non-blocking
 
-    if (outIndex >= 0) {
+    if (outIndex == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED) {
+      if (AMediaFormat *outFormat = AMediaCodec_getOutputFormat(codec_)) {
+        updateCodecOutputFormat(outFormat);
+        AMediaFormat_delete(outFormat);
+      }
+      progressed = true;
+    } else if (outIndex >= 0) {
       uint8_t *buf = AMediaCodec_getOutputBuffer(codec_, outIndex, nullptr);
+      uint32_t serial = demuxSerial_;
+      // A track switch applied while waiting swaps the codec without a new
+      // serial; buf and outIndex belong to this one.
+      AMediaCodec *codec = codec_;
 
       if (buf && info.size > 0) {
-        int16_t *samples = reinterpret_cast<int16_t *>(buf + info.offset);
-        int32_t count = info.size / sizeof(int16_t);
-
-        // Write to Ring Buffer (blocking if full, but demand is limited so
-        // rare)
-        int32_t written = 0;
-        while (decodeEnabled_.load(std::memory_order_acquire)) {
-          if (writeAudio(samples, count)) {
-            written = count;
+        const uint8_t *samples = buf + info.offset;
+        size_t bytesPerSample = pcmBytesPerSample(codecEncoding_);
+        int32_t count = samplesBeforeEnd(info.presentationTimeUs,
+                                         info.size / bytesPerSample);
+
+        // Copy straight into the ring; only the part that does not fit yet
+        // waits (demand is limited so this is rare). renderCallback wakes us
+        // once spaceWanted_ samples are free. Samples before an accurate
+        // seek's target count as written without ever reaching the ring.
+        // Commands are applied while waiting: a pause closes the callback
+        // gate, so the space would never come.
+        int32_t written = samplesBeforeTarget(info.presentationTimeUs, count);
+        while (written < count && codec_ == codec &&
+               decodeEnabled_.load(std::memory_order_acquire)) {
+          written += writeAudio(samples + written * bytesPerSample,
+                                count - written,
+                                samplePtsUs(info.presentationTimeUs, written));
+          if (written >= count)
             break;
-          }
-          std::this_thread::sleep_for(std::chrono::milliseconds(2));
+          spaceWanted_.store(ringSamplesFor(count - written),
+                             std::memory_order_release);
+          waitForWork();
+          drainCommands();
         }
-
-        // 📉 Decrement demand by what we actually produced
-        if (written > 0) {
-          framesRequested_.fetch_sub(written / channelCount_,
-                                     std::memory_order_release);
+        spaceWanted_.store(0, std::memory_order_relaxed);
+      }
+      // A seek applied above flushed the codec, and this index with it; a
+      // track switch stopped it and went on with another one.
+      if (codec == codec_ && serial == demuxSerial_) {
+        AMediaCodec_releaseOutputBuffer(codec_, outIndex, false);
+        if (info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) {
+          itemEnded_.store(true, std::memory_order_release);
         }
       }
-      AMediaCodec_releaseOutputBuffer(codec_, outIndex, false);
+      progressed = true;
+    }
+
+    // Codec still busy: back off briefly instead of spinning on timeout-0
+    // dequeues (a control call still wakes us immediately).
+    if (!progressed) {
+      waitForWork(kCodecBackoffUs);
     }
   }
 }
 
-/* ===================== Producer (lock-free) ===================== */
+/* ===================== Async MediaCodec Decode ===================== */
+
+// Decode thread in async mode: no dequeue polling at all. It only drains
+// what the codec callbacks had to park, and otherwise stays blocked.
+void AudioEngine::asyncDecodeLoop() {
+  while (threadRunning_.load(std::memory_order_acquire)) {
+    beginDecodeIteration();
+    drainCommands();
+    applyDeepBuffer();
+
+    if (!decodeGatesOpen()) {
+      gAudioDebug.decodeActive.store(false);
+      waitForWork();
+      continue;
+    }
+
+    if (discontinuityPending_.load(std::memory_order_acquire)) {
+      applyDiscontinuity();
+    }
+
+    if (itemEnded_.load(std::memory_order_acquire)) {
+      advanceItem();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(asyncMutex_);
+      pumpHistory();
+      feedInputsLocked();
+      drainOutputsLocked();
+      feedNextLocked();
+      gAudioDebug.decodeActive.store(!pendingOutputs_.empty());
+    }
+    pollAudioTimestamp();
+    pollStreamMetrics();
+    pollItemBoundary();
+
+    // Woken by control calls, demand crossing the low-water mark, or ring
+    // space becoming available.
+    waitForWork();
+  }
+}
+
+void AudioEngine::feedInputsLocked() {
+  while (!pendingInputs_.empty() && decodeGatesOpen()) {
+    if (!queueInputFromDemuxer(pendingInputs_.front()))
+      return;
+    pendingInputs_.pop_front();
+  }
+}
+
+void AudioEngine::drainOutputsLocked() {
+  while (!pendingOutputs_.empty() && decodeGatesOpen()) {
+    // 🛑 DEMAND GATE (same pacing as the sync loop)
+    if ((!wantsAudio() || historyBacklog() > 0) && !seekSkipping()) {
+      return;
+    }
+
+    PendingOutput &out = pendingOutputs_.front();
+    uint8_t *buf = AMediaCodec_getOutputBuffer(codec_, out.index, nullptr);
+    if (buf && out.info.size > 0) {
+      const uint8_t *samples = buf + out.info.offset;
+      size_t bytesPerSample = pcmBytesPerSample(codecEncoding_);
+      int32_t count =
+          samplesBeforeEnd(out.info.presentationTimeUs,
+                           out.info.size / bytesPerSample);
+
+      if (out.writtenSamples == 0) {
+        out.writtenSamples =
+            samplesBeforeTarget(out.info.presentationTimeUs, count);
+      }
+      if (out.writtenSamples < count) {
+        out.writtenSamples += writeAudio(
+            samples + out.writtenSamples * bytesPerSample,
+            count - out.writtenSamples,
+            samplePtsUs(out.info.presentationTimeUs, out.writtenSamples));
+      }
 
-bool AudioEngine::writeAudio(const int16_t *data, int32_t samples) {
-  if ((samples % channelCount_) != 0) {
-    // Robustness: ignore partial frames logic for now
+      if (out.writtenSamples < count) {
+        // Ring full: keep the buffer, renderCallback wakes us when drained.
+        spaceWanted_.store(ringSamplesFor(count - out.writtenSamples),
+                           std::memory_order_release);
+        return;
+      }
+    }
+
+    AMediaCodec_releaseOutputBuffer(codec_, out.index, false);
+    if (out.info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) {
+      itemEnded_.store(true, std::memory_order_release);
+      wakeEvent_.notify();
+    }
+    pendingOutputs_.pop_front();
+  }
+}
+
+// The callbacks of a prepared next decoder only park its buffers (and feed
+// its first packets), those of a decoder starting for a track switch only
+// park its input buffers; those of a decoder retired by a gapless
+// transition or a switch are ignored.
+void AudioEngine::onAsyncInputAvailable(AMediaCodec *codec, void *userData,
+                                        int32_t index) {
+  auto *engine = static_cast<AudioEngine *>(userData);
+  std::lock_guard<std::mutex> lock(engine->asyncMutex_);
+  if (codec == engine->codec_) {
+    engine->pendingInputs_.push_back(index);
+    engine->feedInputsLocked();
+  } else if (codec == engine->next_.codec) {
+    engine->next_.pendingInputs.push_back(index);
+    engine->feedNextLocked();
+    engine->prepareWake_.notify();
+  } else if (codec == engine->switchCodec_) {
+    engine->switchInputs_.push_back(index);
+  }
+}
+
+void AudioEngine::onAsyncOutputAvailable(AMediaCodec *codec, void *userData,
+                                         int32_t index,
+                                         AMediaCodecBufferInfo *info) {
+  auto *engine = static_cast<AudioEngine *>(userData);
+  std::lock_guard<std::mutex> lock(engine->asyncMutex_);
+  if (codec == engine->codec_) {
+    engine->pendingOutputs_.push_back({index, *info, 0});
+    engine->drainOutputsLocked();
+  } else if (codec == engine->next_.codec) {
+    engine->next_.pendingOutputs.push_back({index, *info, 0});
+  }
+}
+
+void AudioEngine::onAsyncFormatChanged(AMediaCodec *codec, void *userData,
+                                       AMediaFormat *format) {
+  if (!format)
+    return;
+  LOGD("Async output format changed: %s", AMediaFormat_toString(format));
+  auto *engine = static_cast<AudioEngine *>(userData);
+  std::lock_guard<std::mutex> lock(engine->asyncMutex_);
+  // A next decoder's format is read back when it takes over.
+  if (codec == engine->codec_) {
+    engine->updateCodecOutputFormat(format);
   }
+}
+
+void AudioEngine::onAsyncError(AMediaCodec *, void *, media_status_t error,
+                               int32_t actionCode, const char *detail) {
+  LOGE("Async codec error %d (action %d): %s", error, actionCode,
+       detail ? detail : "");
+}
+
+/* ===================== Accurate seek ===================== */
+
+bool AudioEngine::seekSkipping() const {
+  return seekTargetUs_.load(std::memory_order_acquire) != kNoSeekTarget;
+}
+
+// Codec samples at the start of a buffer at ptsUs that lie before the
+// accurate-seek (or history resync) target, all of them if the buffer ends
+// before it. Reaching an accurate-seek target records the seek latency.
+int32_t AudioEngine::samplesBeforeTarget(int64_t ptsUs, int32_t count) {
+  int64_t target = seekTargetUs_.load(std::memory_order_acquire);
+  if (target == kNoSeekTarget)
+    return 0;
+  bool measured = seekSkipMeasured_.load(std::memory_order_relaxed);
+  bool following = targetFollowsClock_.load(std::memory_order_relaxed);
+  if (following) {
+    // Track switch: join the clock where audio queued now will be heard.
+    int64_t clockUs = virtualClock_->positionUs();
+    if (virtualClock_->isRunning()) {
+      clockUs += virtualClock_->outputLatencyUs() * playbackRateMilli_ / 1000;
+    }
+    target = std::max(target, clockUs);
+  }
+
+  int64_t skipFrames = 0;
+  if (ptsUs < target) {
+    // Round up: the first kept sample is the one at or after the target.
+    skipFrames = ((target - ptsUs) * codecSampleRate_ + 999999) / 1000000;
+    int64_t frames = count / codecChannelCount_;
+    if (skipFrames >= frames) {
+      if (measured) {
+        gAudioDebug.seekSkippedFrames.fetch_add(frames,
+                                                std::memory_order_relaxed);
+      }
+      return count;
+    }
+  }
+
+  seekTargetUs_.store(kNoSeekTarget, std::memory_order_release);
+  if (following) {
+    targetFollowsClock_.store(false, std::memory_order_relaxed);
+    gAudioDebug.trackSwitchUs.store(
+        monotonicUs() - seekStartUs_.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  }
+  if (measured) {
+    gAudioDebug.seekSkippedFrames.fetch_add(skipFrames,
+                                            std::memory_order_relaxed);
+    gAudioDebug.seekLatencyUs.store(
+        monotonicUs() - seekStartUs_.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+  }
+  return static_cast<int32_t>(skipFrames * codecChannelCount_);
+}
 
-  // Load head relaxed (producer local), tail acquire to observe consumer
-  // progress
-  int32_t head = writeHead_.load(std::memory_order_relaxed);
-  int32_t tail = readHead_.load(std::memory_order_acquire);
+// Codec samples of a buffer at ptsUs that lie before the item's end (all
+// of them unless the container declared encoder padding).
+int32_t AudioEngine::samplesBeforeEnd(int64_t ptsUs, int32_t count) const {
+  if (itemEndUs_ == kNoItemEnd)
+    return count;
+  if (ptsUs >= itemEndUs_)
+    return 0;
+  int64_t frames = (itemEndUs_ - ptsUs) * codecSampleRate_ / 1000000;
+  return static_cast<int32_t>(
+      std::min<int64_t>(count, frames * codecChannelCount_));
+}
+
+/* ===================== Gapless next item ===================== */
 
-  // Compute available space; if insufficient, drop audio (never wait)
-  int32_t available = kRingBufferSize - (head - tail);
-  if (available < samples) {
-    // Drop: do not block
+bool AudioEngine::prepareNext(std::shared_ptr<Demuxer> demuxer) {
+  cancelNext();
+  int32_t track = demuxer ? demuxer->findTrack("audio/") : -1;
+  if (track < 0 || !stream_)
     return false;
+
+  prepareStartUs_ = monotonicUs();
+  gAudioDebug.nextPrepareUs.store(-1, std::memory_order_relaxed);
+  prepareCancel_.store(false, std::memory_order_relaxed);
+  prepareThread_ = std::thread(&AudioEngine::prepareNextItem, this,
+                               std::move(demuxer), track);
+  return true;
+}
+
+void AudioEngine::cancelNext() {
+  prepareCancel_.store(true, std::memory_order_relaxed);
+  prepareWake_.notify();
+  if (prepareThread_.joinable()) {
+    prepareThread_.join();
+  }
+  NextItem item;
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex_);
+    nextReady_.store(false, std::memory_order_release);
+    std::swap(item, next_);
   }
+  gAudioDebug.nextReady.store(false, std::memory_order_relaxed);
+  releaseItem(item);
+}
 
-  for (int32_t i = 0; i < samples; i++) {
-    ringBuffer_[head % kRingBufferSize] = data[i];
-    head++;
+// Tears down a next item that never played. Outside asyncMutex_: stopping
+// an async codec waits for its callbacks.
+void AudioEngine::releaseItem(NextItem &item) {
+  if (item.codec) {
+    CodecPool::instance().recycle(item.codec, CodecPool::keyFor(item.format),
+                                  decodeMode_ == DecodeMode::Async);
+  }
+  if (item.demuxer) {
+    item.demuxer->detach(item.track);
   }
+  if (item.format) {
+    AMediaFormat_delete(item.format);
+  }
+  item = NextItem();
+}
 
-  // Publish new head (release)
-  writeHead_.store(head, std::memory_order_release);
-  // Update debug info with relaxed reads
-  gAudioDebug.bufferFill.store((writeHead_.load(std::memory_order_relaxed) -
-                                readHead_.load(std::memory_order_relaxed)) /
-                               channelCount_);
+// prepareThread_: decoder setup and priming, the slow part of an open,
+// while the current item keeps playing.
+void AudioEngine::prepareNextItem(std::shared_ptr<Demuxer> demuxer,
+                                  int32_t track) {
+  AMediaFormat *format = demuxer->trackFormat(track);
+  // Same decode mode as the running loop.
+  bool async = decodeMode_ == DecodeMode::Async;
+  CodecPool::Key key = CodecPool::keyFor(format);
+  AMediaCodec *codec = CodecPool::instance().acquire(key, async);
+  if (!codec) {
+    LOGE("Next item: no decoder for %s",
+         key.mime.empty() ? "?" : key.mime.c_str());
+    if (format)
+      AMediaFormat_delete(format);
+    return;
+  }
+
+  // Published before start so its callbacks find it.
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex_);
+    next_.demuxer = std::move(demuxer);
+    next_.track = track;
+    next_.codec = codec;
+    next_.format = format;
+    // Woken by its packets while priming, by the decode thread's once
+    // primed.
+    next_.serial = next_.demuxer->attach(track, &prepareWake_);
+    AMediaFormat_getInt64(format, AMEDIAFORMAT_KEY_DURATION,
+                          &next_.durationUs);
+  }
+
+  bool ok = true;
+  if (async) {
+    auto setAsyncCallback = ndkcompat::mediaCodecSetAsyncNotifyCallback();
+    ok = setAsyncCallback &&
+         setAsyncCallback(codec, asyncCallbacks(), this) == AMEDIA_OK;
+  }
+  AMediaFormat_setInt32(format, kKeyPcmEncoding, kAndroidEncodingPcmFloat);
+  ok = ok &&
+       AMediaCodec_configure(codec, format, nullptr, nullptr, 0) ==
+           AMEDIA_OK &&
+       AMediaCodec_start(codec) == AMEDIA_OK;
+  if (!ok) {
+    LOGE("Next item: decoder setup failed");
+    NextItem item;
+    {
+      std::lock_guard<std::mutex> lock(asyncMutex_);
+      std::swap(item, next_);
+    }
+    releaseItem(item);
+    return;
+  }
+
+  // Prime: hand the decoder its first packets so its first output is
+  // ready when it takes over. Async decoders get their input buffers from
+  // the callbacks; this only retries those the demuxer had nothing for,
+  // parked on prepareWake_ until packets or buffers arrive.
+  int64_t deadlineUs = monotonicUs() + kPrimeTimeoutUs;
+  while (!prepareCancel_.load(std::memory_order_relaxed)) {
+    if (!async) {
+      bool needInput;
+      {
+        std::lock_guard<std::mutex> lock(asyncMutex_);
+        needInput = next_.pendingInputs.empty();
+      }
+      ssize_t inIndex =
+          needInput ? AMediaCodec_dequeueInputBuffer(codec, kCodecBackoffUs)
+                    : -1;
+      if (inIndex >= 0) {
+        std::lock_guard<std::mutex> lock(asyncMutex_);
+        next_.pendingInputs.push_back(static_cast<int32_t>(inIndex));
+      }
+    }
+    // A sync decoder without an input buffer already waited in the
+    // dequeue above.
+    bool starved;
+    {
+      std::lock_guard<std::mutex> lock(asyncMutex_);
+      feedNextLocked();
+      if (next_.queuedPackets >= kPrimePackets || next_.inputEos)
+        break;
+      starved = async || !next_.pendingInputs.empty();
+    }
+    int64_t leftUs = deadlineUs - monotonicUs();
+    if (leftUs <= 0)
+      break;
+    if (starved)
+      prepareWake_.wait(leftUs);
+  }
+  next_.demuxer->attach(track, &wakeEvent_);
+
+  nextReady_.store(true, std::memory_order_release);
+  gAudioDebug.nextReady.store(true, std::memory_order_relaxed);
+  gAudioDebug.nextPrepareUs.store(monotonicUs() - prepareStartUs_,
+                                  std::memory_order_relaxed);
+  // The current item may have ended already.
+  wakeEvent_.notify();
+  LOGD("Next item ready after %lld us",
+       static_cast<long long>(monotonicUs() - prepareStartUs_));
+}
+
+// Feeds the next decoder's parked input buffers until it is primed.
+void AudioEngine::feedNextLocked() {
+  while (!next_.pendingInputs.empty() && !next_.inputEos &&
+         next_.queuedPackets < kPrimePackets) {
+    if (!queueNextInputLocked(next_.pendingInputs.front()))
+      return;
+    next_.pendingInputs.pop_front();
+  }
+}
+
+bool AudioEngine::queueNextInputLocked(int32_t index) {
+  size_t bufSize;
+  uint8_t *buf = AMediaCodec_getInputBuffer(next_.codec, index, &bufSize);
+  if (!buf)
+    return false;
+
+  Demuxer::PacketInfo packet;
+  switch (next_.demuxer->read(next_.track, next_.serial, buf, bufSize,
+                              &packet)) {
+  case Demuxer::ReadStatus::Ok:
+    AMediaCodec_queueInputBuffer(next_.codec, index, 0, packet.size,
+                                 packet.ptsUs, 0);
+    ++next_.queuedPackets;
+    return true;
+  case Demuxer::ReadStatus::EndOfStream:
+    AMediaCodec_queueInputBuffer(next_.codec, index, 0, 0, 0,
+                                 AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
+    next_.inputEos = true;
+    return true;
+  case Demuxer::ReadStatus::Discontinuity:
+    // Nothing has been decoded for it yet: just follow.
+    next_.serial = packet.serial;
+    return false;
+  case Demuxer::ReadStatus::Empty:
+    break;
+  }
+  return false;
+}
+
+// Decode thread, once the current decoder delivered end of stream: swap in
+// the prepared item. Its audio goes into the history (and the ring) right
+// after this item's last frame, or over the held crossfade tail, so the
+// stream never runs dry. False while nothing is ready or this item's audio
+// is not all in the ring yet.
+bool AudioEngine::advanceItem() {
+  {
+    std::lock_guard<std::mutex> lock(asyncMutex_);
+    if (!nextReady_.load(std::memory_order_acquire) || historyBacklog() > 0)
+      return false;
+    nextReady_.store(false, std::memory_order_relaxed);
+
+    // What is left in the history is the crossfade tail. The next item
+    // starts a new run (no rewinds back into this one).
+    crossfadeFrames_ = history_.readableFrames();
+    crossfadePos_ = 0;
+    PcmHistory::Span span = history_.acquireRead(crossfadeFrames_);
+    std::copy(span.first, span.first + span.firstCount,
+              crossfadeTail_.data());
+    std::copy(span.second, span.second + span.secondCount,
+              crossfadeTail_.data() + span.firstCount);
+    history_.clear();
+
+    retiredCodec_ = codec_;
+    retiredKey_ = CodecPool::keyFor(format_);
+    retiredDemuxer_ = std::move(demuxer_);
+    retiredTrack_ = track_;
+    if (format_) {
+      AMediaFormat_delete(format_);
+    }
+
+    codec_ = next_.codec;
+    demuxer_ = std::move(next_.demuxer);
+    track_ = next_.track;
+    demuxSerial_ = next_.serial;
+    format_ = next_.format;
+    durationUs_ = next_.durationUs;
+    itemEndUs_ = itemEndFor(format_, next_.durationUs);
+    inputEos_ = next_.inputEos;
+    pendingInputs_ = std::move(next_.pendingInputs);
+    pendingOutputs_ = std::move(next_.pendingOutputs);
+    next_ = NextItem();
+
+    // Container layout first, then whatever the decoder reported so far
+    // (a later format change still arrives the usual way).
+    int32_t sr = 0;
+    int32_t ch = 0;
+    AMediaFormat_getInt32(format_, AMEDIAFORMAT_KEY_SAMPLE_RATE, &sr);
+    AMediaFormat_getInt32(format_, AMEDIAFORMAT_KEY_CHANNEL_COUNT, &ch);
+    codecSampleRate_ = sr > 0 ? sr : codecSampleRate_;
+    codecChannelCount_ = ch > 0 ? ch : codecChannelCount_;
+    codecChannelMask_ = 0;
+    AMediaFormat_getInt32(format_, kKeyChannelMask, &codecChannelMask_);
+    if (AMediaFormat *outFormat = AMediaCodec_getOutputFormat(codec_)) {
+      updateCodecOutputFormat(outFormat);
+      AMediaFormat_delete(outFormat);
+    }
+    configureConversion();
+
+    itemEnded_.store(false, std::memory_order_relaxed);
+    discontinuityPending_.store(false, std::memory_order_relaxed);
+    // Priming frames stamped before 0 (edit lists) are dropped like the
+    // pre-roll of an accurate seek.
+    seekSkipMeasured_.store(false, std::memory_order_relaxed);
+    targetFollowsClock_.store(false, std::memory_order_relaxed);
+    seekTargetUs_.store(0, std::memory_order_release);
+    boundaryPending_ = true;
+  }
+
+  gAudioDebug.nextReady.store(false, std::memory_order_relaxed);
+  gAudioDebug.historyUs.store(0, std::memory_order_relaxed);
+  LOGD("Gapless transition (crossfade %zu frames)", crossfadeFrames_);
   return true;
 }
 
-void AudioEngine::renderAudio(int16_t *out, int32_t samples) {
-  int32_t head = writeHead_.load(std::memory_order_acquire);
-  int32_t tail = readHead_.load(std::memory_order_acquire);
-  int32_t available = head - tail;
+// Decode thread: the new item's first frame was rendered. Move the clock
+// onto its timeline and let the retired decoder go.
+void AudioEngine::pollItemBoundary() {
+  int64_t renderedUs =
+      boundaryRenderedUs_.exchange(0, std::memory_order_acq_rel);
+  if (renderedUs == 0)
+    return;
+  virtualClock_->seekUs(boundaryPtsUs_.load(std::memory_order_relaxed) +
+                        (monotonicUs() - renderedUs));
+  itemSerial_.fetch_add(1, std::memory_order_release);
+  gAudioDebug.gaplessTransitions.fetch_add(1, std::memory_order_relaxed);
+  releaseRetired();
+}
+
+void AudioEngine::releaseRetired() {
+  if (retiredCodec_) {
+    CodecPool::instance().recycle(retiredCodec_, retiredKey_,
+                                  decodeMode_ == DecodeMode::Async);
+    retiredCodec_ = nullptr;
+  }
+  if (retiredDemuxer_) {
+    retiredDemuxer_->detach(retiredTrack_);
+    retiredDemuxer_.reset();
+  }
+  retiredTrack_ = -1;
+}
+
+// Newest frames of this item kept out of the ring for the crossfade into a
+// prepared next item. Producer side.
+size_t AudioEngine::heldTailFrames() const {
+  if (!nextReady_.load(std::memory_order_acquire))
+    return 0;
+  size_t hold = std::min(
+      static_cast<size_t>(crossfadeUs_.load(std::memory_order_relaxed) *
+                          sampleRate_ / 1000000),
+      crossfadeTail_.size() / channelCount_);
+  return std::min(hold, history_.readableFrames());
+}
 
-  int32_t toRead = std::min(samples, available);
+// History frames still to be pumped into the ring.
+size_t AudioEngine::historyBacklog() const {
+  return history_.readableFrames() - heldTailFrames();
+}
 
-  for (int i = 0; i < toRead; i++) {
-    out[i] = ringBuffer_[tail % kRingBufferSize];
-    tail++;
+// Equal-power crossfade of the previous item's tail into the first frames
+// of the new one, in place.
+void AudioEngine::mixCrossfade(float *pcm, size_t frames) {
+  const size_t ch = static_cast<size_t>(channelCount_);
+  const float *tail = crossfadeTail_.data();
+  const float halfPi = 1.57079632679f;
+  for (size_t f = 0; f < frames && crossfadePos_ < crossfadeFrames_;
+       ++f, ++crossfadePos_) {
+    float t = (crossfadePos_ + 0.5f) / crossfadeFrames_;
+    float in = std::sin(t * halfPi);
+    float out = std::cos(t * halfPi);
+    for (size_t c = 0; c < ch; ++c) {
+      pcm[f * ch + c] =
+          pcm[f * ch + c] * in + tail[crossfadePos_ * ch + c] * out;
+    }
   }
+}
 
-  // 🔇 Fill silence on underrun
-  for (int i = toRead; i < samples; i++) {
-    out[i] = 0;
+/* ===================== Producer (lock-free) ===================== */
+
+// Both write paths append to the history and return how many codec
+// samples were consumed; pumpHistory() moves them on into the ring.
+int32_t AudioEngine::writeAudio(const uint8_t *data, int32_t samples,
+                                int64_t ptsUs) {
+  if (resamplerResetPending_.exchange(false, std::memory_order_acq_rel)) {
+    resampler_.reset();
+  }
+  // Frames already waiting go first (and make room).
+  pumpHistory();
+
+  int32_t consumed;
+  if (mixer_.active() || resampler_.active()) {
+    consumed = writeStaged(data, samples, ptsUs);
+  } else {
+    // Convert the codec output straight into the history's free space (no
+    // staging buffer). Whole frames only, so a partial write never splits
+    // the interleave.
+    PcmHistory::Span span =
+        history_.acquireWrite(static_cast<size_t>(samples) / channelCount_);
+    size_t n = span.size();
+    convertToFloat(codecEncoding_, data, span.first, span.firstCount);
+    if (span.secondCount) {
+      convertToFloat(codecEncoding_,
+                     data + span.firstCount * pcmBytesPerSample(codecEncoding_),
+                     span.second, span.secondCount);
+    }
+    history_.commitWrite(n / channelCount_, ptsUs);
+    consumed = static_cast<int32_t>(n);
+  }
+
+  pumpHistory();
+  if (consumed < samples) {
+    // History full: the caller keeps the rest and retries once the ring
+    // drains.
+    rtCounterAdd(gAudioDebug.writeShortfalls, 1);
+  }
+  return consumed;
+}
+
+int32_t AudioEngine::writeStaged(const uint8_t *data, int32_t samples,
+                                 int64_t ptsUs) {
+  // Codec layout/rate differs from the stream: convert, mix and resample in
+  // chunks through the staging buffers. Take only as much input as is
+  // guaranteed to fit in the history once converted, so nothing is held
+  // back.
+  const size_t inCh = static_cast<size_t>(codecChannelCount_);
+  const size_t bytesPerFrame = pcmBytesPerSample(codecEncoding_) * inCh;
+  size_t frames = static_cast<size_t>(samples) / inCh;
+  size_t consumed = 0;
+
+  while (consumed < frames) {
+    size_t freeFrames = history_.writableFrames();
+    size_t room = resampler_.active()
+                      ? resampler_.maxInputFramesFor(freeFrames)
+                      : std::min(freeFrames, kStageChunkFrames);
+    size_t k = std::min(frames - consumed, room);
+    if (k == 0)
+      break;
+
+    convertToFloat(codecEncoding_, data + consumed * bytesPerFrame,
+                   stageIn_.data(), k * inCh);
+    const float *pcm = stageIn_.data();
+    size_t out = k;
+
+    if (mixer_.active()) {
+      mixer_.process(pcm, stageMix_.data(), k);
+      pcm = stageMix_.data();
+    }
+    if (resampler_.active()) {
+      out = resampler_.process(pcm, k, stageOut_.data());
+      pcm = stageOut_.data();
+    }
+
+    history_.write(pcm, out,
+                   samplePtsUs(ptsUs, static_cast<int32_t>(consumed * inCh)));
+    consumed += k;
+  }
+  return static_cast<int32_t>(consumed * inCh);
+}
+
+// Moves history frames from its cursor into the ring (time-stretched when
+// the rate is not 1), as many as fit, and charges them against
+// framesRequested_. Frames left over (ring full, e.g. replaying after a
+// rewind) ask renderCallback for a wakeup once there is room again. Same
+// threads as writeAudio.
+void AudioEngine::pumpHistory() {
+  // A new segment starts from the cursor with nothing buffered.
+  uint32_t gen = flushGeneration_.load(std::memory_order_acquire);
+  bool newSegment = ptsGeneration_.load(std::memory_order_relaxed) != gen;
+  if (newSegment) {
+    stretcher_.reset();
+  }
+  dsp_.update();
+  if (newSegment) {
+    dsp_.reset();
+  }
+
+  size_t backlog = historyBacklog();
+  size_t frames = std::min(
+      backlog,
+      stretcher_.maxInputFramesFor(ring_.availableToWrite() / channelCount_));
+  size_t left = backlog - frames;
+  if (left > 0) {
+    spaceWanted_.store(static_cast<int32_t>(std::min(
+                           left * channelCount_, ring_.capacity() / 4)),
+                       std::memory_order_release);
+  }
+  if (frames == 0)
+    return;
+
+  // First audio of a new segment: publish its media time before the samples
+  // (the ring's release store orders it for the callback).
+  if (newSegment) {
+    ringBasePtsUs_.store(history_.cursorUs(), std::memory_order_relaxed);
+    ringRateMilli_.store(playbackRateMilli_, std::memory_order_relaxed);
+    ptsGeneration_.store(gen, std::memory_order_release);
+  }
+  // First audio of an item that took over gaplessly: same for the ring
+  // position where it starts (early by what the stretcher holds back).
+  if (boundaryPending_) {
+    boundaryPending_ = false;
+    boundaryPtsUs_.store(history_.cursorUs(), std::memory_order_relaxed);
+    boundarySample_.store(ring_.writePosition(), std::memory_order_relaxed);
+    boundarySet_.store(true, std::memory_order_release);
   }
 
-  readHead_.store(tail, std::memory_order_release);
+  PcmHistory::Span span = history_.acquireRead(frames);
+  if (crossfadePos_ < crossfadeFrames_) {
+    mixCrossfade(span.first, span.firstCount / channelCount_);
+    mixCrossfade(span.second, span.secondCount / channelCount_);
+  }
+  size_t written = frames;
+  if (stretcher_.active()) {
+    written = stretchToRing(span.first, span.firstCount / channelCount_) +
+              stretchToRing(span.second, span.secondCount / channelCount_);
+  } else {
+    writeRing(span.first, span.firstCount / channelCount_);
+    writeRing(span.second, span.secondCount / channelCount_);
+  }
+  history_.commitRead(frames);
+
+  // 📉 Decrement demand by what we actually produced
+  framesRequested_.fetch_sub(static_cast<int32_t>(written),
+                             std::memory_order_release);
+
+  // Update debug info with relaxed reads
+  gAudioDebug.bufferFill.store(ring_.availableToRead() / channelCount_);
+  gAudioDebug.historyUs.store(history_.endUs() - history_.startUs(),
+                              std::memory_order_relaxed);
+}
+
+// Stretches history frames into the ring in stretcher-sized calls and
+// returns the ring frames written.
+size_t AudioEngine::stretchToRing(const float *pcm, size_t frames) {
+  const size_t ch = static_cast<size_t>(channelCount_);
+  size_t written = 0;
+  while (frames > 0) {
+    size_t k = std::min(frames, kStageChunkFrames);
+    size_t out = stretcher_.process(pcm, k, stretchOut_.data());
+    writeRing(stretchOut_.data(), out);
+    written += out;
+    pcm += k * ch;
+    frames -= k;
+  }
+  return written;
 }
 
+// Queues stream frames into the ring, through the DSP chain when it is
+// active (into dspOut_: the input may be history memory). pumpHistory()
+// sized them to the free space, so a refusal means lost audio.
+void AudioEngine::writeRing(const float *pcm, size_t frames) {
+  const size_t ch = static_cast<size_t>(channelCount_);
+  if (!dsp_.active()) {
+    if (frames > 0 && !ring_.write(pcm, frames * ch)) {
+      rtCounterAdd(gAudioDebug.droppedWrites, 1);
+    }
+    return;
+  }
+  while (frames > 0) {
+    size_t k = std::min(frames, kStageChunkFrames);
+    dsp_.process(pcm, dspOut_.data(), k);
+    if (!ring_.write(dspOut_.data(), k * ch)) {
+      rtCounterAdd(gAudioDebug.droppedWrites, 1);
+    }
+    pcm += k * ch;
+    frames -= k;
+  }
+}
+
+// Caller holds asyncMutex_.
+void AudioEngine::clearHistoryLocked() {
+  history_.clear();
+  gAudioDebug.historyUs.store(0, std::memory_order_relaxed);
+}
+
+// Media time of the codec sample `offsetSamples` into a buffer at ptsUs.
+int64_t AudioEngine::samplePtsUs(int64_t bufferPtsUs,
+                                 int32_t offsetSamples) const {
+  return bufferPtsUs + static_cast<int64_t>(offsetSamples /
+                                            codecChannelCount_) *
+                           1000000 / codecSampleRate_;
+}
+
+// Ring space (samples) needed before the given codec samples can be queued.
+int32_t AudioEngine::ringSamplesFor(int32_t codecSamples) const {
+  size_t frames = static_cast<size_t>(codecSamples / codecChannelCount_);
+  if (resampler_.active())
+    frames = resampler_.maxOutputFrames(frames);
+  return static_cast<int32_t>(
+      std::min(frames * channelCount_, ring_.capacity()));
+}
+
+size_t AudioEngine::renderAudio(void *out, int32_t samples) {
+  // Float streams copy; integer streams convert (with dither) straight from
+  // ring memory into the AAudio buffer.
+  SpscRing<float>::Span span = ring_.acquireRead(samples);
+  size_t got = span.size();
+  size_t bytesPerSample = pcmBytesPerSample(streamEncoding_);
+  auto *dst = static_cast<uint8_t *>(out);
+
+  convertFromFloat(streamEncoding_, span.first, dst, span.firstCount,
+                   &ditherState_);
+  if (span.secondCount) {
+    convertFromFloat(streamEncoding_, span.second,
+                     dst + span.firstCount * bytesPerSample, span.secondCount,
+                     &ditherState_);
+  }
+  ring_.commitRead(got);
+
+  // 🔇 Fill silence on underrun
+  if (got < static_cast<size_t>(samples)) {
+    memset(dst + got * bytesPerSample, 0, (samples - got) * bytesPerSample);
+  }
+  return got;
+}
+
+// Fences off the callback itself; the producer side is the caller's: hold
+// asyncMutex_ unless no codec callback can be writing (gates closed,
+// decode thread stopped).
 void AudioEngine::flushRingBuffer() {
+  // An item boundary not rendered yet moves to the first audio written
+  // after the flush (the item still has to be announced).
+  if (boundarySet_.exchange(false, std::memory_order_acq_rel)) {
+    boundaryPending_ = true;
+  }
+  // The callback keeps reading through rate and track changes and
+  // discontinuities: close the ring to it and wait out a read in flight
+  // (one callback at most) so the reset races with nothing.
+  ringFlushing_.store(true, std::memory_order_seq_cst);
+  while (ringReading_.load(std::memory_order_seq_cst)) {
+    std::this_thread::yield();
+  }
   // 🔥 REQUIRED: Clear memory to prevent ghost audio
-  memset(ringBuffer_, 0, sizeof(ringBuffer_));
-  readHead_.store(0, std::memory_order_release);
-  writeHead_.store(0, std::memory_order_release);
+  ring_.reset();
+  // New media segment: earlier clock anchors no longer describe the ring.
+  flushGeneration_.fetch_add(1, std::memory_order_acq_rel);
+  ringFlushing_.store(false, std::memory_order_release);
+}
+
+/* ===================== Audio-anchored clock ===================== */
+
+// Callback side: after each callback, record which stream frames carried
+// which media time. `gotFrames` real frames were rendered at the start of
+// the buffer, silence after them.
+void AudioEngine::trackPresentation(int32_t numFrames, int32_t gotFrames) {
+  uint32_t gen = flushGeneration_.load(std::memory_order_acquire);
+  if (gen != callbackGeneration_) {
+    callbackGeneration_ = gen;
+    renderedSinceFlush_ = 0;
+    segmentStartFrame_ = -1;
+    segmentBaseKnown_ = false;
+  }
+
+  if (gotFrames > 0 && ptsGeneration_.load(std::memory_order_acquire) == gen) {
+    if (!segmentBaseKnown_) {
+      segmentBaseUs_ = ringBasePtsUs_.load(std::memory_order_relaxed);
+      segmentRateMilli_ = ringRateMilli_.load(std::memory_order_relaxed);
+      segmentBaseKnown_ = true;
+    }
+
+    // A gapless item boundary inside this buffer: the frames from there on
+    // start the new item's timeline.
+    int32_t before = gotFrames;
+    if (boundarySet_.load(std::memory_order_acquire)) {
+      size_t got = static_cast<size_t>(gotFrames) * channelCount_;
+      size_t fromStart = boundarySample_.load(std::memory_order_relaxed) -
+                         (ring_.readPosition() - got);
+      if (fromStart < got) {
+        before = static_cast<int32_t>(fromStart / channelCount_);
+      }
+    }
+    publishAnchor(streamFramesWritten_, before);
+    if (before < gotFrames) {
+      boundarySet_.store(false, std::memory_order_relaxed);
+      segmentBaseUs_ = boundaryPtsUs_.load(std::memory_order_relaxed);
+      renderedSinceFlush_ = 0;
+      segmentStartFrame_ = streamFramesWritten_ + before;
+      publishAnchor(streamFramesWritten_ + before, gotFrames - before);
+      boundaryRenderedUs_.store(monotonicUs(), std::memory_order_release);
+      wakeEvent_.notify();
+    }
+  }
+
+  // Silence breaks the continuous run: media time stood still meanwhile.
+  if (gotFrames < numFrames) {
+    segmentStartFrame_ = -1;
+  }
+  streamFramesWritten_ += numFrames;
+}
+
+// `frames` real frames from `streamFrame` on continue the current segment.
+void AudioEngine::publishAnchor(int64_t streamFrame, int32_t frames) {
+  if (frames <= 0)
+    return;
+  if (segmentStartFrame_ < 0) {
+    segmentStartFrame_ = streamFrame;
+  }
+  AudioAnchor anchor;
+  anchor.streamFrame = streamFrame;
+  anchor.mediaUs =
+      segmentBaseUs_ + ringFramesUs(renderedSinceFlush_, segmentRateMilli_);
+  anchor.frames = frames;
+  anchor.segmentStartFrame = segmentStartFrame_;
+  anchor.generation = callbackGeneration_;
+  anchor.rateMilli = segmentRateMilli_;
+  anchor_.store(anchor);
+  renderedSinceFlush_ += frames;
+}
+
+// Media time covered by `frames` ring frames stretched for `rateMilli`.
+int64_t AudioEngine::ringFramesUs(int64_t frames, int32_t rateMilli) const {
+  return frames * rateMilli * 1000 / sampleRate_;
+}
+
+// Decode-thread side: map the frame AAudio says reached the DAC back to
+// media time and let the clock slew towards it. Rate-limited; cheap when
+// the clock is in monotonic mode.
+void AudioEngine::pollAudioTimestamp() {
+  if (!stream_ ||
+      virtualClock_->mode() != VirtualClock::Mode::AudioAnchored) {
+    return;
+  }
+  int64_t now = monotonicUs();
+  if (now - lastTimestampPollUs_ < kTimestampPollUs) {
+    return;
+  }
+  lastTimestampPollUs_ = now;
+
+  int64_t framePosition = 0;
+  int64_t timeNs = 0;
+  if (AAudioStream_getTimestamp(stream_, CLOCK_MONOTONIC, &framePosition,
+                                &timeNs) != AAUDIO_OK ||
+      framePosition <= 0) {
+    virtualClock_->noteTimestampUnavailable();
+    return;
+  }
+
+  AudioAnchor a = anchor_.load();
+
+  // Output latency as seen right now (written but not yet audible).
+  int64_t writtenFrames = AAudioStream_getFramesWritten(stream_);
+  gAudioDebug.outputLatencyUs.store(
+      (writtenFrames - framePosition) * 1000000 / sampleRate_ +
+          (timeNs / 1000 - now),
+      std::memory_order_relaxed);
+
+  // Only frames inside the current continuous run map linearly to media
+  // time (not pre-seek audio, not underrun silence).
+  if (a.generation != flushGeneration_.load(std::memory_order_acquire) ||
+      a.segmentStartFrame < 0 || framePosition < a.segmentStartFrame ||
+      framePosition > a.streamFrame + a.frames) {
+    return;
+  }
+
+  int64_t mediaUs =
+      a.mediaUs + ringFramesUs(framePosition - a.streamFrame, a.rateMilli);
+  virtualClock_->syncToAudio(mediaUs, timeNs / 1000);
+}
+
+// Decode-thread side: the stream's own underrun count (it belongs to the
+// shared stream, so it spans engines), which also drives the session's
+// buffer sizing in low-latency mode, and the output latency the clock holds
+// back by. Rate-limited.
+void AudioEngine::pollStreamMetrics() {
+  if (!stream_)
+    return;
+  int64_t now = monotonicUs();
+  if (now - lastStreamMetricsPollUs_ < kStreamMetricsPollUs)
+    return;
+  lastStreamMetricsPollUs_ = now;
+
+  AudioOutput &output = AudioOutput::instance();
+  int32_t xruns = output.tuneBuffer();
+  if (xruns >= 0) {
+    gAudioDebug.xruns.store(xruns, std::memory_order_relaxed);
+  }
+
+  // Measured by timestamps while they steer the clock, else the device
+  // buffer (the part of the latency the session controls).
+  int64_t latencyUs =
+      virtualClock_->syncStats().anchored
+          ? gAudioDebug.outputLatencyUs.load(std::memory_order_relaxed)
+          : output.bufferLatencyUs();
+  virtualClock_->setOutputLatencyUs(latencyUs);
+}
+
+// Callback side: ring fill at callback entry (returned, in frames),
+// min/max per snapshot window.
+int64_t AudioEngine::noteRingFill() {
+  int64_t fill = static_cast<int64_t>(ring_.availableToRead()) / channelCount_;
+  uint32_t window = gAudioDebug.fillWindow.load(std::memory_order_relaxed);
+  int64_t lo = gAudioDebug.ringFillMinFrames.load(std::memory_order_relaxed);
+  int64_t hi = gAudioDebug.ringFillMaxFrames.load(std::memory_order_relaxed);
+  if (window != gAudioDebug.fillWindowSeen || lo < 0) {
+    gAudioDebug.fillWindowSeen = window;
+    lo = hi = fill;
+  }
+  gAudioDebug.ringFillMinFrames.store(std::min(lo, fill),
+                                      std::memory_order_relaxed);
+  gAudioDebug.ringFillMaxFrames.store(std::max(hi, fill),
+                                      std::memory_order_relaxed);
+  return fill;
 }
 
 int32_t AudioEngine::framesToSamples(int32_t frames) const {
@@ -624,35 +2089,103 @@ int32_t AudioEngine::framesToSamples(int32_t frames) const {
 
 // ===================== Audio Callbacks =====================
 
-aaudio_data_callback_result_t AudioEngine::dataCallback(AAudioStream *stream,
-                                                        void *userData,
-                                                        void *audioData,
-                                                        int32_t numFrames) {
+// Called from AudioOutput's AAudio callback while this engine is attached.
+void AudioEngine::renderCallback(void *userData, void *audioData,
+                                 int32_t numFrames, int64_t framePosition) {
 
   auto *engine = static_cast<AudioEngine *>(userData);
-  if (!engine)
-    return AAUDIO_CALLBACK_RESULT_STOP;
+
+  // 📊 Metrics: wait-free single-writer updates only (no locks, no RMW)
+  int64_t entryUs = monotonicUs();
+  if (engine->lastCallbackUs_ > 0) {
+    gAudioDebug.callbackPeriodUs.record(entryUs - engine->lastCallbackUs_);
+  }
+  engine->lastCallbackUs_ = entryUs;
+  rtCounterAdd(gAudioDebug.callbackCount, 1);
 
   gAudioDebug.callbackCalled.store(true);
+  // The stream outlives engines; its frame count is the timestamp base.
+  engine->streamFramesWritten_ = framePosition;
 
   int32_t numSamples = engine->framesToSamples(numFrames);
 
   // 🚨 CLOCK CHECK - Never stop callback, but respect clock state
   if (!engine->virtualClock_->isRunning()) {
-    memset(audioData, 0, numSamples * sizeof(int16_t));
-    return AAUDIO_CALLBACK_RESULT_CONTINUE;
+    memset(audioData, 0,
+           numSamples * pcmBytesPerSample(engine->streamEncoding_));
+    engine->trackPresentation(numFrames, 0);
+    gAudioDebug.callbackDurationUs.record(monotonicUs() - entryUs);
+    return;
   }
 
-  // 1️⃣ Signal demand to the producer (decodeLoop)
-  engine->framesRequested_.fetch_add(numFrames, std::memory_order_release);
+  // 1️⃣ Signal demand to the producer (decodeLoop); wake it only when the
+  // demand crosses the low-water mark, not on every callback. A deep
+  // buffer wakes it on its own mark below.
+  int32_t deepLowWater =
+      engine->deepLowWater_.load(std::memory_order_relaxed);
+  int32_t prev =
+      engine->framesRequested_.fetch_add(numFrames, std::memory_order_release);
+  bool wake = deepLowWater == 0 && prev + kDemandLowWaterFrames <= 0 &&
+              prev + numFrames + kDemandLowWaterFrames > 0;
+
+  // 2️⃣ Render audio (pull from ring buffer). A flush in progress owns the
+  // ring: play silence instead of reading it (see flushRingBuffer).
+  engine->ringReading_.store(true, std::memory_order_seq_cst);
+  if (engine->audioOutputEnabled_.load(std::memory_order_acquire) &&
+      !engine->ringFlushing_.load(std::memory_order_seq_cst)) {
+    int64_t fill = engine->noteRingFill();
+    size_t got = engine->renderAudio(audioData, numSamples);
+    int32_t gotFrames = static_cast<int32_t>(got) / engine->channelCount_;
+    engine->trackPresentation(numFrames, gotFrames);
+
+    // 🔋 Deep buffer: one wakeup per refill, when the fill drops below the
+    // low-water mark
+    if (deepLowWater > 0 && fill >= deepLowWater &&
+        fill - gotFrames < deepLowWater) {
+      wake = true;
+    }
+
+    // 🕳️ Underrun: silence padded into a segment that already played,
+    // before its item ran out (priming after a seek/start is not one)
+    if (gotFrames < numFrames && engine->renderedSinceFlush_ > 0 &&
+        !engine->itemEnded_.load(std::memory_order_relaxed)) {
+      rtCounterAdd(gAudioDebug.underrunCallbacks, 1);
+      rtCounterAdd(gAudioDebug.underrunFrames, numFrames - gotFrames);
+    }
 
-  // 2️⃣ Render audio (pull from ring buffer)
-  if (engine->audioOutputEnabled_.load(std::memory_order_acquire)) {
-    engine->renderAudio(static_cast<int16_t *>(audioData), numSamples);
+    // ⏱️ Time-to-first-audio (clock_gettime is vDSO, RT-safe)
+    if (got > 0 &&
+        !engine->firstAudioRendered_.load(std::memory_order_relaxed)) {
+      engine->firstAudioRendered_.store(true, std::memory_order_relaxed);
+      int64_t now = monotonicUs();
+      gAudioDebug.firstAudioUs.store(
+          now - engine->startRequestUs_.load(std::memory_order_relaxed),
+          std::memory_order_relaxed);
+      int64_t openUs = engine->openRequestUs_.load(std::memory_order_relaxed);
+      if (openUs > 0) {
+        gAudioDebug.openFirstAudioUs.store(now - openUs,
+                                           std::memory_order_relaxed);
+      }
+    }
   } else {
     // Output gated - write silence
-    memset(audioData, 0, numSamples * sizeof(int16_t));
+    memset(audioData, 0,
+           numSamples * pcmBytesPerSample(engine->streamEncoding_));
+    engine->trackPresentation(numFrames, 0);
+  }
+  engine->ringReading_.store(false, std::memory_order_release);
+
+  // 3️⃣ Producer parked on a full ring: wake it once enough space is free
+  int32_t wanted = engine->spaceWanted_.load(std::memory_order_acquire);
+  if (wanted > 0 &&
+      engine->ring_.availableToWrite() >= static_cast<size_t>(wanted)) {
+    engine->spaceWanted_.store(0, std::memory_order_relaxed);
+    wake = true;
+  }
+
+  if (wake) {
+    engine->wakeEvent_.notify();
   }
 
-  return AAUDIO_CALLBACK_RESULT_CONTINUE;
+  gAudioDebug.callbackDurationUs.record(monotonicUs() - entryUs);
 }
@@ -4,42 +4,205 @@
 #include <media/NdkMediaCodec.h>
 #include <media/NdkMediaExtractor.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
+#include "AudioOutput.h"
+#include "CodecPool.h"
+#include "Demuxer.h"
 #include "VirtualClock.h"
+#include "core/ChannelMixer.h"
+#include "core/DspChain.h"
+#include "core/MpscQueue.h"
+#include "core/PcmHistory.h"
+#include "core/PcmConvert.h"
+#include "core/Resampler.h"
+#include "core/TimeStretch.h"
+#include "core/Seqlock.h"
+#include "core/SpscRing.h"
+#include "core/WakeEvent.h"
 
 class AudioEngine {
 public:
+  // How MediaCodec is driven. Async uses AMediaCodec_setAsyncNotifyCallback
+  // (API 28+); Sync is the timeout-0 polling loop and the fallback on older
+  // devices.
+  enum class DecodeMode : int32_t { Sync = 0, Async = 1 };
+
   explicit AudioEngine(VirtualClock *clock);
   ~AudioEngine();
 
   bool open(const char *path);
   bool openFd(int fd, int64_t offset, int64_t length);
+  // Decodes the demuxer's first audio track; the demuxer may be shared with
+  // the VideoEngine.
+  bool open(std::shared_ptr<Demuxer> demuxer);
+  // start()/pause()/seekUs() only post a command and return; the decode
+  // thread applies them in order (see drainCommands). Safe to call while it
+  // is inside a codec or demuxer call.
   void start();
   // Soft pause: never stop the AAudio stream on pause. Gate audio in the
-  // callback and in the decode loop.
+  // callback (immediately) and in the decode loop.
   void pause();
   void stop();
-  void seekUs(int64_t us);
-  int64_t getDurationUs() const { return durationUs_; }
+  // `seekId` pairs this seek with video's half of the same user seek on a
+  // shared demuxer (Demuxer::seekUs); 0 = not shared.
+  void seekUs(int64_t us, uint32_t seekId);
+  // Playback speed, clamped to [TimeStretcher::kMinRate, kMaxRate], pitch
+  // preserved. Posted like seekUs(); applies mid-playback without a pause
+  // and carries the VirtualClock (and so video pacing) along.
+  void setPlaybackRate(float rate);
+  // Live switch to another audio track of the open file (container track
+  // index). Posted like seekUs(); the stream and the clock keep running,
+  // only the decoder is replaced, and the new track joins at the clock.
+  void selectAudioTrack(int32_t track);
+  int64_t getDurationUs() const {
+    return durationUs_.load(std::memory_order_relaxed);
+  }
+
+  // Must be set before open(); ignored (Sync) when the device lacks the API.
+  void setPreferAsyncDecode(bool prefer) { preferAsyncDecode_ = prefer; }
+
+  // Must be set before open(). Used when the stream's native rate differs
+  // from the track's.
+  void setResamplerQuality(ResamplerQuality quality) {
+    resamplerQuality_ = quality;
+  }
+
+  // Must be set before open(). Applied when the stream has fewer (or other)
+  // channels than the track.
+  void setDownmixOptions(const DownmixOptions &options) {
+    downmixOptions_ = options;
+  }
+
+  // Must be set before open(). Keeps up to `maxUs` of decoded audio (less
+  // if it would take more than `maxBytes`) so rewinds inside it are served
+  // from memory. maxUs = 0 disables serving seeks from it.
+  void setRewindCache(int64_t maxUs, size_t maxBytes) {
+    rewindCacheUs_ = maxUs;
+    rewindCacheBytes_ = maxBytes;
+  }
+
+  // Accurate seek: start decoding at the sync sample before the target but
+  // drop everything before the target instead of playing it. Applies from
+  // the next seek.
+  void setAccurateSeek(bool accurate) {
+    accurateSeek_.store(accurate, std::memory_order_relaxed);
+  }
+
+  // Volume boost, EQ and night mode, applied between the history and the
+  // ring. Any thread (one writer at a time), lock-free; takes effect with
+  // the next audio queued.
+  void setDspParams(const DspParams &params) { dsp_.setParams(params); }
+  // Gain reduction (dB) of the night-mode compressor and the limiter over
+  // the last block processed. Any thread.
+  float compressorReductionDb() const { return dsp_.compressorReductionDb(); }
+  float limiterReductionDb() const { return dsp_.limiterReductionDb(); }
+
+  // Deep buffering for power saving (screen off, audio only): decode in
+  // batches until kDeepBufferUs is queued, then sleep until only
+  // kDeepLowWaterUs is left instead of topping the ring up every few ms.
+  // Any thread, applies at once.
+  void setDeepBuffer(bool enabled) {
+    deepBuffer_.store(enabled, std::memory_order_release);
+    wakeEvent_.notify();
+  }
+
+  // Monotonic time the caller was asked to play this file, for the
+  // open → first audio stat. Set before open().
+  void setOpenRequestUs(int64_t us) {
+    openRequestUs_.store(us, std::memory_order_relaxed);
+  }
+
+  /* ───────── Gapless next item ───────── */
+  // Opens the next item's audio on `demuxer` in the background (its own
+  // decoder, fed its first packets) while this one plays. When the current
+  // decoder reaches its end, the prepared one takes over inside the same
+  // AAudio stream, right after this item's last frame. Replaces an item
+  // prepared earlier; false if `demuxer` has no audio track.
+  bool prepareNext(std::shared_ptr<Demuxer> demuxer);
+  void cancelNext();
+  // Equal-power overlap of the outgoing and the incoming item; 0 splices
+  // them back to back. Capped at kMaxCrossfadeUs, applies from the next
+  // transition.
+  void setCrossfadeUs(int64_t us) {
+    crossfadeUs_.store(std::clamp<int64_t>(us, 0, kMaxCrossfadeUs),
+                       std::memory_order_relaxed);
+  }
+  // Bumped when a prepared item took over and its first frame was rendered
+  // (the clock is on its timeline from then on).
+  uint32_t itemSerial() const {
+    return itemSerial_.load(std::memory_order_acquire);
+  }
 
   // Diagnostics
   bool hasAudioTrack() const { return hasAudioTrack_; }
+  DecodeMode decodeMode() const { return decodeMode_; }
 
 private:
   /* Media */
-  AMediaExtractor *extractor_ = nullptr;
+  std::shared_ptr<Demuxer> demuxer_;
+  int32_t track_ = -1;
+  uint32_t demuxSerial_ = 0; // serial of the packets fed to the codec
   AMediaCodec *codec_ = nullptr;
   AMediaFormat *format_ = nullptr;
-  int64_t durationUs_ = 0;
+  std::atomic<int64_t> durationUs_{0};
 
   /* Audio */
+  // Borrowed from the AudioOutput session between setupAAudio() and
+  // cleanupAAudio(); the session owns and closes it.
   AAudioStream *stream_ = nullptr;
-  int32_t sampleRate_ = 0;
-  int32_t channelCount_ = 0;
+  const AudioOutput::Sink sink_{&AudioEngine::renderCallback, this};
+  int32_t sampleRate_ = 0; // stream (device) rate once AAudio is open
+  int32_t channelCount_ = 0;    // stream channels (ring interleave)
+  int32_t codecSampleRate_ = 0; // decoder output rate
+  int32_t codecChannelCount_ = 0;
+  int32_t codecChannelMask_ = 0; // AudioFormat CHANNEL_OUT_* bits, 0 = unknown
+
+  // Sample formats on both sides of the float ring. codecEncoding_ follows
+  // the decoder's output format; streamEncoding_ is what AAudio granted
+  // (float unless the device refused it).
+  PcmEncoding codecEncoding_ = PcmEncoding::I16;
+  PcmEncoding streamEncoding_ = PcmEncoding::Float;
+  PcmDither ditherState_; // callback-owned
+
+  /* ───────── Layout / rate conversion (producer side) ───────── */
+  // The stream opens at the device's native rate and with as many channels
+  // as it grants. When either differs from the decoder, writeAudio runs
+  // codec output through mixer_ (downmix/remap) and resampler_ in chunks of
+  // kStageChunkFrames using preallocated staging buffers, on the decode
+  // thread only. Seeks only raise resamplerResetPending_; the producer drops
+  // the history itself.
+  static constexpr size_t kStageChunkFrames = 1024;
+  DownmixOptions downmixOptions_;
+  ChannelMixer mixer_;
+  ResamplerQuality resamplerQuality_ = ResamplerQuality::Medium;
+  PolyphaseResampler resampler_;
+  std::vector<float> stageIn_;  // codec layout
+  std::vector<float> stageMix_; // stream layout, codec rate
+  std::vector<float> stageOut_; // stream layout, stream rate
+  std::atomic<bool> resamplerResetPending_{false};
+
+  /* ───────── Time stretch (producer side) ───────── */
+  // Between the history (media time) and the ring (playback time), so
+  // rewinds and seeks stay in media frames. Restarted with every new ring
+  // segment; playbackRateMilli_ changes under asyncMutex_ (applyRate).
+  TimeStretcher stretcher_;
+  std::vector<float> stretchOut_; // stream layout, one process() call
+  int32_t playbackRateMilli_ = 1000;
+
+  /* ───────── Output DSP (producer side) ───────── */
+  // Last stage before the ring (after the stretcher), so a settings change
+  // is heard once the ring drains rather than after the whole history.
+  // Reset with every new ring segment.
+  DspChain dsp_;
+  std::vector<float> dspOut_; // stream layout, kStageChunkFrames
 
   VirtualClock *virtualClock_ = nullptr;
 
@@ -55,18 +218,240 @@ private:
   // DEMAND-DRIVEN PACING
   std::atomic<int32_t> framesRequested_{0};
 
+  // EVENT-DRIVEN WAKEUPS
+  // The decode thread parks on wakeEvent_ instead of sleep-polling. Control
+  // calls (start/pause/stop/seek) notify it; renderCallback notifies when
+  // demand crosses the low-water mark or when the space the producer is
+  // waiting for (spaceWanted_, in samples) has been drained.
+  static constexpr int32_t kDemandLowWaterFrames = 2048;
+  static constexpr int64_t kCodecBackoffUs = 1000;
+  WakeEvent wakeEvent_;
+  std::atomic<int32_t> spaceWanted_{0};
+
+  // DEEP BUFFER (power saving)
+  // The gate follows the ring fill instead of framesRequested_: refill
+  // until deepHighWater_ frames are queued, then park until the callback
+  // sees the fill drop below deepLowWater_ (0 = deep buffering off). The
+  // high water is capped below the ring capacity.
+  static constexpr int64_t kDeepBufferUs = 2500000;
+  static constexpr int64_t kDeepLowWaterUs = 500000;
+  std::atomic<bool> deepBuffer_{false};
+  std::atomic<int32_t> deepLowWater_{0};
+  // decode-thread owned
+  bool deepBufferApplied_ = false;
+  int32_t deepHighWater_ = 0;
+  bool refilling_ = false;
+
   // Note: We removed the wait-for-callback logic, so this might be debug-only
   // now
   std::atomic<bool> aaudioStarted_{false};
 
-  /* ───────── Ring Buffer (lock-free) ───────── */
-  static constexpr int32_t kRingBufferSize = 192000;
-  int16_t ringBuffer_[kRingBufferSize];
+  /* ───────── Control commands ───────── */
+  // Posted by any thread, drained by the decode thread at the top of each
+  // pass, so the codec and the demuxer are never touched from two threads.
+  // While no decode thread runs (before the first start(), after stop())
+  // the poster drains itself. draining_ keeps it to one consumer.
+  struct Command {
+    enum class Type : int32_t { Resume, Pause, Seek, Rate, Track };
+    Type type;
+    int64_t us; // Seek: target; Rate: playback rate * 1000; Track: index
+    int64_t postedUs; // monotonic time of the call (seek latency)
+    uint32_t seekId;  // Seek: Demuxer::seekUs id
+  };
+  static constexpr size_t kCommandCapacity = 64;
+  static constexpr int64_t kPostTimeoutUs = 100000;
+  MpscQueue<Command> commands_{kCommandCapacity};
+  Command commandBatch_[kCommandCapacity]; // draining_ holder
+  std::atomic<bool> draining_{false};
+
+  /* ───────── Async MediaCodec (API 28+) ───────── */
+  // Codec callbacks run on MediaCodec's looper thread. They feed input and
+  // push output into the ring directly while the gates are open; anything
+  // they cannot handle yet (paused, no demand, ring full) is parked here and
+  // drained by the decode thread once woken. asyncMutex_ serializes extractor
+  // reads and ring writes between the two threads (neither is realtime).
+  struct PendingOutput {
+    int32_t index;
+    AMediaCodecBufferInfo info;
+    int32_t writtenSamples;
+  };
+
+  // The sync loop parks an input index in pendingInputs_ as well when the
+  // demuxer has no packet for it yet.
+  bool preferAsyncDecode_ = true;
+  DecodeMode decodeMode_ = DecodeMode::Sync;
+  bool inputEos_ = false;
+  std::mutex asyncMutex_;
+  std::deque<int32_t> pendingInputs_;
+  std::deque<PendingOutput> pendingOutputs_;
+
+  // Set by whoever reads a packet of a newer demuxer serial; the decode
+  // thread flushes (applyDiscontinuity).
+  std::atomic<bool> discontinuityPending_{false};
+  std::atomic<uint32_t> discontinuitySerial_{0};
+
+  /* ───────── Audio-anchored clock ───────── */
+  // renderCallback publishes which stream frame carried which media time;
+  // the decode thread matches that against AAudioStream_getTimestamp and
+  // feeds VirtualClock::syncToAudio. flushGeneration_ separates segments
+  // (seek/stop/rate change); ringBasePtsUs_ is the PTS of the first sample
+  // written to the ring in the segment tagged by ptsGeneration_ and
+  // ringRateMilli_ the playback rate it was stretched for (one ring frame
+  // covers rate / sampleRate of media time).
+  struct AudioAnchor {
+    int64_t streamFrame;       // stream frame index of the callback start
+    int64_t mediaUs;           // media time of that frame
+    int64_t frames;            // real (non-silent) frames from there
+    int64_t segmentStartFrame; // first frame of the continuous run
+    uint32_t generation;
+    int32_t rateMilli; // playback rate of the segment, 1000 = 1x
+  };
+  static constexpr int64_t kTimestampPollUs = 50000;
+  Seqlock<AudioAnchor> anchor_;
+  std::atomic<uint32_t> flushGeneration_{0};
+  std::atomic<uint32_t> ptsGeneration_{~0u};
+  std::atomic<int64_t> ringBasePtsUs_{0};
+  std::atomic<int32_t> ringRateMilli_{1000};
+  // callback-owned
+  int64_t streamFramesWritten_ = 0;
+  int64_t renderedSinceFlush_ = 0;
+  int64_t segmentStartFrame_ = -1;
+  int64_t segmentBaseUs_ = 0; // media time of the segment's first frame
+  bool segmentBaseKnown_ = false;
+  int32_t segmentRateMilli_ = 1000;
+  uint32_t callbackGeneration_ = 0;
+  // decode-thread owned
+  int64_t lastTimestampPollUs_ = 0;
+
+  /* ───────── Realtime metrics ───────── */
+  // Fed into gAudioDebug's metrics by their owning thread. A decode-loop
+  // pass is timed from its top to the next one, minus the time parked.
+  static constexpr int64_t kStreamMetricsPollUs = 250000;
+  int64_t lastCallbackUs_ = 0; // callback-owned, 0 = none yet
+  // decode-thread owned
+  int64_t iterationStartUs_ = 0;
+  int64_t iterationParkedUs_ = 0;
+  int64_t lastStreamMetricsPollUs_ = 0;
+
+  /* ───────── Accurate seek ───────── */
+  // While seekTargetUs_ is set, output before it is released unplayed and
+  // the demand gate is bypassed: the ring stays empty and the decoder runs
+  // flat out until the target. seekStartUs_ is when decoding could start
+  // (seek, or the start() after a paused seek), for the latency stat.
+  static constexpr int64_t kNoSeekTarget = INT64_MIN;
+  std::atomic<bool> accurateSeek_{false};
+  std::atomic<int64_t> seekTargetUs_{kNoSeekTarget};
+  std::atomic<int64_t> seekStartUs_{0};
+  // Track switch: the target is where the clock had got to, and moves on
+  // with it while the new decoder starts (see samplesBeforeTarget).
+  std::atomic<bool> targetFollowsClock_{false};
+
+  /* Time-to-first-audio (first start() → first callback with real audio) */
+  std::atomic<int64_t> startRequestUs_{0};
+  std::atomic<bool> firstAudioRendered_{false};
+  std::atomic<int64_t> openRequestUs_{0}; // 0 = not measured
 
-  std::atomic<int32_t> writeHead_{0};
-  std::atomic<int32_t> readHead_{0};
+  /* ───────── Decoded history (rewind cache) ───────── */
+  // Everything the producer decodes goes into history_ first (stream
+  // layout/rate) and is pumped on into the ring from its cursor. A seek
+  // inside the history moves the cursor instead of flushing the codec, and
+  // the codec carries on decoding from the history's end. Producer side
+  // only (decode thread, or codec callback under asyncMutex_).
+  static constexpr int64_t kMinHistoryUs = 1000000; // staging when disabled
+  int64_t rewindCacheUs_ = 20000000;
+  size_t rewindCacheBytes_ = 16 << 20;
+  PcmHistory history_;
+  // The skip to seekTargetUs_ is an accurate seek (measured), not a resync
+  // of the decoder onto the history's end after a shared-demuxer seek.
+  std::atomic<bool> seekSkipMeasured_{false};
+  std::atomic<int64_t> discontinuityPtsUs_{0};
+
+  /* ───────── Gapless next item ───────── */
+  // prepareThread_ creates and starts the next decoder and feeds it its
+  // first kPrimePackets packets (in async mode the codec callbacks park its
+  // buffers in next_, told apart from the current decoder's by their codec
+  // argument). Once nextReady_ is set, the decode thread swaps it in when
+  // the current decoder has delivered end of stream and everything but the
+  // crossfade tail is in the ring (advanceItem). asyncMutex_ guards next_
+  // and the swap.
+  static constexpr int32_t kPrimePackets = 4;
+  static constexpr int64_t kPrimeTimeoutUs = 500000;
+  static constexpr int64_t kMaxCrossfadeUs = 500000;
+  static constexpr int64_t kNoItemEnd = INT64_MAX;
+  struct NextItem {
+    std::shared_ptr<Demuxer> demuxer;
+    int32_t track = -1;
+    uint32_t serial = 0;
+    AMediaCodec *codec = nullptr;
+    AMediaFormat *format = nullptr;
+    int64_t durationUs = 0;
+    int32_t queuedPackets = 0;
+    bool inputEos = false;
+    std::deque<int32_t> pendingInputs;
+    std::deque<PendingOutput> pendingOutputs;
+  };
+  NextItem next_;
+  std::thread prepareThread_;
+  std::atomic<bool> prepareCancel_{false};
+  // Prepare thread parks here while priming: the next demuxer's packets,
+  // the next decoder's input buffers and cancelNext() wake it.
+  WakeEvent prepareWake_;
+  std::atomic<bool> nextReady_{false};
+  int64_t prepareStartUs_ = 0;
+  // The current decoder delivered end of stream.
+  std::atomic<bool> itemEnded_{false};
+  // Audio from here on is encoder padding (kNoItemEnd: play to the end).
+  int64_t itemEndUs_ = kNoItemEnd;
+  // Outgoing decoder, released once the new item is audible so its
+  // teardown never delays the splice.
+  AMediaCodec *retiredCodec_ = nullptr;
+  CodecPool::Key retiredKey_;
+  std::shared_ptr<Demuxer> retiredDemuxer_;
+  int32_t retiredTrack_ = -1;
+  // Track switch (applyTrack): the new decoder while it starts, before it
+  // replaces codec_, and the input buffers it offers meanwhile.
+  AMediaCodec *switchCodec_ = nullptr;
+  std::deque<int32_t> switchInputs_;
+  // Crossfade: while an item is ready, the newest frames of this one stay
+  // in the history; at the transition they move to crossfadeTail_ and are
+  // mixed into the first frames of the next one. Producer side.
+  std::atomic<int64_t> crossfadeUs_{0};
+  std::vector<float> crossfadeTail_; // sized in setupAAudio
+  size_t crossfadeFrames_ = 0;
+  size_t crossfadePos_ = 0;
+  // Item boundary in the ring: the producer publishes the ring sample
+  // where the next item starts and its media time; renderCallback rebases
+  // its anchors there and reports when it rendered it.
+  bool boundaryPending_ = false; // producer
+  std::atomic<bool> boundarySet_{false};
+  std::atomic<size_t> boundarySample_{0};
+  std::atomic<int64_t> boundaryPtsUs_{0};
+  std::atomic<int64_t> boundaryRenderedUs_{0};
+  std::atomic<uint32_t> itemSerial_{0};
+
+  /* ───────── Ring Buffer (lock-free) ───────── */
+  // Interleaved float samples; power of two so the callback wraps with a
+  // mask.
+  static constexpr size_t kRingCapacity = 1 << 18;
+  SpscRing<float> ring_{kRingCapacity};
+  // SpscRing::reset() needs both sides gated, but the callback runs on
+  // through flushes that keep the clock going. It marks its ring access
+  // with ringReading_ and skips it while ringFlushing_ is set;
+  // flushRingBuffer sets that and waits for ringReading_ to clear (both
+  // seq_cst, so at least one side sees the other).
+  std::atomic<bool> ringFlushing_{false};
+  std::atomic<bool> ringReading_{false};
 
   /* Internal */
+  void post(Command::Type type, int64_t us = 0, uint32_t seekId = 0);
+  void drainCommands();
+  void applyResume();
+  void applyPause();
+  void applySeek(int64_t us, uint32_t seekId, int64_t postedUs);
+  void applyRate(int32_t rateMilli);
+  void applyTrack(int32_t track, int64_t postedUs);
+  int64_t nextRenderUs() const;
+
   bool setupAAudio();
   void cleanupAAudio();
   void cleanupMedia();
@@ -76,7 +461,50 @@ private:
 
   // Diagnostics / state (public accessor declared in public section)
 
+  bool configureCodec(const char *mime);
+  static AMediaCodecOnAsyncNotifyCallback asyncCallbacks();
+  static int64_t itemEndFor(AMediaFormat *format, int64_t durationUs);
+  void updateCodecOutputFormat(AMediaFormat *format);
+  void configureConversion();
+  bool queueInputFromDemuxer(size_t inIndex);
+  void flushCodec(uint32_t serial);
+  bool seekSkipping() const;
+  int32_t samplesBeforeTarget(int64_t ptsUs, int32_t count);
+  int32_t samplesBeforeEnd(int64_t ptsUs, int32_t count) const;
+  void applyDiscontinuity();
+  bool decodeGatesOpen() const;
+
   void decodeLoop();
+  void beginDecodeIteration();
+  void applyDeepBuffer();
+  bool wantsAudio();
+  void waitForWork(int64_t timeoutUs = -1);
+
+  void asyncDecodeLoop();
+  void feedInputsLocked();
+  void drainOutputsLocked();
+
+  void prepareNextItem(std::shared_ptr<Demuxer> demuxer, int32_t track);
+  void feedNextLocked();
+  bool queueNextInputLocked(int32_t index);
+  void releaseItem(NextItem &item);
+  bool advanceItem();
+  void pollItemBoundary();
+  void releaseRetired();
+  size_t heldTailFrames() const;
+  size_t historyBacklog() const;
+  void mixCrossfade(float *pcm, size_t frames);
+
+  static void onAsyncInputAvailable(AMediaCodec *codec, void *userData,
+                                    int32_t index);
+  static void onAsyncOutputAvailable(AMediaCodec *codec, void *userData,
+                                     int32_t index,
+                                     AMediaCodecBufferInfo *info);
+  static void onAsyncFormatChanged(AMediaCodec *codec, void *userData,
+                                   AMediaFormat *format);
+  static void onAsyncError(AMediaCodec *codec, void *userData,
+                           media_status_t error, int32_t actionCode,
+                           const char *detail);
 
   // These helpers seem legacy or debug, keeping them if you use them internally
 
@@ -85,14 +513,25 @@ private:
   int readPcm(int16_t *out, int frames);
 
   /* ───────── Helpers ───────── */
-  bool writeAudio(const int16_t *data, int32_t samples);
-  void renderAudio(int16_t *out, int32_t samples);
+  int32_t writeAudio(const uint8_t *data, int32_t samples, int64_t ptsUs);
+  int32_t writeStaged(const uint8_t *data, int32_t samples, int64_t ptsUs);
+  void pumpHistory();
+  size_t stretchToRing(const float *pcm, size_t frames);
+  void writeRing(const float *pcm, size_t frames);
+  int64_t ringFramesUs(int64_t frames, int32_t rateMilli) const;
+  void clearHistoryLocked();
+  int32_t ringSamplesFor(int32_t codecSamples) const;
+  int64_t samplePtsUs(int64_t bufferPtsUs, int32_t offsetSamples) const;
+  size_t renderAudio(void *out, int32_t samples);
   void flushRingBuffer();
+  void trackPresentation(int32_t numFrames, int32_t gotFrames);
+  void publishAnchor(int64_t streamFrame, int32_t frames);
+  void pollAudioTimestamp();
+  void pollStreamMetrics();
+  int64_t noteRingFill();
 
   int32_t framesToSamples(int32_t frames) const;
 
-  static aaudio_data_callback_result_t dataCallback(AAudioStream *stream,
-                                                    void *userData,
-                                                    void *audioData,
-                                                    int32_t numFrames);
+  static void renderCallback(void *userData, void *audioData,
+                             int32_t numFrames, int64_t framePosition);
 };
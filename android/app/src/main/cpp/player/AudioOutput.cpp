@@ -0,0 +1,383 @@
+#include "AudioOutput.h"
+#include "AudioDebug.h"
+#include "VirtualClock.h"
+
+#include <android/log.h>
+#include <chrono>
+#include <cstring>
+
+#define LOG_TAG "AudioOutput"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+extern AudioDebug gAudioDebug;
+
+/* ===================== Session ===================== */
+
+AudioOutput &AudioOutput::instance() {
+  static AudioOutput output;
+  return output;
+}
+
+AudioOutput::~AudioOutput() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  idleCv_.notify_all();
+  if (idleThread_.joinable())
+    idleThread_.join();
+  std::lock_guard<std::mutex> lock(mutex_);
+  closeStreamLocked();
+}
+
+AAudioStream *AudioOutput::acquire(const Sink *sink, int32_t channelCount) {
+  int64_t startUs = VirtualClock::nowUs();
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  // One engine at a time: a previous owner still attached loses the stream.
+  if (owner_ && owner_ != sink) {
+    lock.unlock();
+    release(owner_);
+    lock.lock();
+  }
+
+  bool reused = stream_ && canServe(channelCount);
+  if (!reused) {
+    closeStreamLocked();
+    if (openLocked(channelCount) != AAUDIO_OK)
+      return nullptr;
+  } else {
+    gAudioDebug.outputReuses.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  owner_ = sink;
+  idleSinceUs_ = 0;
+
+  int64_t elapsedUs = VirtualClock::nowUs() - startUs;
+  gAudioDebug.outputAcquireUs.store(elapsedUs, std::memory_order_relaxed);
+  gAudioDebug.outputReused.store(reused, std::memory_order_relaxed);
+  LOGD("Output %s in %lld us (%d Hz, %d ch for %d ch audio)",
+       reused ? "reused" : "opened", static_cast<long long>(elapsedUs),
+       AAudioStream_getSampleRate(stream_),
+       AAudioStream_getChannelCount(stream_), channelCount);
+  return stream_;
+}
+
+void AudioOutput::attach(const Sink *sink) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (sink && owner_ == sink)
+    sink_.store(sink, std::memory_order_seq_cst);
+}
+
+void AudioOutput::release(const Sink *sink) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!sink || owner_ != sink)
+    return;
+  owner_ = nullptr;
+
+  // Pairs with dataCallback: either the callback sees the null sink, or
+  // this sees it busy and waits until it is out of the old sink.
+  sink_.store(nullptr, std::memory_order_seq_cst);
+  while (inCallback_.load(std::memory_order_seq_cst)) {
+    std::this_thread::yield();
+  }
+
+  markIdleLocked();
+}
+
+bool AudioOutput::start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return startLocked();
+}
+
+void AudioOutput::prewarm(int32_t channelCount) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stream_)
+    return;
+  int64_t startUs = VirtualClock::nowUs();
+  if (openLocked(channelCount) != AAUDIO_OK)
+    return;
+  startLocked();
+  markIdleLocked();
+  LOGD("Output prewarmed in %lld us",
+       static_cast<long long>(VirtualClock::nowUs() - startUs));
+}
+
+void AudioOutput::setMode(Mode mode) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  mode_ = mode;
+}
+
+int32_t AudioOutput::tuneBuffer() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!stream_)
+    return -1;
+  int32_t xruns = AAudioStream_getXRunCount(stream_);
+  if (!tuning_ || xruns < 0)
+    return xruns;
+
+  int64_t now = VirtualClock::nowUs();
+  int32_t size = AAudioStream_getBufferSizeInFrames(stream_);
+  if (xruns > lastXRuns_) {
+    // Glitched: one burst more of headroom.
+    lastXRuns_ = xruns;
+    if (size + burstFrames_ <= AAudioStream_getBufferCapacityInFrames(stream_))
+      setBufferFramesLocked(size + burstFrames_);
+    lastBufferChangeUs_ = now;
+  } else if (now - lastBufferChangeUs_ >= kShrinkAfterUs &&
+             size - burstFrames_ >= kMinBursts * burstFrames_) {
+    // Stable for a while: try one burst less.
+    setBufferFramesLocked(size - burstFrames_);
+    lastBufferChangeUs_ = now;
+  }
+  return xruns;
+}
+
+int64_t AudioOutput::bufferLatencyUs() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!stream_)
+    return 0;
+  return static_cast<int64_t>(AAudioStream_getBufferSizeInFrames(stream_)) *
+         1000000 / AAudioStream_getSampleRate(stream_);
+}
+
+/* ===================== Stream ===================== */
+
+aaudio_result_t AudioOutput::openLocked(int32_t channelCount) {
+  // Low latency: exclusive (MMAP) first, then a shared low-latency stream.
+  // Power saving: a shared power-saving stream. Every mode ends on the
+  // default stream every device opens.
+  struct Attempt {
+    aaudio_sharing_mode_t sharing;
+    aaudio_performance_mode_t performance;
+  };
+  static constexpr Attempt kLowLatency[] = {
+      {AAUDIO_SHARING_MODE_EXCLUSIVE, AAUDIO_PERFORMANCE_MODE_LOW_LATENCY},
+      {AAUDIO_SHARING_MODE_SHARED, AAUDIO_PERFORMANCE_MODE_LOW_LATENCY},
+      {AAUDIO_SHARING_MODE_SHARED, AAUDIO_PERFORMANCE_MODE_NONE}};
+  static constexpr Attempt kPowerSaving[] = {
+      {AAUDIO_SHARING_MODE_SHARED, AAUDIO_PERFORMANCE_MODE_POWER_SAVING},
+      {AAUDIO_SHARING_MODE_SHARED, AAUDIO_PERFORMANCE_MODE_NONE}};
+  static constexpr Attempt kDefault[] = {
+      {AAUDIO_SHARING_MODE_SHARED, AAUDIO_PERFORMANCE_MODE_NONE}};
+  const Attempt *modes = kDefault;
+  size_t modeCount = 1;
+  if (mode_ == Mode::LowLatency) {
+    modes = kLowLatency;
+    modeCount = 3;
+  } else if (mode_ == Mode::PowerSaving) {
+    modes = kPowerSaving;
+    modeCount = 2;
+  }
+
+  // Float end to end: the ring is float, so a float stream needs no
+  // conversion and keeps hi-res sources intact. 16-bit is the fallback for
+  // streams that refuse float; the engine then converts with dither.
+  aaudio_result_t result = AAUDIO_ERROR_BASE;
+  for (size_t i = 0; i < modeCount && result != AAUDIO_OK; ++i) {
+    result = openStream(AAUDIO_FORMAT_PCM_FLOAT, channelCount,
+                        modes[i].sharing, modes[i].performance);
+    if (result != AAUDIO_OK)
+      result = openStream(AAUDIO_FORMAT_PCM_I16, channelCount,
+                          modes[i].sharing, modes[i].performance);
+  }
+  if (result != AAUDIO_OK) {
+    gAudioDebug.aaudioError.store(result);
+    return result;
+  }
+  requestedChannels_ = channelCount;
+  streamMode_ = mode_;
+  gAudioDebug.outputOpens.fetch_add(1, std::memory_order_relaxed);
+
+  // What the device granted (a request is not an error when refused).
+  bool exclusive =
+      AAudioStream_getSharingMode(stream_) == AAUDIO_SHARING_MODE_EXCLUSIVE;
+  aaudio_performance_mode_t performance =
+      AAudioStream_getPerformanceMode(stream_);
+  bool granted = performance == AAUDIO_PERFORMANCE_MODE_LOW_LATENCY;
+  gAudioDebug.outputExclusive.store(exclusive, std::memory_order_relaxed);
+  gAudioDebug.outputPerformanceMode.store(performance,
+                                          std::memory_order_relaxed);
+
+  burstFrames_ = AAudioStream_getFramesPerBurst(stream_);
+  lastXRuns_ = 0;
+  lastBufferChangeUs_ = VirtualClock::nowUs();
+  tuning_ = streamMode_ == Mode::LowLatency && granted && burstFrames_ > 0;
+  if (tuning_) {
+    setBufferFramesLocked(kMinBursts * burstFrames_);
+  } else if (streamMode_ == Mode::PowerSaving) {
+    setBufferFramesLocked(AAudioStream_getBufferCapacityInFrames(stream_));
+  } else {
+    gAudioDebug.outputBufferFrames.store(
+        AAudioStream_getBufferSizeInFrames(stream_),
+        std::memory_order_relaxed);
+  }
+  gAudioDebug.outputBurstFrames.store(burstFrames_, std::memory_order_relaxed);
+  LOGD("Output opened: %s, performance mode %d, burst %d, buffer %d frames",
+       exclusive ? "exclusive" : "shared", performance, burstFrames_,
+       AAudioStream_getBufferSizeInFrames(stream_));
+  return AAUDIO_OK;
+}
+
+// AAudio may round the size; what it actually set is published.
+void AudioOutput::setBufferFramesLocked(int32_t frames) {
+  aaudio_result_t result = AAudioStream_setBufferSizeInFrames(stream_, frames);
+  if (result < 0) {
+    LOGE("AAudio setBufferSizeInFrames(%d) failed: %s", frames,
+         AAudio_convertResultToText(result));
+    return;
+  }
+  gAudioDebug.outputBufferFrames.store(result, std::memory_order_relaxed);
+}
+
+aaudio_result_t AudioOutput::openStream(aaudio_format_t format,
+                                        int32_t channelCount,
+                                        aaudio_sharing_mode_t sharing,
+                                        aaudio_performance_mode_t performance) {
+  AAudioStreamBuilder *builder = nullptr;
+  aaudio_result_t result = AAudio_createStreamBuilder(&builder);
+
+  if (result != AAUDIO_OK) {
+    LOGE("AAudio createStreamBuilder failed: %s",
+         AAudio_convertResultToText(result));
+    return result;
+  }
+
+  AAudioStreamBuilder_setFormat(builder, format);
+  // The sample rate is left unspecified so AAudio picks the device's native
+  // rate (no framework resampler); the engine's resampler bridges the
+  // difference.
+  AAudioStreamBuilder_setChannelCount(builder, channelCount);
+
+  AAudioStreamBuilder_setSharingMode(builder, sharing);
+
+  // Explicit direction is required on some OEM ROMs (MIUI/ColorOS) where
+  // implicit direction can cause the stream to hang and the callback to never
+  // fire.
+  AAudioStreamBuilder_setDirection(builder, AAUDIO_DIRECTION_OUTPUT);
+
+  AAudioStreamBuilder_setPerformanceMode(builder, performance);
+  // Long periods need a big buffer to cycle through.
+  if (performance == AAUDIO_PERFORMANCE_MODE_POWER_SAVING) {
+    AAudioStreamBuilder_setBufferCapacityInFrames(builder,
+                                                  kPowerSavingCapacityFrames);
+  }
+
+  AAudioStreamBuilder_setDataCallback(builder, AudioOutput::dataCallback,
+                                      this);
+
+  result = AAudioStreamBuilder_openStream(builder, &stream_);
+  AAudioStreamBuilder_delete(builder);
+
+  if (result != AAUDIO_OK || !stream_) {
+    LOGE("AAudio open (format %d) failed: %s", format,
+         AAudio_convertResultToText(result));
+    stream_ = nullptr;
+    return result != AAUDIO_OK ? result : AAUDIO_ERROR_BASE;
+  }
+
+  int32_t bytesPerSample = 2;
+  switch (AAudioStream_getFormat(stream_)) {
+  case AAUDIO_FORMAT_PCM_FLOAT:
+  case AAUDIO_FORMAT_PCM_I32:
+    bytesPerSample = 4;
+    break;
+  case AAUDIO_FORMAT_PCM_I24_PACKED:
+    bytesPerSample = 3;
+    break;
+  default:
+    break;
+  }
+  bytesPerFrame_ = AAudioStream_getChannelCount(stream_) * bytesPerSample;
+  framePosition_ = 0;
+  started_ = false;
+  return AAUDIO_OK;
+}
+
+// The engine's mixer maps any 1..8 channel layout onto the stream's and its
+// resampler handles any rate, so only more channels than the stream has are
+// worth a reopen -- and only if the device granted what was asked last time
+// (one that handed out fewer will not hand out more). A change of latency
+// mode reopens too.
+bool AudioOutput::canServe(int32_t channelCount) const {
+  if (AAudioStream_getState(stream_) == AAUDIO_STREAM_STATE_DISCONNECTED ||
+      streamMode_ != mode_)
+    return false;
+  int32_t streamChannels = AAudioStream_getChannelCount(stream_);
+  return channelCount <= streamChannels || streamChannels < requestedChannels_;
+}
+
+void AudioOutput::closeStreamLocked() {
+  if (!stream_)
+    return;
+  // Never attached here: release() or acquire() took the stream back.
+  AAudioStream_close(stream_);
+  stream_ = nullptr;
+  started_ = false;
+  idleSinceUs_ = 0;
+}
+
+bool AudioOutput::startLocked() {
+  if (!stream_)
+    return false;
+  if (started_)
+    return true;
+  aaudio_result_t r = AAudioStream_requestStart(stream_);
+  if (r != AAUDIO_OK) {
+    LOGE("AAudio start failed: %s", AAudio_convertResultToText(r));
+    return false;
+  }
+  started_ = true;
+  return true;
+}
+
+// Nobody holds the stream: arm the idle close.
+void AudioOutput::markIdleLocked() {
+  if (!stream_)
+    return;
+  idleSinceUs_ = VirtualClock::nowUs();
+  if (!idleThread_.joinable())
+    idleThread_ = std::thread(&AudioOutput::idleLoop, this);
+  idleCv_.notify_all();
+}
+
+// Closes the stream once it has gone unused for kIdleCloseUs.
+void AudioOutput::idleLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!quit_) {
+    if (idleSinceUs_ == 0) {
+      idleCv_.wait(lock);
+      continue;
+    }
+    int64_t remainingUs = idleSinceUs_ + kIdleCloseUs - VirtualClock::nowUs();
+    if (remainingUs > 0) {
+      idleCv_.wait_for(lock, std::chrono::microseconds(remainingUs));
+      continue;
+    }
+    LOGD("Output idle for %lld ms, closing",
+         static_cast<long long>(kIdleCloseUs / 1000));
+    closeStreamLocked();
+  }
+}
+
+/* ===================== AAudio Callback ===================== */
+
+aaudio_data_callback_result_t AudioOutput::dataCallback(AAudioStream *,
+                                                        void *userData,
+                                                        void *audioData,
+                                                        int32_t numFrames) {
+  auto *self = static_cast<AudioOutput *>(userData);
+
+  self->inCallback_.store(true, std::memory_order_seq_cst);
+  const Sink *sink = self->sink_.load(std::memory_order_seq_cst);
+  if (sink) {
+    sink->render(sink->userData, audioData, numFrames, self->framePosition_);
+  } else {
+    memset(audioData, 0, static_cast<size_t>(numFrames) * self->bytesPerFrame_);
+  }
+  self->inCallback_.store(false, std::memory_order_release);
+
+  self->framePosition_ += numFrames;
+  return AAUDIO_CALLBACK_RESULT_CONTINUE;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <aaudio/AAudio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/*
+ * Process-wide AAudio output session.
+ *
+ * Opening and starting an AAudio stream costs tens of milliseconds (more on
+ * Bluetooth routes), and every file switch used to pay it because each
+ * AudioEngine owned its stream. The session keeps one stream open and
+ * running across engines and lends it to whichever engine is current:
+ * acquire() hands it over, attach() starts rendering into the engine's
+ * Sink and release() takes it back. Without an attached sink the stream
+ * plays silence.
+ *
+ * The stream is only reopened when it cannot serve the next item through
+ * the engine's own conversion: the device disconnected it, or the item has
+ * more channels than the stream and the device never refused that many.
+ * Sample rate never forces a reopen (the stream runs at the device rate and
+ * the engine resamples). With no sink attached for kIdleCloseUs the stream
+ * is closed, so leaving the player does not keep the audio path awake.
+ *
+ * Low-latency mode asks for an EXCLUSIVE + LOW_LATENCY stream, falling back
+ * to a shared low-latency one and then to the default stream. A stream
+ * granted LOW_LATENCY starts with a kMinBursts-burst buffer that
+ * tuneBuffer() adapts at runtime: one burst more whenever the stream's xrun
+ * count rose, one burst less after kShrinkAfterUs without one.
+ *
+ * Power-saving mode asks for a POWER_SAVING stream with a
+ * kPowerSavingCapacityFrames buffer, used in full: the device can then run
+ * its deep-buffer path with long periods (fewer callbacks, longer sleeps).
+ */
+class AudioOutput {
+public:
+  // Render callback of the attached engine. `framePosition` is the stream
+  // frame index of the first frame of `audioData` (the base of
+  // AAudioStream_getTimestamp positions).
+  using RenderFn = void (*)(void *userData, void *audioData, int32_t numFrames,
+                            int64_t framePosition);
+  struct Sink {
+    RenderFn render;
+    void *userData;
+  };
+
+  static constexpr int64_t kIdleCloseUs = 5000000;
+  static constexpr int32_t kMinBursts = 2;
+  static constexpr int64_t kShrinkAfterUs = 10000000;
+  static constexpr int32_t kPowerSavingCapacityFrames = 16384;
+
+  enum class Mode : int32_t { Default = 0, LowLatency = 1, PowerSaving = 2 };
+
+  static AudioOutput &instance();
+
+  ~AudioOutput();
+  AudioOutput(const AudioOutput &) = delete;
+  AudioOutput &operator=(const AudioOutput &) = delete;
+
+  // Hands the stream to `sink`, (re)opened for `channelCount`-channel audio
+  // only when the open one cannot serve it. Null if no stream could be
+  // opened. The stream renders silence until attach().
+  AAudioStream *acquire(const Sink *sink, int32_t channelCount);
+  // Starts rendering into `sink` (once it is set up for the stream's
+  // format). Ignored unless `sink` holds the stream.
+  void attach(const Sink *sink);
+  // Gives the stream back. Returns once no callback is still rendering into
+  // `sink`. The stream keeps running.
+  void release(const Sink *sink);
+  // Starts the stream; no-op when it already runs.
+  bool start();
+  // Opens and starts a stream ahead of acquire() (while a file is still
+  // being parsed) unless one is open already. Closed again after
+  // kIdleCloseUs if nobody acquires it.
+  void prewarm(int32_t channelCount);
+  // Mode of streams opened from now on; an open stream of another mode is
+  // reopened at the next acquire().
+  void setMode(Mode mode);
+  // Polled from a non-realtime thread while playing: adapts the buffer of a
+  // low-latency stream to its xrun count. Returns that count (-1 = no
+  // stream).
+  int32_t tuneBuffer();
+  // Device buffer of the open stream in us (0 = none): the latency the
+  // session adds when no timestamp measures it.
+  int64_t bufferLatencyUs();
+
+private:
+  AudioOutput() = default;
+
+  aaudio_result_t openLocked(int32_t channelCount);
+  aaudio_result_t openStream(aaudio_format_t format, int32_t channelCount,
+                             aaudio_sharing_mode_t sharing,
+                             aaudio_performance_mode_t performance);
+  void setBufferFramesLocked(int32_t frames);
+  bool canServe(int32_t channelCount) const;
+  void closeStreamLocked();
+  bool startLocked();
+  void markIdleLocked();
+  void idleLoop();
+
+  static aaudio_data_callback_result_t dataCallback(AAudioStream *stream,
+                                                    void *userData,
+                                                    void *audioData,
+                                                    int32_t numFrames);
+
+  std::mutex mutex_; // everything below except the callback-side atomics
+  AAudioStream *stream_ = nullptr;
+  int32_t requestedChannels_ = 0; // asked for on the last open
+  int32_t bytesPerFrame_ = 0;
+  bool started_ = false;
+  const Sink *owner_ = nullptr; // holder of the stream
+  Mode mode_ = Mode::Default;       // wanted for the next open
+  Mode streamMode_ = Mode::Default; // wanted when the open stream was opened
+
+  // Buffer tuning of a stream granted LOW_LATENCY
+  bool tuning_ = false;
+  int32_t burstFrames_ = 0;
+  int32_t lastXRuns_ = 0;
+  int64_t lastBufferChangeUs_ = 0;
+
+  // Callback side: the sink rendered into and a busy flag for release().
+  std::atomic<const Sink *> sink_{nullptr};
+  std::atomic<bool> inCallback_{false};
+  int64_t framePosition_ = 0; // callback-owned, reset on open
+
+  // Idle close
+  std::condition_variable idleCv_;
+  std::thread idleThread_;
+  int64_t idleSinceUs_ = 0; // 0 = in use (or nothing open)
+  bool quit_ = false;
+};
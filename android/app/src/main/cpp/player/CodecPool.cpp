@@ -0,0 +1,158 @@
+#include "CodecPool.h"
+#include "AudioDebug.h"
+#include "NdkCompat.h"
+#include "VirtualClock.h"
+
+#include <algorithm>
+#include <android/log.h>
+
+#define LOG_TAG "CodecPool"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+extern AudioDebug gAudioDebug;
+
+// Installed on parked async decoders so a late notification never reaches
+// the engine that released them.
+static void parkedInput(AMediaCodec *, void *, int32_t) {}
+static void parkedOutput(AMediaCodec *, void *, int32_t,
+                         AMediaCodecBufferInfo *) {}
+static void parkedFormat(AMediaCodec *, void *, AMediaFormat *) {}
+static void parkedError(AMediaCodec *, void *, media_status_t, int32_t,
+                        const char *) {}
+
+/* ===================== Pool ===================== */
+
+CodecPool &CodecPool::instance() {
+  static CodecPool pool;
+  return pool;
+}
+
+CodecPool::Key CodecPool::keyFor(AMediaFormat *format) {
+  Key key;
+  const char *mime = nullptr;
+  if (format && AMediaFormat_getString(format, AMEDIAFORMAT_KEY_MIME, &mime) &&
+      mime) {
+    key.mime = mime;
+  }
+  if (format) {
+    AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_SAMPLE_RATE,
+                          &key.sampleRate);
+    AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_CHANNEL_COUNT,
+                          &key.channels);
+  }
+  return key;
+}
+
+CodecPool::~CodecPool() {
+  if (prewarmThread_.joinable())
+    prewarmThread_.join();
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Entry &entry : idle_)
+    AMediaCodec_delete(entry.codec);
+  idle_.clear();
+}
+
+AMediaCodec *CodecPool::acquire(const Key &key, bool async) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    evictLocked(VirtualClock::nowUs());
+
+    // Newest first: same format, then any format of the MIME type. A
+    // decoder with a notify callback installed only suits async users.
+    auto usable = [&](const Entry &e) {
+      return e.key.mime == key.mime && (async || !e.async);
+    };
+    auto pick = idle_.rend();
+    for (auto it = idle_.rbegin(); it != idle_.rend(); ++it) {
+      if (!usable(*it))
+        continue;
+      if (it->key.sampleRate == key.sampleRate &&
+          it->key.channels == key.channels) {
+        pick = it;
+        break;
+      }
+      if (pick == idle_.rend())
+        pick = it;
+    }
+    if (pick != idle_.rend()) {
+      AMediaCodec *codec = pick->codec;
+      idle_.erase(std::next(pick).base());
+      gAudioDebug.codecPoolHits.fetch_add(1, std::memory_order_relaxed);
+      publishStatsLocked();
+      return codec;
+    }
+  }
+
+  gAudioDebug.codecPoolMisses.fetch_add(1, std::memory_order_relaxed);
+  return key.mime.empty() ? nullptr
+                          : AMediaCodec_createDecoderByType(key.mime.c_str());
+}
+
+void CodecPool::recycle(AMediaCodec *codec, const Key &key, bool async) {
+  if (!codec)
+    return;
+  // Stopped is the only state a decoder can be reconfigured from. A
+  // decoder that does not stop cleanly is not trusted again.
+  if (AMediaCodec_stop(codec) != AMEDIA_OK || key.mime.empty()) {
+    AMediaCodec_delete(codec);
+    return;
+  }
+  if (async) {
+    auto setAsyncCallback = ndkcompat::mediaCodecSetAsyncNotifyCallback();
+    AMediaCodecOnAsyncNotifyCallback parked{};
+    parked.onAsyncInputAvailable = parkedInput;
+    parked.onAsyncOutputAvailable = parkedOutput;
+    parked.onAsyncFormatChanged = parkedFormat;
+    parked.onAsyncError = parkedError;
+    if (!setAsyncCallback ||
+        setAsyncCallback(codec, parked, nullptr) != AMEDIA_OK) {
+      AMediaCodec_delete(codec);
+      return;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  parkLocked(Entry{codec, key, async, VirtualClock::nowUs()});
+}
+
+void CodecPool::prewarm(std::vector<std::string> mimes) {
+  if (prewarmThread_.joinable())
+    return; // once per process
+  prewarmThread_ = std::thread([this, mimes = std::move(mimes)] {
+    for (const std::string &mime : mimes) {
+      int64_t startUs = VirtualClock::nowUs();
+      AMediaCodec *codec = AMediaCodec_createDecoderByType(mime.c_str());
+      if (!codec) {
+        LOGE("Prewarm: no decoder for %s", mime.c_str());
+        continue;
+      }
+      LOGD("Prewarmed %s in %lld us", mime.c_str(),
+           static_cast<long long>(VirtualClock::nowUs() - startUs));
+      Key key;
+      key.mime = mime;
+      std::lock_guard<std::mutex> lock(mutex_);
+      parkLocked(Entry{codec, key, false, VirtualClock::nowUs()});
+    }
+  });
+}
+
+void CodecPool::parkLocked(Entry entry) {
+  idle_.push_back(std::move(entry));
+  evictLocked(VirtualClock::nowUs());
+  publishStatsLocked();
+}
+
+void CodecPool::evictLocked(int64_t nowUs) {
+  size_t evict = idle_.size() > kMaxIdle ? idle_.size() - kMaxIdle : 0;
+  while (evict < idle_.size() && nowUs - idle_[evict].idleSinceUs > kMaxIdleUs)
+    ++evict;
+  for (size_t i = 0; i < evict; ++i)
+    AMediaCodec_delete(idle_[i].codec);
+  idle_.erase(idle_.begin(), idle_.begin() + static_cast<ptrdiff_t>(evict));
+}
+
+void CodecPool::publishStatsLocked() {
+  gAudioDebug.codecPoolIdle.store(static_cast<int>(idle_.size()),
+                                  std::memory_order_relaxed);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <media/NdkMediaCodec.h>
+#include <media/NdkMediaFormat.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Process-wide pool of idle audio decoders.
+ *
+ * AMediaCodec_createDecoderByType instantiates a codec component, the
+ * slowest step of an open, and consecutive files mostly use the same
+ * decoder. Released decoders are stopped (back to the Uninitialized state,
+ * component kept) and parked here; an open of the same MIME type takes one
+ * back and only configures and starts it with its own format.
+ *
+ * Matching prefers the same sample rate and channel count, then any
+ * decoder of the MIME type (configure() accepts any format the component
+ * supports). A decoder that was used in async mode keeps a notify callback
+ * installed (a parked no-op one), so it only goes to async users.
+ *
+ * Eviction: at most kMaxIdle decoders, least recently parked first, and
+ * none older than kMaxIdleUs (checked whenever the pool is used).
+ */
+class CodecPool {
+public:
+  struct Key {
+    std::string mime;
+    int32_t sampleRate = 0; // 0 = unknown (prewarmed)
+    int32_t channels = 0;
+  };
+
+  static constexpr size_t kMaxIdle = 4;
+  static constexpr int64_t kMaxIdleUs = 120000000;
+
+  static CodecPool &instance();
+  static Key keyFor(AMediaFormat *format);
+
+  ~CodecPool();
+  CodecPool(const CodecPool &) = delete;
+  CodecPool &operator=(const CodecPool &) = delete;
+
+  // An Uninitialized decoder for `key`, ready for the async callback (when
+  // `async`), configure and start: a pooled one or a new one. Null if none
+  // can be created.
+  AMediaCodec *acquire(const Key &key, bool async);
+  // Stops `codec` and parks it for reuse; it was configured for `key`
+  // (async: with a notify callback). Deletes it when it cannot be reused.
+  void recycle(AMediaCodec *codec, const Key &key, bool async);
+  // Creates idle decoders for `mimes` on a background thread.
+  void prewarm(std::vector<std::string> mimes);
+
+private:
+  CodecPool() = default;
+
+  struct Entry {
+    AMediaCodec *codec;
+    Key key;
+    bool async;
+    int64_t idleSinceUs;
+  };
+
+  void parkLocked(Entry entry);
+  void evictLocked(int64_t nowUs);
+  void publishStatsLocked();
+
+  std::mutex mutex_;
+  std::vector<Entry> idle_; // oldest first
+  std::thread prewarmThread_;
+};
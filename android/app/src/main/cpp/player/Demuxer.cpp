@@ -0,0 +1,468 @@
+#include "Demuxer.h"
+#include "NdkCompat.h"
+#include "VirtualClock.h"
+
+#include <algorithm>
+#include <android/log.h>
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_TAG "Demuxer"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+/* ===================== Open ===================== */
+
+Demuxer::~Demuxer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  readerCv_.notify_all();
+  if (reader_.joinable())
+    reader_.join();
+
+  if (extractor_)
+    AMediaExtractor_delete(extractor_);
+  if (fd_ >= 0)
+    close(fd_);
+}
+
+bool Demuxer::openFd(int fd, int64_t offset, int64_t length) {
+  int64_t startUs = VirtualClock::nowUs();
+
+  // Own duplicate: the Java side closes its descriptor whenever it likes.
+  fd_ = dup(fd);
+  if (fd_ < 0)
+    return false;
+  offset_ = offset;
+
+  // Some Java callers advance the shared file offset, which breaks native
+  // extraction on a dup of it.
+  lseek(fd_, 0, SEEK_SET);
+
+  // AMediaExtractor_setDataSourceFd does not accept length = -1.
+  if (length < 0) {
+    struct stat st{};
+    if (fstat(fd_, &st) != 0) {
+      LOGE("fstat failed");
+      return false;
+    }
+    length = st.st_size - offset;
+  }
+
+  extractor_ = AMediaExtractor_new();
+  if (!extractor_ ||
+      AMediaExtractor_setDataSourceFd(extractor_, fd_, offset, length) !=
+          AMEDIA_OK) {
+    LOGE("Extractor setDataSourceFd FAILED");
+    return false;
+  }
+  if (!openExtractor())
+    return false;
+  openUs_ = VirtualClock::nowUs() - startUs;
+  return true;
+}
+
+bool Demuxer::openPath(const char *path) {
+  int64_t startUs = VirtualClock::nowUs();
+  extractor_ = AMediaExtractor_new();
+  if (!extractor_ ||
+      AMediaExtractor_setDataSource(extractor_, path) != AMEDIA_OK) {
+    LOGE("Extractor setDataSource FAILED");
+    return false;
+  }
+  if (!openExtractor())
+    return false;
+  openUs_ = VirtualClock::nowUs() - startUs;
+  return true;
+}
+
+// Lists tracks, selects the first audio and the first video track and
+// starts the reader.
+bool Demuxer::openExtractor() {
+  size_t count = AMediaExtractor_getTrackCount(extractor_);
+  tracks_.resize(count);
+
+  bool haveAudio = false;
+  bool haveVideo = false;
+  for (size_t i = 0; i < count; ++i) {
+    AMediaFormat *fmt = AMediaExtractor_getTrackFormat(extractor_, i);
+    const char *mime = nullptr;
+    if (AMediaFormat_getString(fmt, AMEDIAFORMAT_KEY_MIME, &mime) && mime)
+      tracks_[i].mime = mime;
+    int64_t duration = 0;
+    if (AMediaFormat_getInt64(fmt, AMEDIAFORMAT_KEY_DURATION, &duration))
+      durationUs_ = std::max(durationUs_, duration);
+    AMediaFormat_delete(fmt);
+
+    bool select = false;
+    if (!haveAudio && !tracks_[i].mime.compare(0, 6, "audio/")) {
+      haveAudio = select = true;
+    } else if (!haveVideo && !tracks_[i].mime.compare(0, 6, "video/")) {
+      haveVideo = select = true;
+    }
+    if (select) {
+      AMediaExtractor_selectTrack(extractor_, i);
+      tracks_[i].selected = true;
+    }
+  }
+
+  if (!haveAudio && !haveVideo) {
+    LOGE("No audio or video track");
+    return false;
+  }
+
+  scratch_.resize(kMinScratchBytes);
+  running_ = true;
+  reader_ = std::thread(&Demuxer::readerLoop, this);
+  LOGD("Opened %zu tracks (audio=%d video=%d)", count, haveAudio, haveVideo);
+  return true;
+}
+
+bool Demuxer::isSameSource(int fd, int64_t offset) const {
+  if (fd_ < 0 || offset != offset_)
+    return false;
+  struct stat a{};
+  struct stat b{};
+  return fstat(fd_, &a) == 0 && fstat(fd, &b) == 0 && a.st_dev == b.st_dev &&
+         a.st_ino == b.st_ino;
+}
+
+int32_t Demuxer::findTrack(const char *mimePrefix) const {
+  size_t n = strlen(mimePrefix);
+  for (size_t i = 0; i < tracks_.size(); ++i) {
+    if (tracks_[i].selected && !tracks_[i].mime.compare(0, n, mimePrefix))
+      return static_cast<int32_t>(i);
+  }
+  return -1;
+}
+
+AMediaFormat *Demuxer::trackFormat(int32_t track) {
+  std::lock_guard<std::mutex> io(extractorMutex_);
+  return AMediaExtractor_getTrackFormat(extractor_, track);
+}
+
+/* ===================== Consumers ===================== */
+
+uint32_t Demuxer::attach(int32_t track, WakeEvent *wake) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Track &t = tracks_[track];
+  t.attached = true;
+  t.wake = wake;
+  readerCv_.notify_one();
+  return serial_;
+}
+
+void Demuxer::detach(int32_t track) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Track &t = tracks_[track];
+  t.attached = false;
+  t.wake = nullptr;
+  readerCv_.notify_one();
+}
+
+bool Demuxer::canStartAt(int32_t track, int64_t us) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const Track &t = tracks_[track];
+  if (t.packets.empty())
+    return false;
+  const Packet &p = t.packets.front();
+  return p.sync && !p.eos && p.serial == serial_ && p.ptsUs <= us;
+}
+
+uint32_t Demuxer::seekUs(int64_t us, uint32_t seekId) {
+  std::lock_guard<std::mutex> io(extractorMutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // The other decoder's half of the same user seek: the queues already
+  // start there. A repeat of it is a new seek with a new id.
+  if (seekId != 0 && seekId == lastSeekId_ && us == lastSeekUs_) {
+    coalescedSeeks_.fetch_add(1, std::memory_order_relaxed);
+    return serial_;
+  }
+
+  for (Track &t : tracks_) {
+    clearLocked(t);
+    t.waitSync = false;
+    t.pushedSinceSeek = false;
+    t.lastSyncUs = kNoSkip;
+    t.skipThroughUs = kNoSkip;
+  }
+  ++serial_;
+  eos_ = false;
+  AMediaExtractor_seekTo(extractor_, us, AMEDIAEXTRACTOR_SEEK_CLOSEST_SYNC);
+
+  lastSeekUs_ = us;
+  lastSeekId_ = seekId;
+  seeks_.fetch_add(1, std::memory_order_relaxed);
+  readerCv_.notify_one();
+  return serial_;
+}
+
+uint32_t Demuxer::switchTrack(int32_t from, int32_t to, int64_t us,
+                               WakeEvent *wake) {
+  std::lock_guard<std::mutex> io(extractorMutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (from >= 0 && from != to) {
+    Track &old = tracks_[from];
+    AMediaExtractor_unselectTrack(extractor_, from);
+    clearLocked(old);
+    old.selected = false;
+    old.attached = false;
+    old.wake = nullptr;
+  }
+
+  Track &t = tracks_[to];
+  if (!t.selected) {
+    AMediaExtractor_selectTrack(extractor_, to);
+    t.selected = true;
+  }
+  clearLocked(t);
+  t.waitSync = false;
+  t.pushedSinceSeek = false;
+  t.lastSyncUs = kNoSkip;
+  t.skipThroughUs = kNoSkip;
+  t.attached = true;
+  t.wake = wake;
+
+  // The extractor goes back to the sync sample before `us` for every
+  // selected track; the others already have (or had) what it reads again.
+  for (size_t i = 0; i < tracks_.size(); ++i) {
+    Track &other = tracks_[i];
+    if (static_cast<int32_t>(i) == to || !other.selected)
+      continue;
+    if (!other.packets.empty() && other.packets.back().eos) {
+      other.skipThroughUs = kSkipAll;
+    } else {
+      other.skipThroughUs =
+          other.pushedSinceSeek ? other.lastPushedUs : kNoSkip;
+    }
+    other.skipSyncUs = other.lastSyncUs;
+  }
+
+  eos_ = false;
+  AMediaExtractor_seekTo(extractor_, us, AMEDIAEXTRACTOR_SEEK_CLOSEST_SYNC);
+  // Not a position the queues start at: no seek may coalesce with it.
+  lastSeekId_ = 0;
+  trackSwitches_.fetch_add(1, std::memory_order_relaxed);
+  readerCv_.notify_one();
+  LOGD("Track %d -> %d at %lld us", from, to, static_cast<long long>(us));
+  return serial_;
+}
+
+Demuxer::ReadStatus Demuxer::read(int32_t track, uint32_t serial,
+                                  uint8_t *dst, size_t capacity,
+                                  PacketInfo *info) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Track &t = tracks_[track];
+  if (t.packets.empty())
+    return ReadStatus::Empty;
+
+  Packet &p = t.packets.front();
+  info->ptsUs = p.ptsUs;
+  info->size = 0;
+  info->sync = p.sync;
+  info->serial = p.serial;
+  if (p.serial != serial)
+    return ReadStatus::Discontinuity;
+  if (p.eos)
+    return ReadStatus::EndOfStream; // stays queued until the next seek
+
+  size_t size = p.data.size();
+  if (size > capacity) {
+    LOGE("Packet of %zu bytes truncated to %zu", size, capacity);
+    size = capacity;
+  }
+  memcpy(dst, p.data.data(), size);
+  info->size = size;
+  dropFrontLocked(t);
+  readerCv_.notify_one();
+  return ReadStatus::Ok;
+}
+
+Demuxer::Stats Demuxer::stats() const {
+  Stats st{};
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    st.queuedBytes = queuedBytes_;
+  }
+  st.bytesRead = bytesRead_.load(std::memory_order_relaxed);
+  st.packetsRead = packetsRead_.load(std::memory_order_relaxed);
+  st.seeks = seeks_.load(std::memory_order_relaxed);
+  st.coalescedSeeks = coalescedSeeks_.load(std::memory_order_relaxed);
+  st.trackSwitches = trackSwitches_.load(std::memory_order_relaxed);
+  st.openUs = openUs_;
+  return st;
+}
+
+/* ===================== Reader thread ===================== */
+
+void Demuxer::readerLoop() {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      readerCv_.wait(lock, [this] {
+        return !running_ || (!eos_ && !bufferFullLocked());
+      });
+      if (!running_)
+        return;
+    }
+    readOne();
+  }
+}
+
+void Demuxer::readOne() {
+  std::lock_guard<std::mutex> io(extractorMutex_);
+
+  int track = AMediaExtractor_getSampleTrackIndex(extractor_);
+  if (track < 0 || track >= trackCount()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pushEosLocked();
+    return;
+  }
+
+  if (auto sampleSize = ndkcompat::mediaExtractorGetSampleSize()) {
+    ssize_t needed = sampleSize(extractor_);
+    if (needed > 0 && static_cast<size_t>(needed) > scratch_.size())
+      scratch_.resize(static_cast<size_t>(needed));
+  }
+  ssize_t size = AMediaExtractor_readSampleData(extractor_, scratch_.data(),
+                                                scratch_.size());
+  if (size < 0) {
+    // Also how a sample larger than the buffer fails without
+    // getSampleSize(): grow and retry before giving up.
+    if (scratch_.size() < kMaxScratchBytes) {
+      scratch_.resize(scratch_.size() * 2);
+      return;
+    }
+    LOGE("readSampleData failed at track %d", track);
+    std::lock_guard<std::mutex> lock(mutex_);
+    pushEosLocked();
+    return;
+  }
+
+  int64_t ptsUs = AMediaExtractor_getSampleTime(extractor_);
+  bool sync = (AMediaExtractor_getSampleFlags(extractor_) &
+               AMEDIAEXTRACTOR_SAMPLE_FLAG_SYNC) != 0;
+  AMediaExtractor_advance(extractor_);
+  bytesRead_.fetch_add(size, std::memory_order_relaxed);
+  packetsRead_.fetch_add(1, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  pushLocked(track, scratch_.data(), static_cast<size_t>(size), ptsUs, sync);
+}
+
+bool Demuxer::bufferFullLocked() const {
+  if (queuedBytes_ >= kHardMaxQueuedBytes)
+    return true;
+
+  bool anyAttached = false;
+  bool allAhead = true;
+  for (const Track &t : tracks_) {
+    if (!t.attached)
+      continue;
+    anyAttached = true;
+    if (t.packets.empty())
+      return false; // a decoder is starving: keep reading
+    if (t.packets.back().ptsUs - t.packets.front().ptsUs < kTargetAheadUs)
+      allAhead = false;
+  }
+  // Nobody to read for yet: wait for the first attach.
+  if (!anyAttached)
+    return true;
+  return allAhead || queuedBytes_ >= kMaxQueuedBytes;
+}
+
+void Demuxer::pushLocked(int32_t track, const uint8_t *data, size_t size,
+                         int64_t ptsUs, bool sync) {
+  Track &t = tracks_[track];
+  if (!t.selected)
+    return;
+
+  // Re-read after a track switch: drop through the last packet this track
+  // got before it. A sync sample past the last one it got means the read
+  // started after that packet (the queue was far behind): all new from here.
+  if (t.skipThroughUs != kNoSkip) {
+    if (ptsUs == t.skipThroughUs) {
+      t.skipThroughUs = kNoSkip;
+      return;
+    }
+    if (!sync || ptsUs <= t.skipSyncUs || t.skipThroughUs == kSkipAll)
+      return;
+    t.skipThroughUs = kNoSkip;
+  }
+
+  if (t.waitSync && !sync)
+    return;
+  t.waitSync = false;
+
+  if (!t.attached) {
+    // Orphan track: only the current GOP is worth keeping.
+    if (sync)
+      clearLocked(t);
+    if (t.bytes + static_cast<int64_t>(size) > kOrphanMaxBytes) {
+      clearLocked(t);
+      t.waitSync = true;
+      return;
+    }
+  }
+
+  Packet p;
+  if (!pool_.empty()) {
+    p.data = std::move(pool_.back());
+    pool_.pop_back();
+  }
+  p.data.assign(data, data + size);
+  p.ptsUs = ptsUs;
+  p.serial = serial_;
+  p.sync = sync;
+  p.eos = false;
+
+  bool wasEmpty = t.packets.empty();
+  t.packets.push_back(std::move(p));
+  t.lastPushedUs = ptsUs;
+  if (sync)
+    t.lastSyncUs = ptsUs;
+  t.pushedSinceSeek = true;
+  t.bytes += static_cast<int64_t>(size);
+  queuedBytes_ += static_cast<int64_t>(size);
+  if (wasEmpty && t.wake)
+    t.wake->notify();
+}
+
+void Demuxer::pushEosLocked() {
+  eos_ = true;
+  for (Track &t : tracks_) {
+    // Still queued from before a track switch.
+    if (!t.selected || (!t.packets.empty() && t.packets.back().eos))
+      continue;
+    Packet p;
+    p.ptsUs = t.packets.empty() ? 0 : t.packets.back().ptsUs;
+    p.serial = serial_;
+    p.sync = false;
+    p.eos = true;
+    t.packets.push_back(std::move(p));
+    if (t.wake)
+      t.wake->notify();
+  }
+}
+
+void Demuxer::dropFrontLocked(Track &t) {
+  Packet &p = t.packets.front();
+  int64_t size = static_cast<int64_t>(p.data.size());
+  t.bytes -= size;
+  queuedBytes_ -= size;
+  if (p.data.capacity() > 0 && pool_.size() < kMaxPooledBuffers) {
+    p.data.clear();
+    pool_.push_back(std::move(p.data));
+  }
+  t.packets.pop_front();
+}
+
+void Demuxer::clearLocked(Track &t) {
+  while (!t.packets.empty())
+    dropFrontLocked(t);
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <media/NdkMediaExtractor.h>
+#include <media/NdkMediaFormat.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/WakeEvent.h"
+
+/*
+ * One container parser per file, shared by the audio and video decoders.
+ *
+ * A reader thread pulls samples from a single AMediaExtractor into bounded
+ * per-track packet queues; decoders copy packets straight into their codec
+ * input buffers with read(). Opening, parsing and disk reads happen once
+ * instead of once per decoder.
+ *
+ * Seeks: every seek bumps a serial and flushes all queues, so a consumer
+ * that sees a packet of another serial knows the stream was repositioned
+ * under it (read() returns Discontinuity) and flushes its codec. The audio
+ * and video halves of one user seek carry the same seek id and share a
+ * single extractor seek: whichever engine applies it first repositions,
+ * the other gets the serial that seek produced.
+ *
+ * Memory: the reader stops at kMaxQueuedBytes, or once every attached track
+ * has kTargetAheadUs queued, unless an attached track ran dry (badly
+ * interleaved files) -- then up to kHardMaxQueuedBytes. Tracks without a
+ * consumer keep only the packets since their latest sync sample, so a
+ * decoder attaching later starts on a key frame.
+ *
+ * Track switches (another audio language) reposition the extractor without
+ * a new serial: the new track starts at the switch point, the others drop
+ * the duplicates until they reach new packets.
+ */
+class Demuxer {
+public:
+  enum class ReadStatus { Ok, Empty, EndOfStream, Discontinuity };
+
+  struct PacketInfo {
+    int64_t ptsUs;
+    size_t size;
+    bool sync;
+    uint32_t serial;
+  };
+
+  struct Stats {
+    int64_t queuedBytes;
+    int64_t bytesRead; // total sample bytes pulled from the container
+    int64_t packetsRead;
+    int64_t seeks;
+    int64_t coalescedSeeks;
+    int64_t trackSwitches;
+    int64_t openUs;
+  };
+
+  Demuxer() = default;
+  ~Demuxer();
+
+  Demuxer(const Demuxer &) = delete;
+  Demuxer &operator=(const Demuxer &) = delete;
+
+  bool openFd(int fd, int64_t offset, int64_t length);
+  bool openPath(const char *path);
+  // Same file and offset as an fd given to openFd (different descriptors
+  // for one file compare equal).
+  bool isSameSource(int fd, int64_t offset) const;
+
+  int32_t trackCount() const { return static_cast<int32_t>(tracks_.size()); }
+  // First track whose MIME type starts with `mimePrefix`, or -1.
+  int32_t findTrack(const char *mimePrefix) const;
+  const std::string &trackMime(int32_t track) const {
+    return tracks_[track].mime;
+  }
+  // New format object for `track`; the caller deletes it.
+  AMediaFormat *trackFormat(int32_t track);
+  int64_t durationUs() const { return durationUs_; }
+
+  // Starts delivering `track` to one consumer; `wake` (may be null) is
+  // notified when data arrives in its empty queue. Returns the current
+  // serial.
+  uint32_t attach(int32_t track, WakeEvent *wake);
+  void detach(int32_t track);
+
+  // True if the queued packets of `track` start with a sync sample at or
+  // before `us`, so a decoder can start there without a seek.
+  bool canStartAt(int32_t track, int64_t us) const;
+
+  // Repositions all tracks at the sync sample at or before `us`. Returns
+  // the serial of the packets that follow; a consumer whose serial already
+  // equals it has nothing to flush. A nonzero `seekId` equal to that of
+  // the last seek (same position) shares it instead of seeking again; 0
+  // always seeks.
+  uint32_t seekUs(int64_t us, uint32_t seekId);
+
+  // Live track change: deselects and detaches `from` (if >= 0), selects and
+  // attaches `to` for `wake`'s consumer and repositions the extractor at the
+  // sync sample at or before `us`. The serial stays the same, so the other
+  // tracks' consumers see no discontinuity: what the reposition reads again
+  // for them is dropped up to their last queued packet. Returns the serial.
+  uint32_t switchTrack(int32_t from, int32_t to, int64_t us, WakeEvent *wake);
+
+  // Copies the next packet of `track` into dst (truncated to capacity).
+  // Packets of a serial other than `serial` are not consumed: the call
+  // returns Discontinuity with info->serial and info->ptsUs set instead.
+  ReadStatus read(int32_t track, uint32_t serial, uint8_t *dst,
+                  size_t capacity, PacketInfo *info);
+
+  Stats stats() const;
+
+private:
+  static constexpr int64_t kMaxQueuedBytes = 12 << 20;
+  static constexpr int64_t kHardMaxQueuedBytes = 24 << 20;
+  static constexpr int64_t kTargetAheadUs = 2000000;
+  // Cap for a track nobody consumes (one GOP normally fits).
+  static constexpr int64_t kOrphanMaxBytes = 4 << 20;
+  static constexpr size_t kMaxPooledBuffers = 256;
+  static constexpr size_t kMinScratchBytes = 1 << 20;
+  static constexpr size_t kMaxScratchBytes = 32 << 20;
+
+  struct Packet {
+    std::vector<uint8_t> data;
+    int64_t ptsUs;
+    uint32_t serial;
+    bool sync;
+    bool eos;
+  };
+
+  // Track::skipThroughUs: nothing to skip / everything (queue ends in EOS).
+  static constexpr int64_t kNoSkip = INT64_MIN;
+  static constexpr int64_t kSkipAll = INT64_MAX;
+
+  struct Track {
+    std::string mime;
+    std::deque<Packet> packets;
+    int64_t bytes = 0;
+    bool selected = false;
+    bool attached = false;
+    bool waitSync = false; // orphan overflowed: skip to the next sync
+    WakeEvent *wake = nullptr;
+    // Last packet and last sync sample queued since the latest seek
+    // (pushedSinceSeek). After a track switch, re-read packets are dropped
+    // through skipThroughUs unless a sync sample past skipSyncUs comes first.
+    int64_t lastPushedUs = 0;
+    int64_t lastSyncUs = kNoSkip;
+    bool pushedSinceSeek = false;
+    int64_t skipThroughUs = kNoSkip;
+    int64_t skipSyncUs = kNoSkip;
+  };
+
+  bool openExtractor();
+  void readerLoop();
+  void readOne();
+  bool bufferFullLocked() const;
+  void pushLocked(int32_t track, const uint8_t *data, size_t size,
+                  int64_t ptsUs, bool sync);
+  void pushEosLocked();
+  void dropFrontLocked(Track &t);
+  void clearLocked(Track &t);
+
+  /* Source (extractorMutex_ while the reader runs) */
+  std::mutex extractorMutex_;
+  AMediaExtractor *extractor_ = nullptr;
+  int fd_ = -1;
+  int64_t offset_ = 0;
+  int64_t durationUs_ = 0;
+  std::vector<uint8_t> scratch_;
+
+  /* Queues (mutex_) */
+  mutable std::mutex mutex_;
+  std::condition_variable readerCv_;
+  std::vector<Track> tracks_;
+  std::vector<std::vector<uint8_t>> pool_; // recycled packet buffers
+  int64_t queuedBytes_ = 0;
+  uint32_t serial_ = 0;
+  bool eos_ = false;
+  int64_t lastSeekUs_ = -1;
+  uint32_t lastSeekId_ = 0; // 0 = nothing to share
+
+  std::thread reader_;
+  bool running_ = false; // mutex_
+
+  /* Stats */
+  std::atomic<int64_t> bytesRead_{0};
+  std::atomic<int64_t> packetsRead_{0};
+  std::atomic<int64_t> seeks_{0};
+  std::atomic<int64_t> coalescedSeeks_{0};
+  std::atomic<int64_t> trackSwitches_{0};
+  int64_t openUs_ = 0;
+};
@@ -0,0 +1,80 @@
+#include "NdkCompat.h"
+
+#include <android/api-level.h>
+#include <dlfcn.h>
+
+namespace ndkcompat {
+
+static void *libMediaNdk() {
+  // Already loaded as a DT_NEEDED dependency; this only takes a reference.
+  static void *handle = dlopen("libmediandk.so", RTLD_NOW);
+  return handle;
+}
+
+static void *libAndroid() {
+  static void *handle = dlopen("libandroid.so", RTLD_NOW);
+  return handle;
+}
+
+template <typename Fn> static Fn lookup(void *lib, const char *name) {
+  return lib ? reinterpret_cast<Fn>(dlsym(lib, name)) : nullptr;
+}
+
+int deviceApiLevel() {
+  static const int level = android_get_device_api_level();
+  return level;
+}
+
+MediaCodecSetAsyncNotifyCallbackFn mediaCodecSetAsyncNotifyCallback() {
+  static const MediaCodecSetAsyncNotifyCallbackFn fn =
+      deviceApiLevel() >= 28
+          ? lookup<MediaCodecSetAsyncNotifyCallbackFn>(
+                libMediaNdk(), "AMediaCodec_setAsyncNotifyCallback")
+          : nullptr;
+  return fn;
+}
+
+MediaCodecGetNameFn mediaCodecGetName() {
+  static const MediaCodecGetNameFn fn =
+      deviceApiLevel() >= 28
+          ? lookup<MediaCodecGetNameFn>(libMediaNdk(), "AMediaCodec_getName")
+          : nullptr;
+  return fn;
+}
+
+MediaCodecReleaseNameFn mediaCodecReleaseName() {
+  static const MediaCodecReleaseNameFn fn =
+      deviceApiLevel() >= 28 ? lookup<MediaCodecReleaseNameFn>(
+                                   libMediaNdk(), "AMediaCodec_releaseName")
+                             : nullptr;
+  return fn;
+}
+
+MediaExtractorGetSampleSizeFn mediaExtractorGetSampleSize() {
+  static const MediaExtractorGetSampleSizeFn fn =
+      deviceApiLevel() >= 28
+          ? lookup<MediaExtractorGetSampleSizeFn>(
+                libMediaNdk(), "AMediaExtractor_getSampleSize")
+          : nullptr;
+  return fn;
+}
+
+ChoreographerPostFrameCallback64Fn choreographerPostFrameCallback64() {
+  static const ChoreographerPostFrameCallback64Fn fn =
+      deviceApiLevel() >= 29
+          ? lookup<ChoreographerPostFrameCallback64Fn>(
+                libAndroid(), "AChoreographer_postFrameCallback64")
+          : nullptr;
+  return fn;
+}
+
+NativeWindowSetFrameRateFn nativeWindowSetFrameRate() {
+  static const NativeWindowSetFrameRateFn fn =
+      deviceApiLevel() >= 30
+          ? lookup<NativeWindowSetFrameRateFn>(libAndroid(),
+                                               "ANativeWindow_setFrameRate")
+          : nullptr;
+  return fn;
+}
+
+} // namespace ndkcompat
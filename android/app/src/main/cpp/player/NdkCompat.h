@@ -0,0 +1,47 @@
+#pragma once
+
+#include <android/choreographer.h>
+#include <android/native_window.h>
+#include <media/NdkMediaCodec.h>
+#include <media/NdkMediaExtractor.h>
+
+/*
+ * Runtime lookups for NDK entry points newer than our minSdk (26).
+ *
+ * Calling an API-28+ symbol directly would make libmxplayer.so fail to load
+ * on older devices, so these are resolved with dlsym() on first use and
+ * return nullptr when the device does not provide them.
+ */
+namespace ndkcompat {
+
+int deviceApiLevel();
+
+// AMediaCodec_setAsyncNotifyCallback (API 28)
+using MediaCodecSetAsyncNotifyCallbackFn = media_status_t (*)(
+    AMediaCodec *, AMediaCodecOnAsyncNotifyCallback, void *);
+MediaCodecSetAsyncNotifyCallbackFn mediaCodecSetAsyncNotifyCallback();
+
+// AMediaCodec_getName / AMediaCodec_releaseName (API 28)
+using MediaCodecGetNameFn = media_status_t (*)(AMediaCodec *, char **);
+using MediaCodecReleaseNameFn = void (*)(AMediaCodec *, char *);
+MediaCodecGetNameFn mediaCodecGetName();
+MediaCodecReleaseNameFn mediaCodecReleaseName();
+
+// AMediaExtractor_getSampleSize (API 28)
+using MediaExtractorGetSampleSizeFn = ssize_t (*)(AMediaExtractor *);
+MediaExtractorGetSampleSizeFn mediaExtractorGetSampleSize();
+
+// AChoreographer_postFrameCallback64 (API 29). The API 24 variant passes a
+// `long`, which truncates CLOCK_MONOTONIC nanoseconds on 32-bit ABIs.
+using ChoreographerFrameCallback64 = void (*)(int64_t frameTimeNanos,
+                                              void *data);
+using ChoreographerPostFrameCallback64Fn =
+    void (*)(AChoreographer *, ChoreographerFrameCallback64, void *);
+ChoreographerPostFrameCallback64Fn choreographerPostFrameCallback64();
+
+// ANativeWindow_setFrameRate (API 30)
+using NativeWindowSetFrameRateFn = int32_t (*)(ANativeWindow *, float,
+                                               int8_t);
+NativeWindowSetFrameRateFn nativeWindowSetFrameRate();
+
+} // namespace ndkcompat
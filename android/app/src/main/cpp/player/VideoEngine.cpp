@@ -0,0 +1,564 @@
+#include "VideoEngine.h"
+#include "NdkCompat.h"
+
+#include <algorithm>
+#include <android/choreographer.h>
+#include <android/log.h>
+#include <cmath>
+
+#define LOG_TAG "VideoEngine"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace {
+// Upper bound on one wait for a future frame, so clock jumps (seek, slew,
+// re-anchoring) are picked up even without a notify.
+constexpr int64_t kMaxFrameWaitUs = 20000;
+} // namespace
+
+/* ===================== Lifecycle ===================== */
+
+VideoEngine::VideoEngine(VirtualClock *clock) : clock_(clock) {}
+
+VideoEngine::~VideoEngine() {
+  stop();
+  setWindow(nullptr);
+}
+
+void VideoEngine::setWindow(ANativeWindow *window) {
+  stopThread();
+
+  {
+    std::lock_guard<std::mutex> lock(windowMutex_);
+    if (window)
+      ANativeWindow_acquire(window);
+    if (window_)
+      ANativeWindow_release(window_);
+    window_ = window;
+  }
+  windowFrameRate_ = 0.0f; // vote again on the new window
+  pacer_.reset();
+
+  if (!window || !codec_)
+    return;
+
+  // Same codec, new surface (API 23+): no reconfigure needed.
+  bool recreated = false;
+  if (AMediaCodec_setOutputSurface(codec_, window) != AMEDIA_OK) {
+    LOGE("setOutputSurface failed, reopening codec");
+    const char *mime = nullptr;
+    AMediaFormat_getString(format_, AMEDIAFORMAT_KEY_MIME, &mime);
+    std::string mimeCopy = mime ? mime : "";
+    AMediaCodec_stop(codec_);
+    AMediaCodec_delete(codec_);
+    codec_ = nullptr;
+    heldIndex_ = -1;
+    if (mimeCopy.empty() || !configureCodec(mimeCopy.c_str(), window))
+      return;
+    recreated = true;
+  }
+
+  // A new codec needs a key frame; while paused, redraw the current position
+  // on the new surface right away. Otherwise the next frame lands on it
+  // anyway, and the shared demuxer is left alone.
+  if (recreated || !renderEnabled_.load(std::memory_order_acquire)) {
+    pendingSeekId_.store(0, std::memory_order_relaxed);
+    pendingSeekUs_.store(std::max<int64_t>(0, clock_->positionUs()),
+                         std::memory_order_release);
+  }
+  startThread();
+}
+
+/* ===================== Open ===================== */
+
+bool VideoEngine::openFd(int fd, int64_t offset, int64_t length) {
+  auto demuxer = std::make_shared<Demuxer>();
+  if (!demuxer->openFd(fd, offset, length))
+    return false;
+  return open(std::move(demuxer));
+}
+
+bool VideoEngine::open(std::shared_ptr<Demuxer> demuxer) {
+  stop();
+
+  ANativeWindow *window;
+  {
+    std::lock_guard<std::mutex> lock(windowMutex_);
+    window = window_;
+  }
+  if (!window) {
+    LOGE("open without a window");
+    return false;
+  }
+
+  int32_t videoTrack = demuxer->findTrack("video/");
+  if (videoTrack < 0)
+    return false;
+
+  demuxer_ = std::move(demuxer);
+  track_ = videoTrack;
+  format_ = demuxer_->trackFormat(track_);
+  demuxSerial_ = demuxer_->attach(track_, &wakeEvent_);
+
+  durationUs_ = 0;
+  AMediaFormat_getInt64(format_, AMEDIAFORMAT_KEY_DURATION, &durationUs_);
+
+  int32_t width = 0;
+  int32_t height = 0;
+  AMediaFormat_getInt32(format_, AMEDIAFORMAT_KEY_WIDTH, &width);
+  AMediaFormat_getInt32(format_, AMEDIAFORMAT_KEY_HEIGHT, &height);
+  width_.store(width, std::memory_order_relaxed);
+  height_.store(height, std::memory_order_relaxed);
+
+  const char *mime = nullptr;
+  AMediaFormat_getString(format_, AMEDIAFORMAT_KEY_MIME, &mime);
+  if (!mime || !configureCodec(mime, window)) {
+    cleanupMedia();
+    return false;
+  }
+
+  rendered_.store(0, std::memory_order_relaxed);
+  dropped_.store(0, std::memory_order_relaxed);
+  late_.store(0, std::memory_order_relaxed);
+  skipped_.store(0, std::memory_order_relaxed);
+  skipUntilUs_ = kNoSeek;
+  seekStartUs_ = 0;
+  pacer_.reset();
+  pacer_.resetStats();
+
+  // Vote for the container's rate right away so a mode switch can happen
+  // before the first frame; detection from PTS refines it later.
+  float containerFps = 0.0f;
+  int32_t containerFpsInt = 0;
+  if (!AMediaFormat_getFloat(format_, AMEDIAFORMAT_KEY_FRAME_RATE,
+                             &containerFps) &&
+      AMediaFormat_getInt32(format_, AMEDIAFORMAT_KEY_FRAME_RATE,
+                            &containerFpsInt))
+    containerFps = static_cast<float>(containerFpsInt);
+  updateWindowFrameRate(containerFps);
+
+  // Start where the master clock is (re-open after a surface change). When
+  // the queue already starts on a key frame before that, decode from there
+  // and skip the frames before the clock.
+  int64_t startUs = std::max<int64_t>(0, clock_->positionUs());
+  if (demuxer_->canStartAt(track_, startUs + kReleaseAheadUs)) {
+    skipUntilUs_ = startUs;
+  } else {
+    pendingSeekId_.store(0, std::memory_order_relaxed);
+    pendingSeekUs_.store(startUs, std::memory_order_release);
+  }
+  startThread();
+  return true;
+}
+
+bool VideoEngine::configureCodec(const char *mime, ANativeWindow *window) {
+  codec_ = AMediaCodec_createDecoderByType(mime);
+  if (!codec_)
+    return false;
+
+  if (AMediaCodec_configure(codec_, format_, window, nullptr, 0) !=
+          AMEDIA_OK ||
+      AMediaCodec_start(codec_) != AMEDIA_OK) {
+    LOGE("Video codec %s configure/start failed", mime);
+    AMediaCodec_delete(codec_);
+    codec_ = nullptr;
+    return false;
+  }
+
+  std::string name = mime;
+  auto getName = ndkcompat::mediaCodecGetName();
+  auto releaseName = ndkcompat::mediaCodecReleaseName();
+  char *codecName = nullptr;
+  if (getName && getName(codec_, &codecName) == AMEDIA_OK && codecName) {
+    name = codecName;
+    if (releaseName)
+      releaseName(codec_, codecName);
+  }
+  {
+    std::lock_guard<std::mutex> lock(nameMutex_);
+    decoderName_ = name;
+  }
+
+  inputEos_ = false;
+  outputEos_ = false;
+  heldIndex_ = -1;
+  firstFrameShown_ = false;
+  LOGD("Video codec %s started", name.c_str());
+  return true;
+}
+
+void VideoEngine::updateOutputFormat() {
+  AMediaFormat *out = AMediaCodec_getOutputFormat(codec_);
+  if (!out)
+    return;
+  int32_t width = 0;
+  int32_t height = 0;
+  if (AMediaFormat_getInt32(out, AMEDIAFORMAT_KEY_WIDTH, &width) && width > 0)
+    width_.store(width, std::memory_order_relaxed);
+  if (AMediaFormat_getInt32(out, AMEDIAFORMAT_KEY_HEIGHT, &height) &&
+      height > 0)
+    height_.store(height, std::memory_order_relaxed);
+  AMediaFormat_delete(out);
+}
+
+void VideoEngine::cleanupMedia() {
+  if (codec_) {
+    if (heldIndex_ >= 0)
+      AMediaCodec_releaseOutputBuffer(codec_, heldIndex_, false);
+    AMediaCodec_stop(codec_);
+    AMediaCodec_delete(codec_);
+    codec_ = nullptr;
+  }
+  heldIndex_ = -1;
+  inputIndex_ = -1;
+  if (demuxer_) {
+    demuxer_->detach(track_);
+    demuxer_.reset();
+  }
+  track_ = -1;
+  if (format_) {
+    AMediaFormat_delete(format_);
+    format_ = nullptr;
+  }
+  durationUs_ = 0;
+}
+
+/* ===================== Control ===================== */
+
+void VideoEngine::play() {
+  renderEnabled_.store(true, std::memory_order_release);
+  wakeEvent_.notify();
+  wakeVsyncThread();
+}
+
+void VideoEngine::pause() {
+  renderEnabled_.store(false, std::memory_order_release);
+  wakeEvent_.notify();
+}
+
+void VideoEngine::seekUs(int64_t us, uint32_t seekId) {
+  // Applied by the render thread; a newer request replaces an older one.
+  seekRequestUs_.store(VirtualClock::nowUs(), std::memory_order_relaxed);
+  pendingSeekId_.store(seekId, std::memory_order_relaxed);
+  pendingSeekUs_.store(std::max<int64_t>(0, us), std::memory_order_release);
+  wakeEvent_.notify();
+}
+
+void VideoEngine::stop() {
+  stopThread();
+  updateWindowFrameRate(0.0f); // drop our vote, the panel may idle again
+  cleanupMedia();
+  renderEnabled_.store(false, std::memory_order_release);
+  pendingSeekUs_.store(kNoSeek, std::memory_order_relaxed);
+  seekRequestUs_.store(0, std::memory_order_relaxed);
+}
+
+void VideoEngine::startThread() {
+  if (thread_.joinable() || !codec_)
+    return;
+  threadRunning_.store(true, std::memory_order_release);
+  thread_ = std::thread(&VideoEngine::renderLoop, this);
+  vsyncRunning_.store(true, std::memory_order_release);
+  vsyncThread_ = std::thread(&VideoEngine::vsyncLoop, this);
+}
+
+void VideoEngine::stopThread() {
+  threadRunning_.store(false, std::memory_order_release);
+  wakeEvent_.notify();
+  if (thread_.joinable())
+    thread_.join();
+
+  vsyncRunning_.store(false, std::memory_order_release);
+  wakeVsyncThread();
+  if (vsyncThread_.joinable())
+    vsyncThread_.join();
+}
+
+VideoEngine::Stats VideoEngine::stats() const {
+  Stats st{};
+  st.rendered = rendered_.load(std::memory_order_relaxed);
+  st.dropped = dropped_.load(std::memory_order_relaxed);
+  st.late = late_.load(std::memory_order_relaxed);
+  st.width = width_.load(std::memory_order_relaxed);
+  st.height = height_.load(std::memory_order_relaxed);
+  st.skipped = skipped_.load(std::memory_order_relaxed);
+  st.seekLatencyUs = seekLatencyUs_.load(std::memory_order_relaxed);
+  return st;
+}
+
+std::string VideoEngine::decoderName() const {
+  std::lock_guard<std::mutex> lock(nameMutex_);
+  return decoderName_;
+}
+
+/* ===================== Render loop ===================== */
+
+void VideoEngine::renderLoop() {
+  while (threadRunning_.load(std::memory_order_acquire)) {
+    int64_t seek = pendingSeekUs_.exchange(kNoSeek, std::memory_order_acq_rel);
+    if (seek != kNoSeek)
+      applySeek(seek, pendingSeekId_.load(std::memory_order_relaxed));
+
+    // PAUSE GATE: once the preview frame is up, nothing moves until the
+    // render gate opens and the clock runs.
+    bool gated = firstFrameShown_ &&
+                 (!renderEnabled_.load(std::memory_order_acquire) ||
+                  !clock_->isRunning());
+    if (gated || (outputEos_ && heldIndex_ < 0)) {
+      wakeEvent_.wait(gated ? -1 : kMaxFrameWaitUs);
+      continue;
+    }
+
+    bool fed = feedInput();
+    if (heldIndex_ < 0)
+      dequeueOutput(fed ? 0 : kDequeueTimeoutUs);
+
+    if (heldIndex_ >= 0) {
+      int64_t waitUs = presentHeld();
+      if (waitUs > 0)
+        wakeEvent_.wait(waitUs);
+    }
+
+    float fps = pacer_.contentFps();
+    if (fps > 0.0f)
+      updateWindowFrameRate(fps);
+  }
+}
+
+void VideoEngine::applySeek(int64_t us, uint32_t seekId) {
+  // Same serial: audio applied this seek first and the discontinuity was
+  // already taken, so the codec holds exactly what follows the seek.
+  uint32_t serial = demuxer_->seekUs(us, seekId);
+  if (serial != demuxSerial_)
+    flushCodec(serial);
+
+  // Internal re-seeks (open, new surface) are not measured.
+  seekStartUs_ = seekRequestUs_.exchange(0, std::memory_order_relaxed);
+  if (seekStartUs_ != 0)
+    seekLatencyUs_.store(-1, std::memory_order_relaxed);
+  if (accurateSeek_.load(std::memory_order_relaxed)) {
+    skipUntilUs_ = us;
+    firstFrameShown_ = false; // show the target frame, even when paused
+  }
+}
+
+void VideoEngine::flushCodec(uint32_t serial) {
+  if (heldIndex_ >= 0)
+    releaseHeld(false);
+  inputIndex_ = -1;
+  AMediaCodec_flush(codec_);
+  demuxSerial_ = serial;
+  inputEos_ = false;
+  outputEos_ = false;
+  firstFrameShown_ = false;
+  skipUntilUs_ = kNoSeek;
+  pacer_.reset();
+}
+
+// Queues one demuxed packet (or EOS). Returns true if a buffer was fed.
+bool VideoEngine::feedInput() {
+  if (inputEos_)
+    return false;
+  if (inputIndex_ < 0) {
+    inputIndex_ = AMediaCodec_dequeueInputBuffer(codec_, 0);
+    if (inputIndex_ < 0)
+      return false;
+  }
+
+  size_t bufSize = 0;
+  uint8_t *buf = AMediaCodec_getInputBuffer(codec_, inputIndex_, &bufSize);
+  if (!buf)
+    return false;
+
+  Demuxer::PacketInfo packet;
+  switch (demuxer_->read(track_, demuxSerial_, buf, bufSize, &packet)) {
+  case Demuxer::ReadStatus::Ok:
+    AMediaCodec_queueInputBuffer(codec_, inputIndex_, 0, packet.size,
+                                 packet.ptsUs, 0);
+    inputIndex_ = -1;
+    return true;
+  case Demuxer::ReadStatus::EndOfStream:
+    AMediaCodec_queueInputBuffer(codec_, inputIndex_, 0, 0, 0,
+                                 AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
+    inputIndex_ = -1;
+    inputEos_ = true;
+    return true;
+  case Demuxer::ReadStatus::Discontinuity:
+    // Audio repositioned the shared demuxer: start over from there.
+    flushCodec(packet.serial);
+    return false;
+  case Demuxer::ReadStatus::Empty:
+    break;
+  }
+  return false;
+}
+
+void VideoEngine::dequeueOutput(int64_t timeoutUs) {
+  AMediaCodecBufferInfo info;
+  ssize_t outIndex = AMediaCodec_dequeueOutputBuffer(codec_, &info, timeoutUs);
+  if (outIndex == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED) {
+    updateOutputFormat();
+  } else if (outIndex >= 0) {
+    heldIndex_ = outIndex;
+    heldInfo_ = info;
+    if (info.size > 0)
+      pacer_.onFramePts(info.presentationTimeUs);
+  }
+}
+
+int64_t VideoEngine::presentHeld() {
+  if (heldInfo_.size <= 0 &&
+      (heldInfo_.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM)) {
+    releaseHeld(false);
+    return 0;
+  }
+
+  // 0️⃣ Before the seek target: decoded, never shown, never paced.
+  if (heldInfo_.presentationTimeUs < skipUntilUs_ &&
+      !(heldInfo_.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM)) {
+    releaseHeld(false);
+    skipped_.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  }
+
+  // 1️⃣ First frame after open/seek: show it now, paused or not.
+  if (!firstFrameShown_) {
+    releaseHeld(true);
+    firstFrameShown_ = true;
+    skipUntilUs_ = kNoSeek;
+    rendered_.fetch_add(1, std::memory_order_relaxed);
+    if (seekStartUs_ != 0) {
+      seekLatencyUs_.store(VirtualClock::nowUs() - seekStartUs_,
+                           std::memory_order_relaxed);
+      seekStartUs_ = 0;
+    }
+    return 0;
+  }
+
+  ClockPage::Snapshot clock = clock_->page().load();
+  if (!clock.running)
+    return kMaxFrameWaitUs; // the pause gate takes over
+
+  int64_t now = VirtualClock::nowUs();
+  int64_t dueUs =
+      ClockPage::timeAtPosition(clock, heldInfo_.presentationTimeUs);
+  int64_t aheadUs = dueUs - now;
+
+  // 2️⃣ Too early to hand over: wait (notify cuts this short on seek/pause).
+  if (aheadUs > kReleaseAheadUs)
+    return std::min(aheadUs - kReleaseAheadUs, kMaxFrameWaitUs);
+
+  // 3️⃣ Hopelessly late: never show it.
+  if (aheadUs < -kDropLateUs) {
+    releaseHeld(false);
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    pacer_.onFrameShown(false);
+    return 0;
+  }
+
+  // 4️⃣ Present on the vsync matching its slot (or ASAP if slightly late).
+  // The timestamp goes half a vsync ahead of the chosen vsync so the
+  // compositor latches exactly that one.
+  int64_t presentNs = dueUs * 1000;
+  if (pacer_.hasVsync()) {
+    presentNs = pacer_.snap(presentNs) - pacer_.vsyncPeriodNs() / 2;
+  }
+  if (aheadUs < 0)
+    late_.fetch_add(1, std::memory_order_relaxed);
+  if (presentNs > now * 1000) {
+    releaseHeld(true, presentNs);
+  } else {
+    releaseHeld(true);
+  }
+  rendered_.fetch_add(1, std::memory_order_relaxed);
+  pacer_.onFrameShown(true);
+  return 0;
+}
+
+void VideoEngine::releaseHeld(bool render, int64_t atNs) {
+  if (heldInfo_.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM)
+    outputEos_ = true;
+  if (render && atNs >= 0) {
+    AMediaCodec_releaseOutputBufferAtTime(codec_, heldIndex_, atNs);
+  } else {
+    AMediaCodec_releaseOutputBuffer(codec_, heldIndex_, render);
+  }
+  heldIndex_ = -1;
+}
+
+void VideoEngine::updateWindowFrameRate(float fps) {
+  if (std::abs(fps - windowFrameRate_) < 0.01f)
+    return;
+  auto setFrameRate = ndkcompat::nativeWindowSetFrameRate();
+  std::lock_guard<std::mutex> lock(windowMutex_);
+  if (!setFrameRate || !window_)
+    return;
+  // FIXED_SOURCE: the panel should pick a mode that is a multiple of the
+  // content rate (24p -> 48/120 Hz) instead of running at its default.
+  setFrameRate(window_, fps, ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_FIXED_SOURCE);
+  windowFrameRate_ = fps;
+  LOGD("Window frame rate vote %.3f", fps);
+}
+
+/* ===================== Vsync thread ===================== */
+
+// AChoreographer delivers callbacks on the looper of the thread that posted
+// them, so this thread owns a looper and does nothing else. Callbacks are
+// only re-posted while the render gate is open: no vsync wakeups while
+// paused.
+void VideoEngine::vsyncLoop() {
+  ALooper *looper = ALooper_prepare(0);
+  {
+    std::lock_guard<std::mutex> lock(vsyncMutex_);
+    ALooper_acquire(looper);
+    vsyncLooper_ = looper;
+  }
+  vsyncPosted_ = false;
+
+  while (vsyncRunning_.load(std::memory_order_acquire)) {
+    if (!vsyncPosted_ && renderEnabled_.load(std::memory_order_acquire))
+      postVsyncCallback();
+    ALooper_pollOnce(-1, nullptr, nullptr, nullptr);
+  }
+
+  std::lock_guard<std::mutex> lock(vsyncMutex_);
+  vsyncLooper_ = nullptr;
+  ALooper_release(looper);
+}
+
+void VideoEngine::wakeVsyncThread() {
+  std::lock_guard<std::mutex> lock(vsyncMutex_);
+  if (vsyncLooper_)
+    ALooper_wake(vsyncLooper_);
+}
+
+void VideoEngine::postVsyncCallback() {
+  AChoreographer *choreographer = AChoreographer_getInstance();
+  if (!choreographer)
+    return;
+  if (auto post64 = ndkcompat::choreographerPostFrameCallback64()) {
+    post64(choreographer, &VideoEngine::onVsync64, this);
+  } else {
+    AChoreographer_postFrameCallback(choreographer, &VideoEngine::onVsync,
+                                     this);
+  }
+  vsyncPosted_ = true;
+}
+
+void VideoEngine::onVsync64(int64_t frameTimeNanos, void *data) {
+  auto *self = static_cast<VideoEngine *>(data);
+  self->vsyncPosted_ = false;
+  self->pacer_.onVsync(frameTimeNanos);
+  if (self->vsyncRunning_.load(std::memory_order_acquire) &&
+      self->renderEnabled_.load(std::memory_order_acquire))
+    self->postVsyncCallback();
+}
+
+void VideoEngine::onVsync(long frameTimeNanos, void *data) {
+  // 32-bit `long` cannot hold monotonic nanoseconds; use "now" there, which
+  // is within the callback latency of the real vsync.
+  int64_t ns = sizeof(long) >= sizeof(int64_t)
+                   ? static_cast<int64_t>(frameTimeNanos)
+                   : VirtualClock::nowUs() * 1000;
+  onVsync64(ns, data);
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <android/looper.h>
+#include <android/native_window.h>
+#include <media/NdkMediaCodec.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "Demuxer.h"
+#include "VirtualClock.h"
+#include "core/FramePacer.h"
+#include "core/WakeEvent.h"
+
+/*
+ * Native video decode + render loop.
+ *
+ * MediaCodec renders straight into the ANativeWindow. Each decoded frame is
+ * handed back with AMediaCodec_releaseOutputBufferAtTime, stamped with the
+ * monotonic time at which VirtualClock reaches the frame's PTS, so the
+ * compositor latches it on the matching vsync. The thread only sleeps (on a
+ * WakeEvent) until a frame is within kReleaseAheadUs of its slot, so JVM
+ * sleep granularity and GC pauses no longer affect frame timing.
+ *
+ * With display vsync known (AChoreographer, on a small looper thread that
+ * only runs while playing), FramePacer snaps every slot to a vsync with a
+ * steady cadence, and the content frame rate is passed to
+ * ANativeWindow_setFrameRate (API 30+) so the panel can switch to a
+ * matching mode.
+ *
+ * Packets come from a Demuxer, normally the one the AudioEngine reads from
+ * too. The codec is owned by the render thread while it runs; seeks are
+ * posted to it (pendingSeekUs_) and applied there, so the codec is never
+ * touched from two threads.
+ */
+class VideoEngine {
+public:
+  struct Stats {
+    int64_t rendered;
+    int64_t dropped; // later than kDropLateUs, never shown
+    int64_t late;    // shown, but released after their slot
+    int32_t width;
+    int32_t height;
+    int64_t skipped;       // decoded before an accurate-seek target
+    int64_t seekLatencyUs; // last seekUs() → first frame shown, -1 = none
+  };
+
+  explicit VideoEngine(VirtualClock *clock);
+  ~VideoEngine();
+
+  // Takes its own reference on `window`; nullptr detaches (the loop stops
+  // until a new window arrives). Does not own the Java Surface.
+  void setWindow(ANativeWindow *window);
+
+  bool openFd(int fd, int64_t offset, int64_t length);
+  // Decodes the demuxer's first video track, starting from what is queued
+  // if that covers the clock position (no seek, which would also reposition
+  // a demuxer shared with audio).
+  bool open(std::shared_ptr<Demuxer> demuxer);
+  // Render gate. The first frame after open/seek is always shown, even
+  // while paused (seek preview).
+  void play();
+  void pause();
+  // `seekId`: see AudioEngine::seekUs.
+  void seekUs(int64_t us, uint32_t seekId);
+  // Accurate seek: frames between the sync sample and the seek target are
+  // decoded as fast as possible but never shown, and the first frame shown
+  // is the one at the target. Otherwise playback resumes at the sync sample.
+  void setAccurateSeek(bool accurate) {
+    accurateSeek_.store(accurate, std::memory_order_relaxed);
+  }
+  // Stops the loop and frees codec/extractor; the window is kept.
+  void stop();
+
+  int64_t durationUs() const { return durationUs_; }
+  bool isOpen() const { return codec_ != nullptr; }
+  Stats stats() const;
+  FramePacer::Stats pacingStats() const { return pacer_.stats(); }
+  std::string decoderName() const;
+
+private:
+  // A frame this far ahead of its slot is released with a timestamp and
+  // left to the compositor; further ahead, the loop waits first.
+  static constexpr int64_t kReleaseAheadUs = 50000;
+  // Later than this, the frame is dropped instead of shown.
+  static constexpr int64_t kDropLateUs = 40000;
+  static constexpr int64_t kDequeueTimeoutUs = 5000;
+  static constexpr int64_t kNoSeek = INT64_MIN;
+
+  VirtualClock *clock_ = nullptr;
+
+  /* Media (render thread while it runs) */
+  std::shared_ptr<Demuxer> demuxer_;
+  int32_t track_ = -1;
+  uint32_t demuxSerial_ = 0;
+  AMediaCodec *codec_ = nullptr;
+  AMediaFormat *format_ = nullptr;
+  int64_t durationUs_ = 0;
+  bool inputEos_ = false;
+  bool outputEos_ = false;
+  // Input buffer waiting for a packet (index < 0: none)
+  ssize_t inputIndex_ = -1;
+
+  // Output buffer waiting for its slot (index < 0: none)
+  ssize_t heldIndex_ = -1;
+  AMediaCodecBufferInfo heldInfo_{};
+  bool firstFrameShown_ = false;
+  // Frames before this PTS are released unshown (accurate seek, or starting
+  // from a queue that begins before the clock).
+  int64_t skipUntilUs_ = kNoSeek;
+  int64_t seekStartUs_ = 0; // seekUs() time being measured, 0 = none
+
+  /* Window */
+  std::mutex windowMutex_;
+  ANativeWindow *window_ = nullptr;
+
+  /* Threading */
+  std::thread thread_;
+  std::atomic<bool> threadRunning_{false};
+  std::atomic<bool> renderEnabled_{false};
+  std::atomic<int64_t> pendingSeekUs_{kNoSeek};
+  // Of the pending seek; Demuxer::seekUs only shares a seek when the
+  // position matches too, so a torn pair just seeks again.
+  std::atomic<uint32_t> pendingSeekId_{0};
+  std::atomic<int64_t> seekRequestUs_{0};
+  std::atomic<bool> accurateSeek_{false};
+  WakeEvent wakeEvent_;
+
+  /* Vsync pacing */
+  FramePacer pacer_;
+  std::thread vsyncThread_;
+  std::atomic<bool> vsyncRunning_{false};
+  std::mutex vsyncMutex_;
+  ALooper *vsyncLooper_ = nullptr; // vsyncMutex_
+  bool vsyncPosted_ = false;     // vsync thread
+  float windowFrameRate_ = 0.0f; // render thread
+
+  /* Stats */
+  std::atomic<int64_t> rendered_{0};
+  std::atomic<int64_t> dropped_{0};
+  std::atomic<int64_t> late_{0};
+  std::atomic<int64_t> skipped_{0};
+  std::atomic<int64_t> seekLatencyUs_{-1};
+  std::atomic<int32_t> width_{0};
+  std::atomic<int32_t> height_{0};
+  mutable std::mutex nameMutex_;
+  std::string decoderName_;
+
+  bool configureCodec(const char *mime, ANativeWindow *window);
+  void updateOutputFormat();
+  void startThread();
+  void stopThread();
+  void cleanupMedia();
+
+  void renderLoop();
+  void applySeek(int64_t us, uint32_t seekId);
+  void flushCodec(uint32_t serial);
+  bool feedInput();
+  void dequeueOutput(int64_t timeoutUs);
+  // Releases or waits for the held frame; returns the time to wait (us)
+  // before it is due, 0 if it was handled.
+  int64_t presentHeld();
+  void releaseHeld(bool render, int64_t atNs = -1);
+
+  void vsyncLoop();
+  void postVsyncCallback();
+  void wakeVsyncThread();
+  void updateWindowFrameRate(float fps);
+  static void onVsync64(int64_t frameTimeNanos, void *data);
+  static void onVsync(long frameTimeNanos, void *data);
+};
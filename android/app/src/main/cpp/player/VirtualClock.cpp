@@ -1,5 +1,7 @@
 #include "VirtualClock.h"
-#include <android/log.h>
+#include "core/NativeLog.h"
+
+#include <cmath>
 #include <cstdarg>
 #include <cstdio>
 #include <mutex>
@@ -21,7 +23,7 @@ void VirtualClock::log(const char *fmt, ...) {
   va_end(args);
 
   // Logcat
-  __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "%s", buf);
+  MX_LOGE(LOG_TAG, "%s", buf);
 
   // Store for UI
   std::lock_guard<std::mutex> lock(logMutex_);
@@ -37,57 +39,245 @@ void VirtualClock::getLastLog(char *buffer, size_t size) const {
   buffer[size - 1] = '\0';
 }
 
+/* ===================== Timeline ===================== */
+
+namespace {
+// Errors beyond this are discontinuities (start, seek, resume into a long
+// output latency), not drift: re-align instead of slewing for seconds.
+constexpr int64_t kResyncThresholdUs = 100000;
+// Proportional term: 1 ms of error -> 1000 ppm, i.e. corrected in ~1 s.
+constexpr double kSlewGainPpmPerUs = 1.0;
+// Integral term absorbs steady DAC-vs-monotonic drift (ppm per us*s).
+constexpr double kIntegralGain = 0.3;
+constexpr double kMaxIntegralPpm = 1000.0;
+// 0.5 %: far below what is visible on video or audible on A/V sync.
+constexpr int32_t kMaxSlewPpm = 5000;
+// Without a timestamp for this long the clock drops back to plain
+// monotonic rate.
+constexpr int64_t kAnchorTimeoutUs = 1000000;
+} // namespace
+
+void VirtualClock::rebaseLocked(State &s, int64_t now) {
+  s.offsetUs = positionAt(s, now);
+  s.baseUs = now;
+}
+
 void VirtualClock::start() {
   log("Clock start");
-  if (running_.exchange(true))
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  State s = state_.load();
+  if (s.running)
     return;
-  offsetUs_.store(0, std::memory_order_release);
-  baseUs_.store(nowUs(), std::memory_order_release);
+  s = {startBaseUs(), 0, 0, 1, rateMilli_};
+  state_.store(s);
+  realign_ = true;
 }
 
 void VirtualClock::pause() {
   log("Clock pause");
-  if (!running_.exchange(false))
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  State s = state_.load();
+  if (!s.running)
     return;
 
   // Accumulate elapsed time into offset
-  int64_t now = nowUs();
-  int64_t base = baseUs_.load(std::memory_order_acquire);
-  offsetUs_.fetch_add(now - base, std::memory_order_acq_rel);
+  rebaseLocked(s, nowUs());
+  s.running = 0;
+  state_.store(s);
 }
 
 void VirtualClock::resume() {
   log("Clock resume");
-  if (running_.exchange(true))
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  State s = state_.load();
+  if (s.running)
     return;
-  baseUs_.store(nowUs(), std::memory_order_release);
+  s.baseUs = startBaseUs();
+  s.running = 1;
+  state_.store(s);
+  realign_ = true;
 }
 
 void VirtualClock::seekUs(int64_t us) {
   log("Clock seek to %lld", (long long)us);
-  offsetUs_.store(us, std::memory_order_release);
-  baseUs_.store(nowUs(), std::memory_order_release);
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  State s = state_.load();
+  s.offsetUs = us;
+  s.baseUs = startBaseUs();
+  s.slewPpm = 0;
+  state_.store(s);
+  realign_ = true;
 }
 
 void VirtualClock::reset() {
   log("Clock reset");
-  running_.store(false, std::memory_order_release);
-  baseUs_.store(0, std::memory_order_release);
-  offsetUs_.store(0, std::memory_order_release);
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  state_.store(State{0, 0, 0, 0, rateMilli_});
+  integralPpm_ = 0.0;
+  realign_ = true;
+  lastSampleUs_ = 0;
+  sumSqErrorUs_ = 0.0;
+
+  anchored_.store(false, std::memory_order_relaxed);
+  lastErrorUs_.store(0, std::memory_order_relaxed);
+  maxAbsErrorUs_.store(0, std::memory_order_relaxed);
+  rmsErrorUs_.store(0, std::memory_order_relaxed);
+  samples_.store(0, std::memory_order_relaxed);
+  resyncs_.store(0, std::memory_order_relaxed);
+  timestampFailures_.store(0, std::memory_order_relaxed);
 }
 
 int64_t VirtualClock::positionUs() const {
-  if (!running_.load(std::memory_order_acquire)) {
-    return offsetUs_.load(std::memory_order_acquire);
+  return positionAt(state_.load(), nowUs());
+}
+
+bool VirtualClock::isPaused() const { return !state_.load().running; }
+
+bool VirtualClock::isRunning() const { return state_.load().running != 0; }
+
+/* ===================== Audio anchoring ===================== */
+
+void VirtualClock::setMode(Mode mode) {
+  mode_.store(mode, std::memory_order_relaxed);
+  if (mode == Mode::Monotonic) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    State s = state_.load();
+    rebaseLocked(s, nowUs());
+    s.slewPpm = 0;
+    state_.store(s);
+    integralPpm_ = 0.0;
+    anchored_.store(false, std::memory_order_relaxed);
   }
-  return offsetUs_.load(std::memory_order_acquire) +
-         (nowUs() - baseUs_.load(std::memory_order_acquire));
 }
 
-bool VirtualClock::isPaused() const {
-  return !running_.load(std::memory_order_acquire);
+void VirtualClock::setRate(float rate) {
+  int32_t milli = static_cast<int32_t>(std::lround(rate * 1000.0f));
+  if (milli <= 0)
+    return;
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  if (milli == rateMilli_)
+    return;
+  log("Clock rate %d.%03dx", milli / 1000, milli % 1000);
+  rateMilli_ = milli;
+  State s = state_.load();
+  // A base in the future (latency hold) stays put: nothing elapsed yet.
+  int64_t now = nowUs();
+  if (now > s.baseUs)
+    rebaseLocked(s, now);
+  s.rateMilli = milli;
+  state_.store(s);
+  // Audio restarts at the new rate; its first timestamps re-anchor.
+  realign_ = true;
+}
+
+float VirtualClock::rate() const {
+  return static_cast<float>(state_.load().rateMilli) / 1000.0f;
+}
+
+void VirtualClock::setOutputLatencyUs(int64_t us) {
+  outputLatencyUs_.store(us > 0 ? us : 0, std::memory_order_relaxed);
+}
+
+// Anchored: the first audio reaches the DAC one output latency from now,
+// so the timeline starts moving then. Timestamps refine it once they come.
+int64_t VirtualClock::startBaseUs() const {
+  int64_t now = nowUs();
+  if (mode() != Mode::AudioAnchored)
+    return now;
+  return now + outputLatencyUs_.load(std::memory_order_relaxed);
+}
+
+void VirtualClock::requestRealign() {
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  realign_ = true;
+}
+
+void VirtualClock::syncToAudio(int64_t audioUs, int64_t atUs) {
+  if (mode() != Mode::AudioAnchored)
+    return;
+
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  State s = state_.load();
+  if (!s.running)
+    return;
+
+  int64_t now = nowUs();
+  int64_t expected = audioUs + (now - atUs) * s.rateMilli / 1000;
+  int64_t error = expected - positionAt(s, now);
+  double dtS = lastSampleUs_ > 0 ? (now - lastSampleUs_) / 1e6 : 0.0;
+  lastSampleUs_ = now;
+  anchored_.store(true, std::memory_order_relaxed);
+  lastErrorUs_.store(error, std::memory_order_relaxed);
+
+  if (realign_ || error > kResyncThresholdUs || error < -kResyncThresholdUs) {
+    // Discontinuity: jump once, then track by slewing.
+    s.offsetUs = expected;
+    s.baseUs = now;
+    s.slewPpm = 0;
+    state_.store(s);
+    integralPpm_ = 0.0;
+    resyncs_.fetch_add(1, std::memory_order_relaxed);
+    if (!realign_) {
+      log("Clock resync (error %lld us)", (long long)error);
+    }
+    realign_ = false;
+    return;
+  }
+
+  // PI controller on the rate, applied from `now` on (no position jump).
+  integralPpm_ += kIntegralGain * double(error) * dtS;
+  if (integralPpm_ > kMaxIntegralPpm)
+    integralPpm_ = kMaxIntegralPpm;
+  if (integralPpm_ < -kMaxIntegralPpm)
+    integralPpm_ = -kMaxIntegralPpm;
+  double ppm = kSlewGainPpmPerUs * double(error) + integralPpm_;
+  if (ppm > kMaxSlewPpm)
+    ppm = kMaxSlewPpm;
+  if (ppm < -kMaxSlewPpm)
+    ppm = -kMaxSlewPpm;
+
+  rebaseLocked(s, now);
+  s.slewPpm = static_cast<int32_t>(ppm);
+  state_.store(s);
+
+  int64_t absError = error < 0 ? -error : error;
+  if (absError > maxAbsErrorUs_.load(std::memory_order_relaxed))
+    maxAbsErrorUs_.store(absError, std::memory_order_relaxed);
+  int64_t n = samples_.fetch_add(1, std::memory_order_relaxed) + 1;
+  sumSqErrorUs_ += double(error) * double(error);
+  rmsErrorUs_.store(static_cast<int64_t>(std::sqrt(sumSqErrorUs_ / n)),
+                    std::memory_order_relaxed);
+}
+
+void VirtualClock::noteTimestampUnavailable() {
+  timestampFailures_.fetch_add(1, std::memory_order_relaxed);
+
+  std::lock_guard<std::mutex> lock(writeMutex_);
+  int64_t now = nowUs();
+  if (!anchored_.load(std::memory_order_relaxed) ||
+      now - lastSampleUs_ < kAnchorTimeoutUs)
+    return;
+
+  // Fallback: keep the position, run at monotonic rate again.
+  State s = state_.load();
+  rebaseLocked(s, now);
+  s.slewPpm = 0;
+  state_.store(s);
+  integralPpm_ = 0.0;
+  realign_ = true;
+  anchored_.store(false, std::memory_order_relaxed);
+  log("Clock: no audio timestamps, monotonic fallback");
 }
 
-bool VirtualClock::isRunning() const {
-  return running_.load(std::memory_order_acquire);
+VirtualClock::SyncStats VirtualClock::syncStats() const {
+  SyncStats st{};
+  st.anchored = anchored_.load(std::memory_order_relaxed);
+  st.lastErrorUs = lastErrorUs_.load(std::memory_order_relaxed);
+  st.maxAbsErrorUs = maxAbsErrorUs_.load(std::memory_order_relaxed);
+  st.rmsErrorUs = rmsErrorUs_.load(std::memory_order_relaxed);
+  st.slewPpm = state_.load().slewPpm;
+  st.samples = samples_.load(std::memory_order_relaxed);
+  st.resyncs = resyncs_.load(std::memory_order_relaxed);
+  st.timestampFailures = timestampFailures_.load(std::memory_order_relaxed);
+  return st;
 }
@@ -4,8 +4,30 @@
 #include <cstring>
 #include <mutex>
 
+#include "core/ClockPage.h"
+
 class VirtualClock {
 public:
+  // Monotonic: wall time since start (CLOCK_MONOTONIC).
+  // AudioAnchored: same timeline, but slewed towards the position of the
+  // audio actually reaching the DAC (AAudio timestamps fed through
+  // syncToAudio). Falls back to Monotonic behaviour while no timestamps
+  // arrive, except that start/resume/seek hold the timeline back by the
+  // output latency (audio written from then on is heard that much later).
+  enum class Mode : int32_t { Monotonic = 0, AudioAnchored = 1 };
+
+  // Drift/error statistics of the audio-anchored mode (since reset()).
+  struct SyncStats {
+    bool anchored;         // timestamps currently steering the clock
+    int64_t lastErrorUs;   // audio - clock at the last sample
+    int64_t maxAbsErrorUs; // over samples that did not trigger a resync
+    int64_t rmsErrorUs;
+    int32_t slewPpm; // current rate correction
+    int64_t samples;
+    int64_t resyncs;           // hard re-alignments (start/seek/large jumps)
+    int64_t timestampFailures; // getTimestamp calls that returned nothing
+  };
+
   void start();
   void pause();
   void resume();
@@ -16,18 +38,77 @@ public:
   bool isPaused() const;
   bool isRunning() const;
 
+  void setMode(Mode mode);
+  Mode mode() const { return mode_.load(std::memory_order_relaxed); }
+
+  // Audio position `audioUs` was presented at monotonic time `atUs`. Called
+  // by the engine every few tens of ms while audio plays (not realtime).
+  void syncToAudio(int64_t audioUs, int64_t atUs);
+  // The engine polled for a timestamp and got none.
+  void noteTimestampUnavailable();
+  // Latency between the audio callback and the DAC (us), kept up to date by
+  // the engine. Applied at the next start/resume/seek in AudioAnchored mode.
+  void setOutputLatencyUs(int64_t us);
+  int64_t outputLatencyUs() const {
+    return outputLatencyUs_.load(std::memory_order_relaxed);
+  }
+  // Playback rate (1 = real time). Rebases at now, so the position never
+  // jumps; kept across reset() (a new file plays at the chosen speed).
+  void setRate(float rate);
+  float rate() const;
+  // Next syncToAudio re-aligns hard instead of slewing (new audio segment:
+  // start, seek, resume after an underrun).
+  void requestRealign();
+
+  SyncStats syncStats() const;
+
+  // The published timeline, for readers that cannot afford a call (the
+  // Kotlin video loop maps it as a direct ByteBuffer).
+  ClockPage &page() { return state_; }
+
   // Debugging
   void getLastLog(char *buffer, size_t size) const;
 
+  static int64_t nowUs();
+
 private:
   void log(const char *fmt, ...);
 
-  std::atomic<bool> running_{false};
-  std::atomic<int64_t> baseUs_{0};
-  std::atomic<int64_t> offsetUs_{0};
+  // Timeline: position = offsetUs + (now - baseUs) * rate * (1 + slewPpm / 1e6)
+  // while running. Published as one snapshot so readers never see a torn
+  // mix of fields; writers serialize on writeMutex_.
+  using State = ClockPage::Snapshot;
+
+  static int64_t positionAt(const State &s, int64_t nowUs) {
+    return ClockPage::positionAt(s, nowUs);
+  }
+  // Rebase at `now` so a rate change never moves the position.
+  void rebaseLocked(State &s, int64_t now);
+  // baseUs for a timeline (re)started now.
+  int64_t startBaseUs() const;
+
+  ClockPage state_;
+  std::mutex writeMutex_;
+
+  std::atomic<Mode> mode_{Mode::AudioAnchored};
+  std::atomic<int64_t> outputLatencyUs_{0};
+  int32_t rateMilli_ = 1000; // writeMutex_
+
+  /* Slew controller (writeMutex_) */
+  double integralPpm_ = 0.0;
+  bool realign_ = true;
+  int64_t lastSampleUs_ = 0;
+
+  /* Stats */
+  std::atomic<bool> anchored_{false};
+  std::atomic<int64_t> lastErrorUs_{0};
+  std::atomic<int64_t> maxAbsErrorUs_{0};
+  std::atomic<int64_t> samples_{0};
+  std::atomic<int64_t> resyncs_{0};
+  std::atomic<int64_t> timestampFailures_{0};
+  double sumSqErrorUs_ = 0.0; // writeMutex_
+  std::atomic<int64_t> rmsErrorUs_{0};
 
   mutable std::mutex logMutex_;
   char lastLog_[256] = "Ready";
-
-  static int64_t nowUs();
 };
@@ -16,7 +16,7 @@ class AudioCodecEngine : PlaybackClock {
 
     // 🔑 MASTER CLOCK: use native VirtualClock
     override val positionMs: Long
-        get() = NativePlayer.virtualClockUs() / 1000
+        get() = ClockSnapshot.positionUs() / 1000
 
     /* ───────── Public API ───────── */
 
@@ -0,0 +1,65 @@
+package com.mxlite.app.player
+
+import android.os.Build
+import androidx.annotation.RequiresApi
+import java.lang.invoke.VarHandle
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Lock-free reader of the native master clock.
+ *
+ * The native VirtualClock publishes its timeline into a small seqlock page
+ * (core/ClockPage.h) mapped here as a direct ByteBuffer. Reading it is a few
+ * loads plus System.nanoTime() (CLOCK_MONOTONIC, the clock's own base), so
+ * the video sync loop no longer pays a JNI transition per query and always
+ * sees a consistent timeline, even while a seek-drag rewrites it.
+ *
+ * Needs VarHandle fences (API 33+); older devices use the JNI call.
+ */
+object ClockSnapshot {
+    // Byte offsets, see core/ClockPage.h
+    private const val SEQ = 0
+    private const val RUNNING = 4
+    private const val BASE_US = 8
+    private const val OFFSET_US = 16
+    private const val SLEW_PPM = 24
+    private const val RATE_MILLI = 28
+
+    // A writer holds the page for a few ns; give up quickly anyway.
+    private const val MAX_RETRIES = 64
+
+    private val page: ByteBuffer? by lazy {
+        NativePlayer.clockPage()?.order(ByteOrder.LITTLE_ENDIAN)
+    }
+
+    fun positionUs(): Long {
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) {
+            page?.let { return readPage(it) }
+        }
+        return NativePlayer.virtualClockUs()
+    }
+
+    @RequiresApi(Build.VERSION_CODES.TIRAMISU)
+    private fun readPage(buf: ByteBuffer): Long {
+        repeat(MAX_RETRIES) {
+            val seq = buf.getInt(SEQ)
+            if (seq and 1 != 0) return@repeat
+            VarHandle.acquireFence()
+            val running = buf.getInt(RUNNING)
+            val baseUs = buf.getLong(BASE_US)
+            val offsetUs = buf.getLong(OFFSET_US)
+            val slewPpm = buf.getInt(SLEW_PPM)
+            val rateMilli = buf.getInt(RATE_MILLI)
+            VarHandle.acquireFence()
+            if (buf.getInt(SEQ) != seq) return@repeat
+
+            if (running == 0) return offsetUs
+            // A base in the future holds the position (output latency).
+            val elapsed = maxOf(0L, System.nanoTime() / 1000 - baseUs)
+            val media = elapsed * rateMilli / 1000
+            return offsetUs + media + media * slewPpm / 1_000_000
+        }
+        return NativePlayer.virtualClockUs()
+    }
+}
@@ -1,18 +1,198 @@
 package com.mxlite.app.player
 
 object NativeAudioDebug {
+    // Previous sample of the decode-thread wakeup counter (for wakeups/s)
+    private var lastWakeups = 0L
+    private var lastWakeupsNs = 0L
+
+    private fun decodeWakeupsPerSec(): Long {
+        val wakeups = NativePlayer.dbgDecodeWakeups()
+        val now = System.nanoTime()
+        val elapsedNs = now - lastWakeupsNs
+        val rate = if (lastWakeupsNs != 0L && elapsedNs > 0) {
+            (wakeups - lastWakeups) * 1_000_000_000L / elapsedNs
+        } else 0L
+        lastWakeups = wakeups
+        lastWakeupsNs = now
+        return rate
+    }
+
+    private fun resampleText(): String {
+        val from = NativePlayer.dbgResampleFromHz()
+        val to = NativePlayer.dbgStreamSampleRate()
+        return if (from > 0) "$from -> $to Hz" else "OFF ($to Hz)"
+    }
+
+    private fun clockSyncText(): String {
+        val st = NativePlayer.dbgClockStats()
+        if (st.size < 8) return "?"
+        val state = if (st[0] != 0L) "ANCHORED" else "FREE"
+        return "$state err=${st[1]}us rms=${st[3]}us max=${st[2]}us " +
+            "slew=${st[4]}ppm resyncs=${st[6]}"
+    }
+
+    private fun videoText(): String {
+        val st = NativePlayer.dbgVideoStats()
+        if (st.size < 5) return "?"
+        return "${st[3]}x${st[4]} rendered=${st[0]} dropped=${st[1]} late=${st[2]}"
+    }
+
+    private fun pacingText(): String {
+        val st = NativePlayer.dbgVideoPacing()
+        if (st.size < 12) return "?"
+        if (st[0] <= 0L) return "NO VSYNC"
+        val hz = 1_000_000_000.0 / st[0]
+        val fps = st[1] / 1000.0
+        val hist = st.copyOfRange(5, 12).joinToString("/")
+        return "%.1f fps @ %.1f Hz cadence=%d janks=%d/%d hist=%s"
+            .format(fps, hz, st[2], st[4], st[3], hist)
+    }
+
+    private fun demuxText(): String {
+        val st = NativePlayer.dbgDemuxStats()
+        if (st.size < 6) return "?"
+        return "open=${st[5] / 1000}ms queued=${st[0] / 1024}KB " +
+            "read=${st[1] / 1024}KB seeks=${st[3]} shared=${st[4]}"
+    }
+
+    private fun seekText(): String {
+        val st = NativePlayer.dbgSeekStats()
+        if (st.size < 4) return "?"
+        fun latency(us: Long) = if (us < 0) "-" else "${us / 1000}ms"
+        val applied = if (st.size >= 6) " applied=${st[5]}/${st[4]}" else ""
+        val tracks = if (st.size >= 8 && st[6] > 0L) {
+            " track=${latency(st[7])} (${st[6]})"
+        } else ""
+        val dropped = if (st.size >= 9 && st[8] > 0L) " dropped=${st[8]}" else ""
+        return "audio=${latency(st[0])} skipped=${st[1]} " +
+            "video=${latency(st[2])} skipped=${st[3]}$applied$tracks$dropped"
+    }
+
+    private fun rewindCacheText(): String {
+        val st = NativePlayer.dbgRewindCache()
+        if (st.size < 3) return "?"
+        if (st[1] <= 0L) return "OFF"
+        return "%.1f/%.1fs hits=%d".format(st[0] / 1e6, st[1] / 1e6, st[2])
+    }
+
+    private fun gaplessText(): String {
+        val st = NativePlayer.dbgGapless()
+        if (st.size < 4) return "?"
+        val next = when {
+            st[0] != 0L -> "ready in %.0fms".format(st[1] / 1000.0)
+            st[1] < 0L -> "preparing"
+            else -> "none"
+        }
+        return "next=$next switches=${st[2]} xfade=${st[3] / 1000}ms"
+    }
+
+    private fun openText(): String {
+        val st = NativePlayer.dbgOpenTimings()
+        if (st.size < 6) return "?"
+        fun ms(us: Long) = if (us < 0) "-" else "%.1f".format(us / 1000.0)
+        return "demux=${ms(st[0])} codec=${ms(st[1])} out=${ms(st[2])} " +
+            "warm=${ms(st[3])} ready=${ms(st[4])} audio=${ms(st[5])}ms"
+    }
+
+    private fun codecPoolText(): String {
+        val st = NativePlayer.dbgCodecPool()
+        if (st.size < 3) return "?"
+        return "reused=${st[0]} created=${st[1]} idle=${st[2]}"
+    }
+
+    private fun rtMetricsText(): String {
+        val st = NativePlayer.dbgAudioMetrics()
+        val histSize = 3 + 20
+        if (st.size < 8 + 3 * histSize) return "?"
+        // "avg/max" in ms of the histogram starting at `at`
+        fun hist(at: Int): String {
+            val count = st[at]
+            if (count == 0L) return "-"
+            return "%.1f/%.1f".format(st[at + 1] / count / 1000.0, st[at + 2] / 1000.0)
+        }
+        val fill = if (st[3] < 0L) "-" else "${st[3]}..${st[4]}"
+        return "cb=${st[0]} period=${hist(8)} dur=${hist(8 + histSize)}ms " +
+            "underruns=${st[1]} (${st[2]}f) xruns=${st[5]} fill=$fill " +
+            "drops=${st[6]} short=${st[7]} decode=${hist(8 + 2 * histSize)}ms"
+    }
+
+    private var lastPowerNs = 0L
+    private var lastPowerWakeups = 0L
+    private var lastPowerCallbacks = 0L
+
+    private fun powerText(): String {
+        val st = NativePlayer.dbgPower()
+        if (st.size < 4) return "?"
+        val now = System.nanoTime()
+        val elapsedNs = now - lastPowerNs
+        // Per minute since the last overlay refresh (counters restart on a
+        // new file: no rate then)
+        fun perMin(count: Long, last: Long) =
+            if (lastPowerNs != 0L && elapsedNs > 0 && count >= last) {
+                (count - last) * 60_000_000_000L / elapsedNs
+            } else 0L
+        val wakeups = perMin(st[2], lastPowerWakeups)
+        val callbacks = perMin(st[3], lastPowerCallbacks)
+        lastPowerNs = now
+        lastPowerWakeups = st[2]
+        lastPowerCallbacks = st[3]
+        val mode = when (st[1]) { 1L -> "lowlat"; 2L -> "powersave"; else -> "default" }
+        return "$mode deep=${if (st[0] != 0L) "ON" else "OFF"} " +
+            "decodeWakeups/min=$wakeups callbacks/min=$callbacks"
+    }
+
+    private fun audioOutputText(): String {
+        val st = NativePlayer.dbgAudioOutput()
+        if (st.size < 4 || st[0] < 0L) return "?"
+        val how = if (st[1] != 0L) "reused" else "opened"
+        val text = "$how in %.1fms opens=%d reuses=%d".format(st[0] / 1000.0, st[2], st[3])
+        if (st.size < 8) return text
+        // AAUDIO_PERFORMANCE_MODE_POWER_SAVING / _LOW_LATENCY
+        val mode = (if (st[4] != 0L) "excl" else "shared") +
+            when (st[5]) { 11L -> "/powersave"; 12L -> "/lowlat"; else -> "" }
+        return "$text $mode buf=${st[6]}/${st[7]}f " +
+            "latency=${NativePlayer.outputLatencyUs() / 1000}ms"
+    }
+
+    private fun dspText(): String {
+        val st = NativePlayer.dbgDsp()
+        if (st.size < 5) return "?"
+        return "boost=+%.1fdB eq=%s night=%s comp=-%.1fdB lim=-%.1fdB".format(
+            st[0] / 100.0, if (st[1] != 0L) "on" else "off",
+            if (st[2] != 0L) "on" else "off", st[3] / 100.0, st[4] / 100.0)
+    }
+
     fun snapshot(engine: PlayerEngine? = null, hasSurface: Boolean = false): String {
         val decodeActive = NativePlayer.dbgDecodeActive()
         return """
 Surface=$hasSurface
 ENGINE PLAYING=${engine?.isPlaying ?: "null"}
 DECODE ACTIVE = $decodeActive
+DECODE WAKEUPS/S = ${decodeWakeupsPerSec()}
+DECODE MODE = ${if (NativePlayer.dbgDecodeMode() == 1) "ASYNC" else "SYNC"}
+FIRST AUDIO US = ${NativePlayer.dbgFirstAudioUs()}
+RESAMPLE = ${resampleText()}
+CHANNELS = ${NativePlayer.dbgCodecChannels()} -> ${NativePlayer.dbgStreamChannels()}
 decoderProduced=${NativePlayer.dbgDecoderProduced()}
 audioOpened=${NativePlayer.dbgAAudioOpened()}
 audioStarted=${NativePlayer.dbgAAudioStarted()}
+AUDIO OUTPUT = ${audioOutputText()}
+OPEN = ${openText()}
+CODEC POOL = ${codecPoolText()}
+RT METRICS = ${rtMetricsText()}
+POWER = ${powerText()}
+DSP = ${dspText()}
 callbackCalled=${NativePlayer.dbgCallbackCalled()}
 CLOCK US = ${NativePlayer.virtualClockUs()}
+CLOCK SYNC = ${clockSyncText()}
+OUTPUT LATENCY US = ${NativePlayer.dbgOutputLatencyUs()}
 CLOCK LOG = ${NativePlayer.dbgGetClockLog()}
+DEMUX = ${demuxText()}
+SEEK = ${seekText()}
+REWIND CACHE = ${rewindCacheText()}
+GAPLESS = ${gaplessText()}
+VIDEO = ${videoText()}
+PACING = ${pacingText()}
         """.trimIndent()
     }
 }
@@ -8,7 +8,7 @@ import java.util.concurrent.atomic.AtomicBoolean
  */
 class NativeClock : PlaybackClock {
     override val positionMs: Long
-    get() = NativePlayer.virtualClockUs() / 1000
+    get() = ClockSnapshot.positionUs() / 1000
 }
 
 /**
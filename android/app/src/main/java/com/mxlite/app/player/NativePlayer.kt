@@ -5,11 +5,23 @@ import android.media.AudioAttributes
 import android.media.AudioFocusRequest
 import android.media.AudioManager
 import android.os.ParcelFileDescriptor
+import android.view.Surface
 import java.io.File
+import java.nio.ByteBuffer
+import kotlin.math.log10
 
 object NativePlayer {
+    // Audio decoders created in the background when the library loads, so
+    // the first open of these types skips decoder creation (see
+    // nativePrewarmDecoders). Set to false to create them on demand only.
+    private const val PREWARM_DECODERS_ON_LOAD = true
+    private val PREWARM_DECODER_MIMES = arrayOf("audio/mp4a-latm", "audio/opus", "audio/mpeg")
+
     init {
         System.loadLibrary("mxplayer")
+        if (PREWARM_DECODERS_ON_LOAD) {
+            nativePrewarmDecoders(PREWARM_DECODER_MIMES)
+        }
     }
 
     private var audioManager: AudioManager? = null
@@ -31,6 +43,30 @@ object NativePlayer {
         playFdJni(fd, offset, length)
         initialized = true
     }
+
+    // Like playFd but returns at once: the file is parsed, the decoder set
+    // up and the audio output created on a native thread (the output in
+    // parallel with the rest). Pause/resume/seek made meanwhile apply when
+    // it is ready; poll openState(). The fd is dup()'d before returning.
+    const val OPEN_FAILED = -1
+    const val OPEN_IDLE = 0
+    const val OPEN_OPENING = 1
+    const val OPEN_READY = 2
+
+    private external fun nativePlayFdAsync(fd: Int, offset: Long, length: Long)
+    private external fun nativeOpenState(): Int
+
+    fun playFdAsync(fd: Int, offset: Long, length: Long) {
+        nativePlayFdAsync(fd, offset, length)
+        initialized = true
+    }
+
+    fun openState(): Int = nativeOpenState()
+
+    // Released audio decoders are kept stopped in a native pool and reused
+    // by the next open of the same MIME type (no decoder creation). This
+    // fills it ahead of the first open.
+    private external fun nativePrewarmDecoders(mimes: Array<String>)
     private external fun nativeStop()
     external fun nativeSeek(positionUs: Long)
     private external fun nativeRelease()
@@ -39,6 +75,191 @@ object NativePlayer {
     external fun nativeResume()
     external fun nativeGetDurationMs(): Long
 
+    // Async MediaCodec audio decode (API 28+, falls back to sync). Applies
+    // from the next play; keep it on except for A/B comparisons.
+    private external fun nativeSetAsyncDecode(enabled: Boolean)
+
+    fun setAsyncDecode(enabled: Boolean) {
+        nativeSetAsyncDecode(enabled)
+    }
+
+    // AAudio output mode, from the next play.
+    // LOW_LATENCY asks for an exclusive, low-latency stream (falling back to
+    // shared, then to the default stream) whose buffer grows on glitches and
+    // shrinks again while playback is stable.
+    // POWER_SAVING asks for a power-saving stream with a large buffer and
+    // also turns on deep buffering (see setDeepBuffer) at once.
+    // outputLatencyUs() is the resulting callback-to-DAC latency the clock
+    // compensates for.
+    const val OUTPUT_MODE_DEFAULT = 0
+    const val OUTPUT_MODE_LOW_LATENCY = 1
+    const val OUTPUT_MODE_POWER_SAVING = 2
+
+    private external fun nativeSetOutputMode(mode: Int)
+    private external fun nativeOutputLatencyUs(): Long
+
+    fun setOutputMode(mode: Int) {
+        nativeSetOutputMode(mode)
+    }
+
+    fun outputLatencyUs(): Long = nativeOutputLatencyUs()
+
+    // Deep buffering: audio is decoded several seconds ahead in batches and
+    // the decode thread sleeps in between, instead of topping the buffer up
+    // every few ms. Fewer wakeups, for screen-off and audio-only playback.
+    // Applies at once.
+    private external fun nativeSetDeepBuffer(enabled: Boolean)
+
+    fun setDeepBuffer(enabled: Boolean) {
+        nativeSetDeepBuffer(enabled)
+    }
+
+    // Playback speed, 0.5x to 3x, pitch preserved (time-stretched audio).
+    // Applies at once without pausing; video follows through the clock.
+    // Kept for the following files.
+    const val MIN_PLAYBACK_RATE = 0.5f
+    const val MAX_PLAYBACK_RATE = 3.0f
+
+    private external fun nativeSetPlaybackRate(rate: Float)
+    private external fun nativePlaybackRate(): Float
+
+    fun setPlaybackRate(rate: Float) {
+        nativeSetPlaybackRate(rate.coerceIn(MIN_PLAYBACK_RATE, MAX_PLAYBACK_RATE))
+    }
+
+    fun playbackRate(): Float = nativePlaybackRate()
+
+    // Output DSP: volume boost, 10-band EQ and night mode (compressor), with
+    // a limiter so boosted audio does not clip. Applies at once and to the
+    // following files.
+    const val MAX_VOLUME_BOOST_PERCENT = 400
+    const val MAX_EQ_GAIN_DB = 12f
+    val EQ_BAND_HZ = intArrayOf(31, 62, 125, 250, 500, 1000, 2000, 4000, 8000, 16000)
+
+    private external fun nativeSetVolumeBoost(db: Float)
+    private external fun nativeSetEqualizer(enabled: Boolean, gainsDb: FloatArray)
+    private external fun nativeSetNightMode(enabled: Boolean)
+
+    // 100 = unchanged, up to MAX_VOLUME_BOOST_PERCENT (+12 dB).
+    fun setVolumeBoost(percent: Int) {
+        val p = percent.coerceIn(100, MAX_VOLUME_BOOST_PERCENT)
+        nativeSetVolumeBoost((20.0 * log10(p / 100.0)).toFloat())
+    }
+
+    // One gain per EQ_BAND_HZ entry, +-MAX_EQ_GAIN_DB.
+    fun setEqualizer(enabled: Boolean, gainsDb: FloatArray) {
+        nativeSetEqualizer(enabled, FloatArray(EQ_BAND_HZ.size) { i ->
+            gainsDb.getOrElse(i) { 0f }.coerceIn(-MAX_EQ_GAIN_DB, MAX_EQ_GAIN_DB)
+        })
+    }
+
+    fun setNightMode(enabled: Boolean) {
+        nativeSetNightMode(enabled)
+    }
+
+    // Switches the playing file to another of its audio tracks
+    // (AudioTrackInfo.trackIndex) without reopening: output and clock keep
+    // running, the new track joins at the current position. Returns false
+    // if the file has no such audio track.
+    private external fun nativeSelectAudioTrack(trackIndex: Int): Boolean
+
+    fun selectAudioTrack(trackIndex: Int): Boolean =
+        nativeSelectAudioTrack(trackIndex)
+
+    // Quality of the native resampler used when the device's native rate
+    // differs from the track's. Applies from the next play.
+    const val RESAMPLER_LOW = 0
+    const val RESAMPLER_MEDIUM = 1
+    const val RESAMPLER_HIGH = 2
+
+    private external fun nativeSetResamplerQuality(quality: Int)
+
+    fun setResamplerQuality(quality: Int) {
+        nativeSetResamplerQuality(quality)
+    }
+
+    // Downmix of multichannel tracks on devices with fewer output channels.
+    // centerGain > 1 boosts dialog; lfeGain > 0 mixes the LFE channel in
+    // (the ITU default drops it). Linear gains, applies from the next play.
+    private external fun nativeSetDownmixGains(centerGain: Float, lfeGain: Float)
+
+    fun setDownmixGains(centerGain: Float = 1f, lfeGain: Float = 0f) {
+        nativeSetDownmixGains(centerGain, lfeGain)
+    }
+
+    // Decoded audio kept in memory so rewinds (skip back, small seek-bar
+    // nudges) play from it without flushing the decoder. Up to maxMs, fewer
+    // if that would take more than maxMb; 0 ms turns it off. Applies from
+    // the next play.
+    private external fun nativeSetRewindCache(maxMs: Long, maxMb: Int)
+
+    fun setRewindCache(maxMs: Long = 20_000L, maxMb: Int = 16) {
+        nativeSetRewindCache(maxMs, maxMb)
+    }
+
+    // Accurate seek lands on the exact position: audio and video decode from
+    // the preceding key frame and discard everything before the target.
+    // Off (default) resumes at the key frame, which is faster. Applies from
+    // the next seek.
+    private external fun nativeSetAccurateSeek(enabled: Boolean)
+
+    fun setAccurateSeek(enabled: Boolean) {
+        nativeSetAccurateSeek(enabled)
+    }
+
+    // Gapless playback: opens the next item while the current one plays
+    // (decoder created and primed in the background) and switches to it
+    // inside the same audio stream when the current one ends (itemSerial
+    // changes). The native side keeps its own dup of the fd; the video
+    // decoder opens on the caller's once the item took over. False if it
+    // has no audio track or the current item is still opening.
+    private external fun nativePrepareNextFd(fd: Int, offset: Long, length: Long): Boolean
+    fun prepareNextFd(fd: Int, offset: Long, length: Long): Boolean =
+        nativePrepareNextFd(fd, offset, length)
+    private external fun nativeCancelNext()
+    fun cancelNext() {
+        nativeCancelNext()
+    }
+    // Changes each time a prepared item took over; reset by every play.
+    private external fun nativeItemSerial(): Int
+    fun itemSerial(): Int = nativeItemSerial()
+    // Equal-power overlap of the two items at a gapless switch, up to
+    // 500 ms; 0 (default) plays them back to back. Applies from the next
+    // switch.
+    private external fun nativeSetGaplessCrossfade(ms: Long)
+    fun setGaplessCrossfade(ms: Long) {
+        nativeSetGaplessCrossfade(ms)
+    }
+
+    // Master clock source. AUDIO (default) slews the clock towards the
+    // presentation timestamps of the audio output so video follows what is
+    // actually heard; MONOTONIC is plain wall time. Applies immediately.
+    const val CLOCK_MONOTONIC = 0
+    const val CLOCK_AUDIO = 1
+
+    private external fun nativeSetClockMode(mode: Int)
+
+    fun setClockMode(mode: Int) {
+        nativeSetClockMode(mode)
+    }
+
+    // Read-only view of the native clock's seqlock page; read it through
+    // ClockSnapshot, never directly.
+    private external fun nativeClockPage(): ByteBuffer?
+
+    internal fun clockPage(): ByteBuffer? = nativeClockPage()
+
+    // Native video decode/render (VideoEngine). Used through
+    // NativeVideoDecoder; the engine shares the audio master clock.
+    internal external fun nativeVideoSetSurface(surface: Surface?)
+    internal external fun nativeVideoOpenFd(fd: Int, offset: Long, length: Long): Boolean
+    internal external fun nativeVideoPlay()
+    internal external fun nativeVideoPause()
+    internal external fun nativeVideoSeek(positionUs: Long)
+    internal external fun nativeVideoStop()
+    internal external fun nativeVideoRelease()
+    internal external fun nativeVideoDurationUs(): Long
+
     var initialized = false
         private set
 
@@ -112,7 +333,67 @@ object NativePlayer {
     external fun dbgNativePlayCalled(): Boolean
     external fun dbgBufferFill(): Int
     external fun dbgDecodeActive(): Boolean
+    external fun dbgDecodeWakeups(): Long
+    // 0 = sync (polling), 1 = async (MediaCodec callbacks)
+    external fun dbgDecodeMode(): Int
+    // First start → first callback with decoded audio, -1 until it happens
+    external fun dbgFirstAudioUs(): Long
+    // Decoder rate being resampled (0 = none) and the stream's native rate
+    external fun dbgResampleFromHz(): Int
+    external fun dbgStreamSampleRate(): Int
+    // Decoder vs. AAudio stream channel counts (differ when downmixing)
+    external fun dbgCodecChannels(): Int
+    external fun dbgStreamChannels(): Int
+    // Written-but-not-yet-audible audio, from AAudio timestamps
+    external fun dbgOutputLatencyUs(): Long
+    // [anchored, lastErrorUs, maxAbsErrorUs, rmsErrorUs, slewPpm, samples,
+    //  resyncs, timestampFailures]
+    external fun dbgClockStats(): LongArray
     external fun dbgGetClockLog(): String
+    // [rendered, dropped, late, width, height, skipped, seekLatencyUs] of the
+    // native video loop
+    external fun dbgVideoStats(): LongArray
+    external fun dbgVideoDecoderName(): String
+    // [vsyncPeriodNs, contentFps * 1000, cadence, frames, janks,
+    //  histogram[0..6]]; histogram counts vsyncs on screen, [0] = dropped
+    external fun dbgVideoPacing(): LongArray
+    // [queuedBytes, bytesRead, packetsRead, seeks, coalescedSeeks, openUs]
+    // of the demuxer shared by audio and video
+    external fun dbgDemuxStats(): LongArray
+    // Last accurate seek: [audioLatencyUs, audioSkippedFrames,
+    //  videoLatencyUs, videoSkippedFrames]; latency -1 = none yet. Then
+    //  [seeksPosted, seeksApplied] of the audio engine's command queue and
+    //  [trackSwitches, trackSwitchUs] of live audio-track switches, then
+    //  [commandsDropped] (command queue stayed full)
+    external fun dbgSeekStats(): LongArray
+    // [heldUs, capacityUs, hits] of the decoded-audio rewind cache
+    external fun dbgRewindCache(): LongArray
+    // [nextReady, prepareUs (-1 = preparing), transitions, crossfadeUs] of
+    // gapless playback
+    external fun dbgGapless(): LongArray
+    // [acquireUs (-1 = none yet), reused, opens, reuses] of the AAudio
+    // output session shared by consecutive files, then [exclusive,
+    // performanceMode (AAudio constant), bufferFrames, burstFrames] of its
+    // stream
+    external fun dbgAudioOutput(): LongArray
+    // Last audio open, us per stage (-1 = not reached): [demux, codec,
+    //  output, outputPrewarm, ready, firstAudio]; ready and firstAudio
+    //  count from the play request
+    external fun dbgOpenTimings(): LongArray
+    // [hits, misses, idle] of the native audio decoder pool
+    external fun dbgCodecPool(): LongArray
+    // Realtime audio metrics in one batch: [callbacks, underrunCallbacks,
+    //  underrunFrames, ringFillMin, ringFillMax (-1 = no callback since the
+    //  last call), streamXRuns, droppedWrites, writeShortfalls], then three
+    //  histograms (callback period, callback duration, decode-loop pass),
+    //  each [count, sumUs, maxUs, 20 log2-us buckets]. Each call starts a
+    //  new ring fill window.
+    external fun dbgAudioMetrics(): LongArray
+    // [deepBuffer, outputMode, decodeWakeups, callbackCount]
+    external fun dbgPower(): LongArray
+    // [boost, eqEnabled, nightMode, compressorReduction, limiterReduction]
+    // of the output DSP, dB values in hundredths
+    external fun dbgDsp(): LongArray
 
     // Returns true when audio track is running and timestamps are valid.
     external fun isAudioClockHealthy(): Boolean
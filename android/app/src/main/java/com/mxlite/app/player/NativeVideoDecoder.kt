@@ -0,0 +1,130 @@
+package com.mxlite.app.player
+
+import android.os.ParcelFileDescriptor
+import android.util.Log
+import android.view.Surface
+import com.mxlite.player.decoder.VideoDecoder
+import java.io.FileDescriptor
+
+/**
+ * Hardware video decoder driven by the native VideoEngine.
+ *
+ * Decode, A/V sync and frame pacing all run on a native thread against the
+ * native VirtualClock: frames go out with releaseOutputBufferAtTime, so
+ * timing no longer depends on Thread.sleep granularity or GC pauses. This
+ * class only forwards lifecycle calls and reads counters.
+ */
+class NativeVideoDecoder : VideoDecoder {
+
+    private var surface: Surface? = null
+    // Own duplicate of the media fd, so the engine can be re-opened later.
+    private var pfd: ParcelFileDescriptor? = null
+
+    @Volatile private var opened = false
+    @Volatile private var playing = false
+
+    override var durationMs: Long = 0
+        private set
+
+    override val isPlaying: Boolean
+        get() = opened && playing
+
+    override val videoWidth: Int
+        get() = stats().getOrElse(3) { 0L }.toInt()
+    override val videoHeight: Int
+        get() = stats().getOrElse(4) { 0L }.toInt()
+
+    override val decoderName: String
+        get() = NativePlayer.dbgVideoDecoderName().ifEmpty { "Unknown" }
+
+    override val droppedFrames: Int
+        get() = stats().getOrElse(1) { 0L }.toInt()
+
+    // Rendered-frame counter sampled by outputFps
+    private var lastRendered = 0L
+    private var lastRenderedNs = 0L
+    private var fps = 0f
+
+    override val outputFps: Float
+        get() {
+            val rendered = stats().getOrElse(0) { 0L }
+            val now = System.nanoTime()
+            val elapsedNs = now - lastRenderedNs
+            if (lastRenderedNs == 0L || elapsedNs >= 1_000_000_000L) {
+                if (lastRenderedNs != 0L && rendered >= lastRendered) {
+                    fps = (rendered - lastRendered) * 1e9f / elapsedNs
+                }
+                lastRendered = rendered
+                lastRenderedNs = now
+            }
+            return fps
+        }
+
+    private fun stats(): LongArray = NativePlayer.dbgVideoStats()
+
+    override fun prepare(fd: FileDescriptor, surface: Surface) {
+        attachSurface(surface)
+        try { pfd?.close() } catch (_: Exception) {}
+        pfd = ParcelFileDescriptor.dup(fd)
+        open()
+        pause() // start paused
+    }
+
+    private fun open() {
+        val localPfd = pfd ?: return
+        // Rule 3: the codec must be configured against a valid Surface
+        if (surface?.isValid != true) {
+            Log.e("NativeVideoDecoder", "open() ABORT: Surface not ready/valid")
+            return
+        }
+        opened = NativePlayer.nativeVideoOpenFd(localPfd.fd, 0L, -1L)
+        durationMs = if (opened) NativePlayer.nativeVideoDurationUs() / 1000 else 0
+        if (!opened) Log.e("NativeVideoDecoder", "No playable video track")
+    }
+
+    override fun attachSurface(surface: Surface) {
+        this.surface = surface
+        NativePlayer.nativeVideoSetSurface(surface)
+    }
+
+    override fun detachSurface() {
+        surface = null
+        NativePlayer.nativeVideoSetSurface(null)
+    }
+
+    override fun recreateVideo() {
+        // A new surface is switched in by attachSurface(); only re-open if
+        // the engine was never opened (or was stopped).
+        if (!opened) open()
+    }
+
+    override fun play() {
+        playing = true
+        NativePlayer.nativeVideoPlay()
+    }
+
+    override fun pause() {
+        playing = false
+        NativePlayer.nativeVideoPause()
+    }
+
+    override fun seekTo(positionMs: Long) {
+        NativePlayer.nativeVideoSeek(positionMs * 1000L)
+    }
+
+    override fun stop() {
+        playing = false
+        opened = false
+        NativePlayer.nativeVideoStop()
+        durationMs = 0
+        // NOTE: surface is kept; only release() drops it.
+    }
+
+    override fun release() {
+        stop()
+        NativePlayer.nativeVideoRelease()
+        try { pfd?.close() } catch (_: Exception) {}
+        pfd = null
+        surface = null
+    }
+}
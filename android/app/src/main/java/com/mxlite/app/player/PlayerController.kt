@@ -11,12 +11,6 @@ class PlayerController(
     private val context: Context
 ) : PlayerEngine {
 
-    // 🔒 CLOCK: Direct pass-through to C++ VirtualClock
-    private val masterClock = object : PlaybackClock {
-        override val positionMs: Long
-            get() = NativePlayer.virtualClockUs() / 1000
-    }
-
     private var videoDecoder: VideoDecoder? = null
     private var currentSurface: Surface? = null
     
@@ -27,6 +21,11 @@ class PlayerController(
     private var audioPfd: ParcelFileDescriptor? = null
     private var hasAudio = false
 
+    // Gapless next item (prepared natively, adopted in pollItemChange)
+    private var nextPfd: ParcelFileDescriptor? = null
+    private var nextUri: Uri? = null
+    private var itemSerial = 0
+
     override var currentUri: Uri? = null
         private set
 
@@ -35,7 +34,7 @@ class PlayerController(
 
     override val currentPositionMs: Long
         get() {
-            val micros = NativePlayer.virtualClockUs()
+            val micros = ClockSnapshot.positionUs()
             return if (micros < 0) 0L else micros / 1000L
         }
 
@@ -83,15 +82,17 @@ class PlayerController(
         try {
             // 2. Initialize Native Audio / Clock
             NativePlayer.nativeInit()
+            itemSerial = 0
 
             // 3. Open Audio FD
             val pfd = context.contentResolver.openFileDescriptor(uri, "r")
                 ?: throw IllegalStateException("PFD null")
             audioPfd = pfd
             
-            // Pass FD to C++
-            NativePlayer.playFd(pfd.fd, 0L, -1)
-            hasAudio = NativePlayer.dbgHasAudioTrack()
+            // Pass FD to C++. Returns at once; audio opens natively and
+            // video (below) waits only until the file is parsed.
+            NativePlayer.playFdAsync(pfd.fd, 0L, -1)
+            hasAudio = false
             
             // 4. Start Video Engine
             initVideoDecoder()
@@ -132,6 +133,7 @@ class PlayerController(
 
         try { audioPfd?.close() } catch (_: Exception) {}
         audioPfd = null
+        closeNext()
     }
 
     // =========================================================================
@@ -182,12 +184,75 @@ class PlayerController(
         }
     }
 
+    override fun selectAudioTrack(trackIndex: Int): Boolean {
+        // Also while the async open runs: applied when it is done.
+        if (playbackState == PlaybackState.STOPPED) return false
+        return NativePlayer.selectAudioTrack(trackIndex)
+    }
+
+    // =========================================================================
+    // 🟢 GAPLESS NEXT ITEM
+    // =========================================================================
+
+    override fun prepareNext(uri: Uri) {
+        if (playbackState == PlaybackState.STOPPED) return
+        closeNext()
+        try {
+            val pfd = context.contentResolver.openFileDescriptor(uri, "r") ?: return
+            if (NativePlayer.prepareNextFd(pfd.fd, 0L, -1)) {
+                nextPfd = pfd
+                nextUri = uri
+            } else {
+                pfd.close()
+            }
+        } catch (e: Throwable) {
+            e.printStackTrace()
+        }
+    }
+
+    override fun pollItemChange(): Boolean {
+        if (playbackState == PlaybackState.STOPPED) return false
+        // Outcome of the async open (no audio = video-only playback).
+        if (!hasAudio && NativePlayer.openState() == NativePlayer.OPEN_READY) {
+            hasAudio = NativePlayer.dbgHasAudioTrack()
+        }
+        val serial = NativePlayer.itemSerial()
+        if (serial == itemSerial) return false
+        itemSerial = serial
+
+        // Audio already plays the prepared item: its fd becomes the current
+        // one and video restarts on it (same surface).
+        try { audioPfd?.close() } catch (_: Exception) {}
+        audioPfd = nextPfd
+        currentUri = nextUri
+        nextPfd = null
+        nextUri = null
+        hasAudio = true
+        initVideoDecoder()
+
+        // initVideoDecoder resumes the clock: keep a pause made meanwhile.
+        if (playbackState == PlaybackState.PAUSED) {
+            NativePlayer.nativePause()
+            videoDecoder?.pause()
+        }
+        return true
+    }
+
+    private fun closeNext() {
+        NativePlayer.cancelNext()
+        try { nextPfd?.close() } catch (_: Exception) {}
+        nextPfd = null
+        nextUri = null
+    }
+
     // =========================================================================
     // 🟢 LIFECYCLE
     // =========================================================================
 
     override fun attachSurface(surface: Surface) {
         currentSurface = surface
+        // Picture visible again: back to demand-paced audio decode.
+        NativePlayer.setDeepBuffer(false)
         videoDecoder?.attachSurface(surface)
         if (playbackState != PlaybackState.STOPPED) {
              videoDecoder?.recreateVideo()
@@ -203,6 +268,8 @@ class PlayerController(
 
     override fun detachSurface() {
         currentSurface = null
+        // Screen off / backgrounded: audio only, decode in deep batches.
+        NativePlayer.setDeepBuffer(true)
         videoDecoder?.detachSurface()
     }
 
@@ -229,7 +296,7 @@ class PlayerController(
             videoDecoder?.release()
 
             val decoder: VideoDecoder = if (useHwDecoder) {
-                HwVideoDecoder(context, masterClock)
+                NativeVideoDecoder()
             } else {
                 com.mxlite.player.decoder.sw.SwVideoDecoder()
             }
@@ -260,6 +327,7 @@ class PlayerController(
         
         try { audioPfd?.close() } catch (_: Exception) {}
         audioPfd = null
+        closeNext()
         
         currentUri = null
         hasAudio = false
@@ -24,6 +24,16 @@ interface PlayerEngine {
 
     fun seekTo(positionMs: Long)
 
+    // Live audio-track change (AudioTrackInfo.trackIndex); playback goes on
+    // uninterrupted. False if there is nothing playing or no such track.
+    fun selectAudioTrack(trackIndex: Int): Boolean
+
+    // Gapless: opens `uri` in the background to follow the current item
+    // without a gap. pollItemChange() (called periodically) adopts the
+    // switch once it happened and returns true then.
+    fun prepareNext(uri: Uri)
+    fun pollItemChange(): Boolean
+
     fun attachSurface(surface: Surface)
     fun detachSurface()
     fun recreateVideo()
@@ -50,7 +50,7 @@ import androidx.compose.ui.unit.sp
 import androidx.compose.ui.viewinterop.AndroidView
 import androidx.documentfile.provider.DocumentFile
 import com.mxlite.app.player.PlayerEngine
-import com.mxlite.app.player.NativePlayer
+import com.mxlite.app.player.ClockSnapshot
 import com.mxlite.app.subtitle.SubtitleController
 import com.mxlite.app.subtitle.SubtitleCue
 import kotlinx.coroutines.delay
@@ -253,6 +253,8 @@ fun PlayerScreen(
     // ⏱ POLLING & AUTO-HIDE
     LaunchedEffect(Unit) {
         while (true) {
+            // A gapless switch to a prepared next item happened natively.
+            engine.pollItemChange()
             isPlaying = engine.isPlaying
             if (!isDragging) {
                 positionMs = engine.currentPositionMs
@@ -266,7 +268,7 @@ fun PlayerScreen(
                 decoderName = engine.decoderName
                 outputFps = engine.outputFps
                 droppedFrames = engine.droppedFrames
-                audioClockUs = NativePlayer.virtualClockUs()
+                audioClockUs = ClockSnapshot.positionUs()
             }
             subtitleLine = subtitleController?.current(engine.currentPositionMs)
 